@@ -1,35 +1,76 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+//KEYWORDS: ALBEDO_MAP, NORMAL_MAP
+
 //UNIFORM
+#ifdef ALBEDO_MAP
 layout(binding = 1) uniform sampler2D albedoTexture;
+#endif
+#ifdef NORMAL_MAP
 layout(binding = 2) uniform sampler2D normalTexture;
+#endif
+
+//SPECIALIZATION
+layout(constant_id = 0) const int LIGHT_COUNT = 1;
 
 //IN
 layout(location = 0) in vec2 fragUV;
 layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragPosition;
 
 //OUT
 layout(location = 0) out vec4 outColor;
 
-vec3 lightDir = normalize(vec3(1));
-vec3 lightColor = vec3(1);
+const int MAX_LIGHTS = 4;
+const vec3 lightDirs[MAX_LIGHTS] = vec3[](
+	normalize(vec3(1)), normalize(vec3(-1, 1, -1)), normalize(vec3(0, -1, 1)), normalize(vec3(1, 0, -1)));
+const vec3 lightColors[MAX_LIGHTS] = vec3[](
+	vec3(1), vec3(0.4, 0.45, 0.5), vec3(0.3), vec3(0.2));
 float ambientStrength = 0.8;
 
 float lambert(vec3 N, vec3 L) {
 	return max(dot(N, L), 0.0);
 }
 
+#ifdef NORMAL_MAP
+//The vertices carry no tangents, the frame is rebuilt from screen space derivatives
+vec3 perturb_normal(vec3 N, vec3 position, vec2 uv) {
+	vec3 dp1 = dFdx(position);
+	vec3 dp2 = dFdy(position);
+	vec2 duv1 = dFdx(uv);
+	vec2 duv2 = dFdy(uv);
+
+	vec3 dp2perp = cross(dp2, N);
+	vec3 dp1perp = cross(N, dp1);
+	vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
+	vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
+	float invmax = inversesqrt(max(max(dot(T, T), dot(B, B)), 1e-12));
+
+	//Normal maps may be two channel (BC5), rebuild z from the unit length
+	vec2 normalXY = texture(normalTexture, uv).rg * 2.0 - 1.0;
+	vec3 tangentNormal = vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0)));
+
+	return normalize(mat3(T * invmax, B * invmax, N) * tangentNormal);
+}
+#endif
+
 void main() {
+#ifdef ALBEDO_MAP
     vec3 baseColor = texture(albedoTexture, fragUV).rgb;
-    vec3 normalColor = texture(normalTexture, fragUV).rgb;
+#else
+    vec3 baseColor = vec3(1);
+#endif
 
     vec3 normal = normalize(fragNormal);
+#ifdef NORMAL_MAP
+    normal = perturb_normal(normal, fragPosition, fragUV);
+#endif
 
-    vec3 ambientColor = ambientStrength * lightColor;
-    float diffuse = lambert(normal, lightDir);
-	vec3 diffuseColor = diffuse * lightColor;
+    vec3 lighting = vec3(ambientStrength);
+    for (int i = 0; i < min(LIGHT_COUNT, MAX_LIGHTS); ++i) {
+        lighting += lambert(normal, lightDirs[i]) * lightColors[i];
+    }
 
-	vec3 result = (ambientColor + diffuseColor) * baseColor;
-	outColor = vec4(result, 1);
+	outColor = vec4(lighting * baseColor, 1);
 }
\ No newline at end of file
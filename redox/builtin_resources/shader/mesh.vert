@@ -16,6 +16,7 @@ layout(location = 2) in vec2 inUV;
 //OUT
 layout(location = 0) out vec2 fragUV;
 layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragPosition;
 
 out gl_PerVertex {
     vec4 gl_Position;
@@ -27,4 +28,5 @@ void main() {
 
 	fragUV = inUV;
 	fragNormal = inNormal * mat3(mvp_buffer.model);
+	fragPosition = (vec4(inPosition, 1.0) * mvp_buffer.model).xyz;
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ SOFTWARE.
 #include <core/application.h>
 #include <core/string_format.h>
 
+#include <algorithm> //std::max
+
 redox::Application* redox::Application::instance = nullptr;
 
 redox::Application::Application(Path directory) :
@@ -35,7 +37,14 @@ redox::Application::Application(Path directory) :
 	RDX_LOG("Initializing Redox...", ConsoleColor::GREEN);
 	_threadId = std::this_thread::get_id();
 
-	_resourceManager = make_unique<ResourceManager>("builtin_resources\\", _directory / "resources\\");
+	u32 workerThreads = _config.get("Engine", "WorkerThreads");
+	if (workerThreads == 0) {
+		workerThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	_threadPool = make_unique<ThreadPool>(workerThreads);
+	_resourceManager = make_unique<ResourceManager>("builtin_resources\\", _directory / "resources\\",
+		_directory / _config.get("Resources", "DerivedDataCache").as<String>());
 	_init_window();
 	_graphics = make_unique<graphics::Graphics>(*_window);
 	_renderSystem = make_unique<graphics::RenderSystem>();
@@ -62,6 +71,7 @@ void redox::Application::run() {
 
 		_window->process_events();
 		_inputSystem->poll();
+		_resourceManager->update();
 
 		if (_inputSystem->key_state(input::Keys::ESC) == input::KeyState::PRESSED) {
 			stop();
@@ -105,6 +115,10 @@ redox::ResourceManager* redox::Application::resource_manager() {
 	return _resourceManager.get();
 }
 
+redox::ThreadPool* redox::Application::thread_pool() {
+	return _threadPool.get();
+}
+
 const redox::input::InputSystem* redox::Application::input_system() const {
 	return _inputSystem.get();
 }
@@ -30,6 +30,7 @@ SOFTWARE.
 #include <platform/timer.h>
 #include <input/input_system.h>
 #include <resources/resource_manager.h>
+#include <core/threading/thread_pool.h>
 
 #include <thread> //std::thread::id
 
@@ -57,6 +58,7 @@ namespace redox {
 		const graphics::Graphics* graphics() const;
 
 		ResourceManager* resource_manager();
+		ThreadPool* thread_pool();
 
 	private:
 		void _init_window();
@@ -73,6 +75,9 @@ namespace redox {
 		UniquePtr<graphics::Graphics> _graphics;
 		UniquePtr<graphics::RenderSystem> _renderSystem;
 
+		//Declared last so workers are joined before any system they might still reference is destroyed
+		UniquePtr<ThreadPool> _threadPool;
+
 		Application::State _state;
 	};
 }
\ No newline at end of file
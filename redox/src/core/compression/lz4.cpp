@@ -0,0 +1,210 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "lz4.h"
+#include <cstring> //std::memcpy
+
+namespace {
+	constexpr std::size_t MIN_MATCH = 4;
+	constexpr std::size_t LAST_LITERALS = 5;
+	constexpr std::size_t MF_LIMIT = 12;
+	constexpr std::size_t MAX_OFFSET = 65535;
+	constexpr redox::u32 HASH_LOG = 12;
+
+	redox::u32 read32(const redox::byte* ptr) {
+		redox::u32 value;
+		std::memcpy(&value, ptr, sizeof(value));
+		return value;
+	}
+
+	redox::u32 hash_sequence(redox::u32 sequence) {
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+
+	redox::byte* write_length(redox::byte* op, std::size_t length) {
+		for (; length >= 255; length -= 255) {
+			*op++ = 255;
+		}
+		*op++ = static_cast<redox::byte>(length);
+		return op;
+	}
+
+	bool read_length(const redox::byte*& ip, const redox::byte* iend, std::size_t& length) {
+		redox::byte s;
+		do {
+			if (ip >= iend) {
+				return false;
+			}
+			s = *ip++;
+			length += s;
+		} while (s == 255);
+		return true;
+	}
+}
+
+std::size_t redox::lz4::compress(const byte* src, std::size_t srcSize, byte* dst, std::size_t dstCapacity) {
+	if (dstCapacity < compress_bound(srcSize)) {
+		return 0;
+	}
+
+	const byte* ip = src;
+	const byte* anchor = src;
+	const byte* const iend = src + srcSize;
+	byte* op = dst;
+
+	if (srcSize > MF_LIMIT) {
+		//Positions relative to src, zero initialized entries are rejected by the match check
+		Array<u32, 1 << HASH_LOG> table{};
+
+		const byte* const mflimit = iend - MF_LIMIT;
+		const byte* const matchlimit = iend - LAST_LITERALS;
+
+		while (ip <= mflimit) {
+			auto sequence = read32(ip);
+			auto& slot = table[hash_sequence(sequence)];
+			const byte* ref = src + slot;
+			slot = static_cast<u32>(ip - src);
+
+			if (ref >= ip || static_cast<std::size_t>(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+				++ip;
+				continue;
+			}
+
+			while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+				--ip;
+				--ref;
+			}
+
+			const byte* mp = ip + MIN_MATCH;
+			const byte* rp = ref + MIN_MATCH;
+			while (mp < matchlimit && *mp == *rp) {
+				++mp;
+				++rp;
+			}
+
+			auto literals = static_cast<std::size_t>(ip - anchor);
+			auto matchLength = static_cast<std::size_t>(mp - ip) - MIN_MATCH;
+			auto offset = static_cast<std::size_t>(ip - ref);
+
+			byte* token = op++;
+			*token = static_cast<byte>((literals >= 15 ? 15 : literals) << 4);
+			if (literals >= 15) {
+				op = write_length(op, literals - 15);
+			}
+
+			std::memcpy(op, anchor, literals);
+			op += literals;
+
+			*op++ = static_cast<byte>(offset & 0xff);
+			*op++ = static_cast<byte>(offset >> 8);
+
+			*token |= static_cast<byte>(matchLength >= 15 ? 15 : matchLength);
+			if (matchLength >= 15) {
+				op = write_length(op, matchLength - 15);
+			}
+
+			ip = anchor = mp;
+		}
+	}
+
+	//The last sequence only carries literals
+	auto literals = static_cast<std::size_t>(iend - anchor);
+	byte* token = op++;
+	*token = static_cast<byte>((literals >= 15 ? 15 : literals) << 4);
+	if (literals >= 15) {
+		op = write_length(op, literals - 15);
+	}
+
+	std::memcpy(op, anchor, literals);
+	op += literals;
+
+	return static_cast<std::size_t>(op - dst);
+}
+
+std::size_t redox::lz4::decompress(const byte* src, std::size_t srcSize, byte* dst, std::size_t dstCapacity) {
+	const byte* ip = src;
+	const byte* const iend = src + srcSize;
+	byte* op = dst;
+	byte* const oend = dst + dstCapacity;
+
+	for (;;) {
+		if (ip >= iend) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		u32 token = *ip++;
+		std::size_t literals = token >> 4;
+		if (literals == 15 && !read_length(ip, iend, literals)) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		if (literals > static_cast<std::size_t>(iend - ip) || literals > static_cast<std::size_t>(oend - op)) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		std::memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+
+		if (ip == iend) {
+			break;
+		}
+
+		if (iend - ip < 2) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > static_cast<std::size_t>(op - dst)) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		std::size_t matchLength = token & 15;
+		if (matchLength == 15 && !read_length(ip, iend, matchLength)) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		matchLength += MIN_MATCH;
+		if (matchLength > static_cast<std::size_t>(oend - op)) {
+			throw Exception("corrupt lz4 block");
+		}
+
+		const byte* match = op - offset;
+		if (offset >= matchLength) {
+			std::memcpy(op, match, matchLength);
+		}
+		else {
+			//Overlapping matches repeat the last <offset> bytes
+			for (std::size_t i = 0; i < matchLength; ++i) {
+				op[i] = match[i];
+			}
+		}
+		op += matchLength;
+	}
+
+	return static_cast<std::size_t>(op - dst);
+}
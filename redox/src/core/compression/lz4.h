@@ -0,0 +1,42 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+
+namespace redox::lz4 {
+	//Raw LZ4 block format (no frame header), compatible with the reference decoder
+
+	//Worst case compressed size for an input of srcSize bytes
+	constexpr std::size_t compress_bound(std::size_t srcSize) noexcept {
+		return srcSize + srcSize / 255 + 16;
+	}
+
+	//Returns the number of bytes written or 0 if dstCapacity < compress_bound(srcSize)
+	std::size_t compress(const byte* src, std::size_t srcSize, byte* dst, std::size_t dstCapacity);
+
+	//Returns the number of bytes written, throws on malformed input or if dst is too small
+	std::size_t decompress(const byte* src, std::size_t srcSize, byte* dst, std::size_t dstCapacity);
+}
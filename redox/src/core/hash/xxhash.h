@@ -0,0 +1,121 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+
+#include <cstring> //std::memcpy
+
+namespace redox::hash {
+	namespace detail {
+		constexpr u64 XXH_PRIME64_1 = 0x9E3779B185EBCA87ull;
+		constexpr u64 XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr u64 XXH_PRIME64_3 = 0x165667B19E3779F9ull;
+		constexpr u64 XXH_PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+		constexpr u64 XXH_PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+		inline u64 rotl64(u64 x, int r) noexcept {
+			return (x << r) | (x >> (64 - r));
+		}
+
+		inline u64 read64(const byte* ptr) noexcept {
+			u64 value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline u32 read32(const byte* ptr) noexcept {
+			u32 value;
+			std::memcpy(&value, ptr, sizeof(value));
+			return value;
+		}
+
+		inline u64 xxh64_round(u64 acc, u64 input) noexcept {
+			acc += input * XXH_PRIME64_2;
+			acc = rotl64(acc, 31);
+			return acc * XXH_PRIME64_1;
+		}
+
+		inline u64 xxh64_merge(u64 acc, u64 value) noexcept {
+			acc ^= xxh64_round(0, value);
+			return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+		}
+	}
+
+	//XXH64, matches the reference implementation on little endian targets
+	inline u64 xxh64(const void* data, std::size_t size, u64 seed = 0) noexcept {
+		using namespace detail;
+
+		auto ptr = static_cast<const byte*>(data);
+		auto end = ptr + size;
+		u64 h;
+
+		if (size >= 32) {
+			u64 v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+			u64 v2 = seed + XXH_PRIME64_2;
+			u64 v3 = seed;
+			u64 v4 = seed - XXH_PRIME64_1;
+
+			for (auto limit = end - 32; ptr <= limit; ptr += 32) {
+				v1 = xxh64_round(v1, read64(ptr));
+				v2 = xxh64_round(v2, read64(ptr + 8));
+				v3 = xxh64_round(v3, read64(ptr + 16));
+				v4 = xxh64_round(v4, read64(ptr + 24));
+			}
+
+			h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+			h = xxh64_merge(h, v1);
+			h = xxh64_merge(h, v2);
+			h = xxh64_merge(h, v3);
+			h = xxh64_merge(h, v4);
+		}
+		else h = seed + XXH_PRIME64_5;
+
+		h += static_cast<u64>(size);
+
+		for (; ptr + 8 <= end; ptr += 8) {
+			h ^= xxh64_round(0, read64(ptr));
+			h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+		}
+
+		if (ptr + 4 <= end) {
+			h ^= static_cast<u64>(read32(ptr)) * XXH_PRIME64_1;
+			h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+			ptr += 4;
+		}
+
+		for (; ptr < end; ++ptr) {
+			h ^= (*ptr) * XXH_PRIME64_5;
+			h = rotl64(h, 11) * XXH_PRIME64_1;
+		}
+
+		h ^= h >> 33;
+		h *= XXH_PRIME64_2;
+		h ^= h >> 29;
+		h *= XXH_PRIME64_3;
+		h ^= h >> 32;
+		return h;
+	}
+}
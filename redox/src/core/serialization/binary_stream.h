@@ -0,0 +1,122 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+
+#include <cstring> //std::memcpy
+#include <type_traits> //std::is_trivially_copyable_v
+
+namespace redox {
+	//Appends trivially copyable values in native layout, readers must run on the same platform
+	class BinaryWriter {
+	public:
+		template<class T>
+		void write(const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "<T> must be trivially copyable");
+			write_bytes(&value, sizeof(T));
+		}
+
+		template<class T>
+		void write_array(const Buffer<T>& values) {
+			static_assert(std::is_trivially_copyable_v<T>, "<T> must be trivially copyable");
+			write(static_cast<u64>(values.size()));
+			write_bytes(values.data(), values.size() * sizeof(T));
+		}
+
+		void write_string(StringView str) {
+			write(static_cast<u32>(str.size()));
+			write_bytes(str.data(), str.size());
+		}
+
+		void write_bytes(const void* data, std::size_t size) {
+			auto ptr = static_cast<const byte*>(data);
+			_buffer.insert(_buffer.end(), ptr, ptr + size);
+		}
+
+		const Buffer<byte>& buffer() const {
+			return _buffer;
+		}
+
+	private:
+		Buffer<byte> _buffer;
+	};
+
+	//Reads what BinaryWriter produced, throws instead of reading past the end
+	class BinaryReader {
+	public:
+		BinaryReader(const byte* data, std::size_t size) :
+			_data(data), _size(size) {
+		}
+
+		template<class T>
+		T read() {
+			static_assert(std::is_trivially_copyable_v<T>, "<T> must be trivially copyable");
+			T value;
+			std::memcpy(&value, read_bytes(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		template<class T>
+		Buffer<T> read_array() {
+			static_assert(std::is_trivially_copyable_v<T>, "<T> must be trivially copyable");
+			auto count = read<u64>();
+			if (count > remaining() / sizeof(T)) {
+				throw Exception("binary stream truncated");
+			}
+
+			Buffer<T> values(static_cast<std::size_t>(count));
+			if (!values.empty()) {
+				std::memcpy(values.data(), read_bytes(values.size() * sizeof(T)), values.size() * sizeof(T));
+			}
+			return values;
+		}
+
+		String read_string() {
+			auto size = read<u32>();
+			auto ptr = read_bytes(size);
+			return String(reinterpret_cast<const char*>(ptr), size);
+		}
+
+		const byte* read_bytes(std::size_t size) {
+			if (size > remaining()) {
+				throw Exception("binary stream truncated");
+			}
+
+			auto ptr = _data + _offset;
+			_offset += size;
+			return ptr;
+		}
+
+		std::size_t remaining() const {
+			return _size - _offset;
+		}
+
+	private:
+		const byte* _data;
+		std::size_t _size;
+		std::size_t _offset{ 0 };
+	};
+}
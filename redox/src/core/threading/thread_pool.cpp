@@ -0,0 +1,148 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "thread_pool.h"
+#include <core/logging/log.h>
+
+redox::ThreadPool::ThreadPool(std::size_t numThreads) {
+	RDX_LOG("Starting {0} worker threads...", numThreads);
+
+	_workers.reserve(numThreads);
+	for (std::size_t i = 0; i < numThreads; ++i) {
+		_workers.emplace_back([this]() { _worker(); });
+	}
+}
+
+redox::ThreadPool::~ThreadPool() {
+	decltype(_tasks) tasks;
+	decltype(_groups) groups;
+	{
+		std::lock_guard guard(_mutex);
+		_running = false;
+		tasks.swap(_tasks);
+		groups.swap(_groups);
+	}
+
+	//Dropping queued tasks breaks their promises, so workers waiting on one of them return
+	tasks = {};
+	groups.clear();
+
+	_condition.notify_all();
+	for (auto& worker : _workers) {
+		worker.join();
+	}
+}
+
+std::size_t redox::ThreadPool::size() const {
+	return _workers.size();
+}
+
+redox::u64 redox::ThreadPool::create_group() {
+	std::lock_guard guard(_mutex);
+	return _nextGroup++;
+}
+
+bool redox::ThreadPool::_run_pending(u64 group) {
+	Function<void()> fn;
+	{
+		std::lock_guard guard(_mutex);
+		if (auto git = _groups.find(group); git != _groups.end()) {
+			//Claimed entries are trimmed by _take, the front is always runnable
+			fn = _take(*git->second.front());
+		}
+
+		if (!fn) {
+			return false;
+		}
+	}
+
+	fn();
+	return true;
+}
+
+redox::Function<void()> redox::ThreadPool::_take(task_entry& entry) {
+	if (!entry.fn) {
+		return nullptr;
+	}
+
+	auto fn = std::move(entry.fn);
+	entry.fn = nullptr;
+
+	if (entry.group != NO_GROUP) {
+		auto git = _groups.find(entry.group);
+		auto& queue = git->second;
+		while (!queue.empty() && !queue.front()->fn) {
+			queue.pop_front();
+		}
+
+		if (queue.empty()) {
+			_groups.erase(git);
+		}
+	}
+	return fn;
+}
+
+void redox::ThreadPool::_enqueue(Function<void()> fn, TaskPriority priority, u64 group) {
+	{
+		std::lock_guard guard(_mutex);
+
+		//Tasks submitted during shutdown are dropped, which breaks their promise
+		if (!_running) {
+			return;
+		}
+
+		auto entry = make_shared<task_entry>(task_entry{ std::move(fn), group });
+		if (group != NO_GROUP) {
+			_groups[group].push_back(entry);
+		}
+		_tasks.push({ std::move(entry), priority, _sequence++ });
+	}
+	_condition.notify_one();
+}
+
+void redox::ThreadPool::_worker() {
+	for (;;) {
+		Function<void()> fn;
+		{
+			std::unique_lock lock(_mutex);
+			_condition.wait(lock, [this]() { return !_running || !_tasks.empty(); });
+
+			//The queue has already been dropped on shutdown
+			if (!_running) {
+				return;
+			}
+
+			auto entry = _tasks.top().entry;
+			_tasks.pop();
+
+			//Already run by a thread waiting on its group
+			fn = _take(*entry);
+			if (!fn) {
+				continue;
+			}
+		}
+		fn();
+	}
+}
@@ -0,0 +1,121 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+#include <core/non_copyable.h>
+
+#include <thread> //std::thread
+#include <mutex> //std::mutex, std::unique_lock
+#include <condition_variable> //std::condition_variable
+#include <future> //std::packaged_task, std::future
+#include <queue> //std::priority_queue
+#include <deque> //std::deque
+#include <chrono> //std::chrono::milliseconds
+
+namespace redox {
+
+	enum class TaskPriority {
+		LOW,
+		NORMAL,
+		HIGH,
+		CRITICAL
+	};
+
+	class ThreadPool : public NonCopyable {
+	public:
+		ThreadPool(std::size_t numThreads);
+		~ThreadPool();
+
+		template<class Fn>
+		auto submit(Fn&& fn, TaskPriority priority = TaskPriority::NORMAL, u64 group = NO_GROUP) {
+			using result_type = std::invoke_result_t<std::decay_t<Fn>>;
+
+			//std::function requires copyable targets, packaged_task is move-only
+			auto task = make_shared<std::packaged_task<result_type()>>(std::forward<Fn>(fn));
+			auto future = task->get_future();
+			_enqueue([task]() { (*task)(); }, priority, group);
+			return future;
+		}
+
+		//Tasks submitted to a group can be run by whoever waits on that group
+		u64 create_group();
+
+		//Runs queued tasks of group on the calling thread until future is ready, so tasks
+		//can wait for work they submitted themselves without starving the pool.
+		//Other tasks are never picked up, they might wait on something further up this stack
+		template<class T>
+		void wait(const std::future<T>& future, u64 group) {
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				if (!_run_pending(group)) {
+					future.wait_for(std::chrono::milliseconds(1));
+				}
+			}
+		}
+
+		std::size_t size() const;
+
+		static constexpr u64 NO_GROUP = 0;
+
+	private:
+		//Shared between the priority queue and the queue of its group, whoever runs it first takes fn
+		struct task_entry {
+			Function<void()> fn;
+			u64 group;
+		};
+
+		struct queued_task {
+			SharedPtr<task_entry> entry;
+			TaskPriority priority;
+			u64 sequence;
+		};
+
+		struct task_compare {
+			bool operator()(const queued_task& a, const queued_task& b) const {
+				//Higher priorities first, FIFO within the same priority
+				if (a.priority != b.priority) {
+					return a.priority < b.priority;
+				}
+				return a.sequence > b.sequence;
+			}
+		};
+
+		//Executes one queued task of group if there is any
+		bool _run_pending(u64 group);
+
+		Function<void()> _take(task_entry& entry);
+		void _enqueue(Function<void()> fn, TaskPriority priority, u64 group);
+		void _worker();
+
+		std::mutex _mutex;
+		std::condition_variable _condition;
+		std::priority_queue<queued_task, Buffer<queued_task>, task_compare> _tasks;
+		Hashmap<u64, std::deque<SharedPtr<task_entry>>> _groups;
+		Buffer<std::thread> _workers;
+		u64 _sequence{ 0 };
+		u64 _nextGroup{ NO_GROUP + 1 };
+		bool _running{ true };
+	};
+}
@@ -28,9 +28,9 @@ SOFTWARE.
 #include "graphics.h"
 #include "render_system.h"
 #include "command_pool.h"
-#include "resources\texture.h"
 
-redox::graphics::Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags) :
+redox::graphics::Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage,
+	VkMemoryPropertyFlags memFlags, AllocationStrategy strategy) :
 	_size(size) {
 	
 	VkBufferCreateInfo bufferInfo{};
@@ -43,30 +43,12 @@ redox::graphics::Buffer::Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkM
 		throw Exception("failed to create buffer");
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(Graphics::instance().device(), _handle, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-
-	auto memType = Graphics::instance().pick_memory_type(memRequirements.memoryTypeBits, memFlags);
-	if (!memType) {
-		throw Exception("failed to determine memory type");
-	}
-
-	allocInfo.memoryTypeIndex = memType.value();
-
-	if (vkAllocateMemory(Graphics::instance().device(), &allocInfo, nullptr, &_memory) != VK_SUCCESS) {
-		throw Exception("failed to allocate vertex buffer memory");
-	}
-
-	vkBindBufferMemory(Graphics::instance().device(), _handle, _memory, 0);
+	_memory = Graphics::instance().allocator().bind_buffer(_handle, memFlags, strategy);
 }
 
 redox::graphics::Buffer::~Buffer() {
 	vkDestroyBuffer(Graphics::instance().device(), _handle, nullptr);
-	vkFreeMemory(Graphics::instance().device(), _memory, nullptr);
+	Graphics::instance().allocator().free(_memory);
 }
 
 VkDeviceSize redox::graphics::Buffer::size() const {
@@ -78,44 +60,56 @@ VkBuffer redox::graphics::Buffer::handle() const {
 }
 
 void redox::graphics::Buffer::map(FunctionRef<void(void*)> fn) {
-	void* data;
-	vkMapMemory(Graphics::instance().device(), _memory, 0, _size, 0, &data);
-	fn(data);
-	vkUnmapMemory(Graphics::instance().device(), _memory);
+	if (!_memory.mapped)
+		throw Exception("buffer memory is not host visible");
+	fn(_memory.mapped);
 }
 
-void redox::graphics::Buffer::copy_to(const Buffer& other) {
-	VkBufferCopy copyRegion{};
-	copyRegion.size = _size;
-	AuxCommandPool::instance().submit([this, &other, &copyRegion](CommandBufferView cbo) {
-		vkCmdCopyBuffer(cbo.handle(), _handle, other.handle(), 1, &copyRegion);
-	});
+void* redox::graphics::Buffer::mapped() const {
+	return _memory.mapped;
 }
 
-void redox::graphics::Buffer::copy_to(const Texture& texture) {
-	const auto& ts = texture.dimension();
-
-	VkBufferImageCopy region{};
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.layerCount = 1;
-	region.imageExtent = { ts.width, ts.height, 1 };
+redox::graphics::StagedBuffer::StagedBuffer(VkDeviceSize size, VkBufferUsageFlags usage) :
+	_buffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) {
 
-	AuxCommandPool::instance().submit([this, &texture, &region](CommandBufferView cbo) {
-		vkCmdCopyBufferToImage(cbo.handle(), _handle, texture.handle(),
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-	});
 }
 
-redox::graphics::StagedBuffer::StagedBuffer(VkDeviceSize size, VkBufferUsageFlags usage) :
-	_buffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
-	_stagingBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+redox::graphics::StagedBuffer::~StagedBuffer() {
+	if (_staging) {
+		Graphics::instance().staging_pool().release(*_staging);
+	}
+}
 
+void redox::graphics::StagedBuffer::map(FunctionRef<void(void*)> fn) {
+	if (!_staging) {
+		_staging = Graphics::instance().staging_pool().acquire(_buffer.size());
+	}
+	fn(_staging->data);
 }
 
 void redox::graphics::StagedBuffer::upload() {
-	_stagingBuffer.copy_to(_buffer);
+	if (!_staging) {
+		return;
+	}
+
+	UploadBatch batch;
+	upload(batch);
+	batch.wait();
+}
+
+void redox::graphics::StagedBuffer::upload(UploadBatch& batch) {
+	if (!_staging) {
+		return;
+	}
+
+	batch.copy(*_staging, _buffer);
+	_staging.reset();
 }
 
 VkBuffer redox::graphics::StagedBuffer::handle() const {
 	return _buffer.handle();
 }
+
+VkDeviceSize redox::graphics::StagedBuffer::size() const {
+	return _buffer.size();
+}
@@ -25,18 +25,24 @@ SOFTWARE.
 */
 #pragma once
 #include "vulkan.h"
+#include "memory_allocator.h"
+#include "staging_pool.h"
 
 #include "core\non_copyable.h"
 #include "core\utility.h"
 #include "core\error.h"
 
+#include <optional> //std::optional
+
 namespace redox::graphics {
 	class CommandBufferView;
 	class Texture;
+	class UploadBatch;
 
 	class Buffer : public NonCopyable {
 	public:
-		Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags);
+		Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memFlags,
+			AllocationStrategy strategy = AllocationStrategy::DEFAULT);
 		~Buffer();
 
 		VkDeviceSize size() const;
@@ -50,35 +56,41 @@ namespace redox::graphics {
 		}
 
 		void map(FunctionRef<void(void*)> fn);
-		void copy_to(const Buffer& other);
-		void copy_to(const Texture& texture);
+		//Persistent pointer to host visible memory, null otherwise
+		void* mapped() const;
 
 	protected:
 		VkBuffer _handle;
-		VkDeviceMemory _memory;
+		MemoryAllocation _memory;
 		VkDeviceSize _size;
 	};
 
+	//Device local buffer filled through the shared StagingPool
 	class StagedBuffer : public NonCopyable {
 	public:
 		StagedBuffer(VkDeviceSize size, VkBufferUsageFlags usage);
-		~StagedBuffer() = default;
+		~StagedBuffer();
 
 		template<class T>
 		void map(FunctionRef<void(T*)> fn) {
-			_stagingBuffer.map<T>(fn);
+			map([&fn](void* data) {
+				fn(reinterpret_cast<T*>(data));
+			});
 		}
 
-		void map(FunctionRef<void(void*)> fn) {
-			_stagingBuffer.map(fn);
-		}
+		//Writes go to staging memory until the next upload, it doesn't hold the previous contents
+		void map(FunctionRef<void(void*)> fn);
 
+		//Copies the staged writes and releases the staging memory, does nothing without writes
 		void upload();
+		//Records the copy instead, the staging memory is released once the batch completed
+		void upload(UploadBatch& batch);
 		VkBuffer handle() const;
+		VkDeviceSize size() const;
 
 	private:
 		Buffer _buffer;
-		Buffer _stagingBuffer;
+		std::optional<StagingRegion> _staging;
 	};
 
 	struct UniformBuffer : public StagedBuffer {
@@ -93,9 +105,16 @@ namespace redox::graphics {
 		}
 	};
 
+	//Also readable as a storage buffer by the cluster culling pass
 	struct IndexBuffer : public StagedBuffer {
 		IndexBuffer(VkDeviceSize size) :
-			StagedBuffer(size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+			StagedBuffer(size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+		}
+	};
+
+	struct StorageBuffer : public StagedBuffer {
+		StorageBuffer(VkDeviceSize size) :
+			StagedBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
 		}
 	};
 }
\ No newline at end of file
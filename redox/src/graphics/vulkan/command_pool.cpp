@@ -121,6 +121,8 @@ redox::graphics::AuxCommandPool::~AuxCommandPool() {
 void redox::graphics::AuxCommandPool::submit(FunctionRef<void(const CommandBufferView&)> fn,
 	bool sync, uint64_t timeout) const noexcept {
 
+	std::lock_guard guard(_mutex);
+
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -150,3 +152,10 @@ void redox::graphics::AuxCommandPool::submit(FunctionRef<void(const CommandBuffe
 	}
 	vkFreeCommandBuffers(Graphics::instance().device(), _handle, 1, &commandBuffer);
 }
+
+void redox::graphics::AuxCommandPool::submit(const VkSubmitInfo& submitInfo, VkFence fence) const {
+	std::lock_guard guard(_mutex);
+	if (vkQueueSubmit(Graphics::instance().graphics_queue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+		throw Exception("failed to submit upload");
+	}
+}
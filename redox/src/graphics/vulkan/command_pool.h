@@ -29,6 +29,8 @@ SOFTWARE.
 #include "resources/mesh.h"
 #include "resources/material.h"
 
+#include <mutex> //std::mutex
+
 namespace redox::graphics {
 
 	class CommandBufferView {
@@ -82,8 +84,13 @@ namespace redox::graphics {
 			const CommandBufferView&)> fn, bool sync = true,
 			uint64_t timeout = std::numeric_limits<uint64_t>::max()) const noexcept;
 
+		//Queue submission for command buffers recorded elsewhere, e.g. by UploadBatch
+		void submit(const VkSubmitInfo& submitInfo, VkFence fence) const;
+
 	private:
 		VkFence _queueFence;
+		//Resources are uploaded from several loader threads, the pool and queue need external sync
+		mutable std::mutex _mutex;
 	};
 
 }
\ No newline at end of file
@@ -8,9 +8,23 @@ redox::graphics::IndexedDraw::IndexedDraw(ResourceHandle<Mesh> mesh, ResourceHan
 void redox::graphics::IndexedDraw::execute(const CommandBufferView & cb) {
 	_material->bind(cb.handle());
 	_mesh->bind(cb.handle());
-	vkCmdDrawIndexed(cb.handle(), _range.count, 1, _range.start, 0, 0);
+	vkCmdDrawIndexed(cb.handle(), _range.count, 1, _range.start, _range.vertexOffset, 0);
 }
 
 std::size_t redox::graphics::IndexedDraw::sort_key() const {
 	return (std::size_t)_material.get();
 }
+
+redox::graphics::IndirectDraw::IndirectDraw(ResourceHandle<Mesh> mesh, ResourceHandle<Material> material, std::size_t submesh) :
+	_mesh(std::move(mesh)), _material(std::move(material)), _submesh(submesh) {
+}
+
+void redox::graphics::IndirectDraw::execute(const CommandBufferView& cb) {
+	_material->bind(cb.handle());
+	_mesh->bind_culled(cb.handle());
+	_mesh->draw_culled(cb.handle(), _submesh);
+}
+
+std::size_t redox::graphics::IndirectDraw::sort_key() const {
+	return (std::size_t)_material.get();
+}
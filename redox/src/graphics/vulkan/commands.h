@@ -9,6 +9,7 @@ namespace redox::graphics {
 
 	struct IndexRange {
 		uint32_t start, count;
+		int32_t vertexOffset;
 	};
 
 	class ICommand {
@@ -29,4 +30,19 @@ namespace redox::graphics {
 		ResourceHandle<Material> _material;
 		IndexRange _range;
 	};
+
+	//Draws what the cluster culling pass left of a submesh, see Mesh::cull
+	class IndirectDraw : public ICommand {
+	public:
+		IndirectDraw(ResourceHandle<Mesh> mesh,
+			ResourceHandle<Material> material, std::size_t submesh);
+
+		void execute(const CommandBufferView& cb) override;
+		std::size_t sort_key() const override;
+
+	private:
+		ResourceHandle<Mesh> _mesh;
+		ResourceHandle<Material> _material;
+		std::size_t _submesh;
+	};
 }
\ No newline at end of file
@@ -30,39 +30,106 @@ SOFTWARE.
 #include "buffer.h"
 #include "pipeline.h"
 
-redox::graphics::DescriptorPool::DescriptorPool(uint32_t maxSets, uint32_t maxImages, uint32_t maxUBOs) {
+namespace redox::graphics {
+	struct DescriptorPoolState {
+		~DescriptorPoolState() {
+			vkDestroyDescriptorPool(Graphics::instance().device(), handle, nullptr);
+		}
+
+		VkDescriptorPool handle;
+		std::mutex mutex;
+	};
+}
+
+redox::graphics::DescriptorPool::DescriptorPool(uint32_t maxSets, uint32_t maxImages, uint32_t maxUBOs, uint32_t maxSSBOs) :
+	_maxSets(maxSets),
+	_maxImages(maxImages),
+	_maxUBOs(maxUBOs),
+	_maxSSBOs(maxSSBOs) {
+
+	_pools.push_back(_create_pool());
+}
+
+//Pools are destroyed with the last of their sets still waiting in the release queue
+redox::graphics::DescriptorPool::~DescriptorPool() = default;
+
+redox::graphics::DescriptorSet redox::graphics::DescriptorPool::allocate(VkDescriptorSetLayout layout) const {
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	auto try_allocate = [&allocInfo](DescriptorPoolState& pool, VkDescriptorSet& set) {
+		allocInfo.descriptorPool = pool.handle;
 
+		std::lock_guard guard(pool.mutex);
+		auto result = vkAllocateDescriptorSets(Graphics::instance().device(), &allocInfo, &set);
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+			return false;
+
+		if (result != VK_SUCCESS)
+			throw Exception("failed to allocate descriptor set");
+		return true;
+	};
+
+	std::lock_guard guard(_mutex);
+
+	VkDescriptorSet set;
+	for (const auto& pool : _pools) {
+		if (try_allocate(*pool, set))
+			return DescriptorSet(pool, set);
+	}
+
+	auto& pool = _pools.emplace_back(_create_pool());
+	if (!try_allocate(*pool, set))
+		throw Exception("failed to allocate descriptor set");
+
+	return DescriptorSet(pool, set);
+}
+
+redox::SharedPtr<redox::graphics::DescriptorPoolState> redox::graphics::DescriptorPool::_create_pool() const {
 	VkDescriptorPoolSize poolSizes[] = {
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxUBOs },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxImages }
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _maxUBOs },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _maxImages },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _maxSSBOs }
 	};
 
+	//Sets are freed one by one as the meshes and materials using them go away
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 	poolInfo.poolSizeCount = util::array_size<uint32_t>(poolSizes);
 	poolInfo.pPoolSizes = poolSizes;
-	poolInfo.maxSets = maxSets;
+	poolInfo.maxSets = _maxSets;
 
-	if (vkCreateDescriptorPool(Graphics::instance().device(), &poolInfo, nullptr, &_handle) != VK_SUCCESS)
+	VkDescriptorPool handle;
+	if (vkCreateDescriptorPool(Graphics::instance().device(), &poolInfo, nullptr, &handle) != VK_SUCCESS)
 		throw Exception("failed to create descriptor pool");
+
+	auto state = make_shared<DescriptorPoolState>();
+	state->handle = handle;
+	return state;
 }
 
-redox::graphics::DescriptorPool::~DescriptorPool() {
-	vkDestroyDescriptorPool(Graphics::instance().device(), _handle, nullptr);
+redox::graphics::DescriptorSet::DescriptorSet(SharedPtr<DescriptorPoolState> pool, VkDescriptorSet handle) :
+	DescriptorSetView(handle),
+	_pool(std::move(pool)) {
 }
 
-redox::graphics::DescriptorSetView redox::graphics::DescriptorPool::allocate(VkDescriptorSetLayout layout) const {
-	VkDescriptorSet set;
-	VkDescriptorSetAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = _handle;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = &layout;
+redox::graphics::DescriptorSet::DescriptorSet(DescriptorSet&& other) noexcept :
+	DescriptorSetView(other._handle),
+	_pool(std::move(other._pool)) {
+	other._handle = VK_NULL_HANDLE;
+}
 
-	if (vkAllocateDescriptorSets(Graphics::instance().device(), &allocInfo, &set) != VK_SUCCESS)
-		throw Exception("failed to allocate descriptor set");
+redox::graphics::DescriptorSet::~DescriptorSet() {
+	if (_handle == VK_NULL_HANDLE)
+		return;
 
-	return set;
+	Graphics::instance().release_queue().release([pool = _pool, handle = _handle]() {
+		std::lock_guard guard(pool->mutex);
+		vkFreeDescriptorSets(Graphics::instance().device(), pool->handle, 1, &handle);
+	});
 }
 
 redox::graphics::DescriptorSetView::DescriptorSetView(VkDescriptorSet handle) : _handle(handle) {
@@ -70,7 +137,7 @@ redox::graphics::DescriptorSetView::DescriptorSetView(VkDescriptorSet handle) :
 
 void redox::graphics::DescriptorSetView::bind(const CommandBufferView& commandBuffer, const Pipeline& pipeline) {
 	vkCmdBindDescriptorSets(commandBuffer.handle(),
-		VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout(), 0, 1, &_handle, 0, nullptr);
+		pipeline.bind_point(), pipeline.layout(), 0, 1, &_handle, 0, nullptr);
 }
 
 void redox::graphics::DescriptorSetView::bind_resource(const Texture& texture, uint32_t bindingPoint) {
@@ -110,3 +177,22 @@ void redox::graphics::DescriptorSetView::bind_resource(const UniformBuffer& ubo,
 
 	vkUpdateDescriptorSets(Graphics::instance().device(), 1, &writeSet, 0, nullptr);
 }
+
+void redox::graphics::DescriptorSetView::bind_storage(VkBuffer buffer, uint32_t bindingPoint) {
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet writeSet{};
+	writeSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writeSet.dstSet = _handle;
+	writeSet.dstBinding = bindingPoint;
+	writeSet.dstArrayElement = 0;
+	writeSet.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	writeSet.descriptorCount = 1;
+	writeSet.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(Graphics::instance().device(), 1, &writeSet, 0, nullptr);
+}
@@ -24,15 +24,19 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #pragma once
+#include "core\core.h"
 #include "core\non_copyable.h"
 #include "vulkan.h"
 
+#include <mutex> //std::mutex
+
 namespace redox::graphics {
 	class Graphics;
 	class CommandBufferView;
 	class Texture;
 	class Pipeline;
 	struct UniformBuffer;
+	struct DescriptorPoolState;
 
 	class DescriptorSetView {
 	public:
@@ -41,19 +45,46 @@ namespace redox::graphics {
 		void bind(const CommandBufferView& commandBuffer, const Pipeline& pipeline);
 		void bind_resource(const Texture& texture, uint32_t bindingPoint);
 		void bind_resource(const UniformBuffer& ubo, uint32_t bindingPoint);
+		void bind_storage(VkBuffer buffer, uint32_t bindingPoint);
 
-	private:
+	protected:
 		VkDescriptorSet _handle;
 	};
 
+	//Owns a set of a DescriptorPool. It is freed through the release queue, frames in flight may
+	//still bind it, and keeps the pool alive until then
+	class DescriptorSet : public DescriptorSetView {
+	public:
+		DescriptorSet(SharedPtr<DescriptorPoolState> pool, VkDescriptorSet handle);
+		DescriptorSet(DescriptorSet&& other) noexcept;
+		~DescriptorSet();
+
+		DescriptorSet(const DescriptorSet&) = delete;
+		DescriptorSet& operator=(const DescriptorSet&) = delete;
+		DescriptorSet& operator=(DescriptorSet&&) = delete;
+
+	private:
+		SharedPtr<DescriptorPoolState> _pool;
+	};
+
+	//Grows by another VkDescriptorPool of the same size whenever the existing ones are exhausted,
+	//e.g. while a reloaded model and its replacement are both alive
 	class DescriptorPool : public NonCopyable {
 	public:
-		DescriptorPool(uint32_t maxSets, uint32_t maxImages, uint32_t maxUBOs);
+		DescriptorPool(uint32_t maxSets, uint32_t maxImages, uint32_t maxUBOs, uint32_t maxSSBOs);
 		~DescriptorPool();
 
-		DescriptorSetView allocate(VkDescriptorSetLayout layout) const;
+		DescriptorSet allocate(VkDescriptorSetLayout layout) const;
 
 	private:
-		VkDescriptorPool _handle;
+		SharedPtr<DescriptorPoolState> _create_pool() const;
+
+		uint32_t _maxSets;
+		uint32_t _maxImages;
+		uint32_t _maxUBOs;
+		uint32_t _maxSSBOs;
+
+		mutable std::mutex _mutex;
+		mutable redox::Buffer<SharedPtr<DescriptorPoolState>> _pools;
 	};
 }
\ No newline at end of file
@@ -26,82 +26,498 @@ SOFTWARE.
 #include "model_factory.h"
 
 #include "resources/importer/gltf_importer.h"
+#include "resources/importer/mesh_optimizer.h"
 #include "graphics/vulkan/graphics.h"
 #include "core/application.h"
+#include "core/hash/xxhash.h"
+#include "core/serialization/binary_stream.h"
 
-redox::graphics::ModelFactory::ModelFactory(const DescriptorPool* dp, PipelineCache* pc) 
-: _descriptorPool(dp), _pipelineCache(pc) {
-}
+#include <algorithm> //std::min
+#include <future> //std::future
+#include <optional> //std::optional
 
-redox::ResourceHandle<redox::IResource> redox::graphics::ModelFactory::load(const Path& path) {
-	GLTFImporter importer(path);
+namespace {
+	//Bump whenever the cached payload layout or the vertex conversion changes
+	constexpr redox::u32 IMPORTER_VERSION = 5;
 
-	//import meshes
-	redox::Buffer<ResourceHandle<Mesh>> meshes;
-	meshes.reserve(importer.mesh_count());
+	struct imported_mesh {
+		redox::Buffer<redox::graphics::MeshVertex> vertices;
+		redox::Buffer<uint32_t> indices;
+		redox::Buffer<redox::graphics::SubMesh> submeshes;
+		redox::Buffer<redox::graphics::Meshlet> meshlets;
+	};
 
-	for (std::size_t i = 0; i < importer.mesh_count(); i++) {
-		auto mesh = importer.import_mesh(i);
+	struct imported_material {
+		redox::String albedoMap;
+		redox::String normalMap;
+	};
+
+	struct source_file {
+		redox::String path; //Relative to the gltf file
+		redox::u64 hash;
+	};
+
+	struct imported_model {
+		redox::Buffer<source_file> sources;
+		redox::Buffer<imported_mesh> meshes;
+		redox::Buffer<imported_material> materials;
+	};
+
+	struct import_settings {
+		bool optimizeMeshes;
+		bool optimizeOverdraw;
+		bool buildMeshlets;
+		redox::u32 lodLevels;
+		redox::f32 lodReduction;
+		redox::f32 lodMaxError;
+
+		//Seeds the content hash so each combination gets its own cache entry
+		redox::u64 cache_seed() const {
+			redox::f32 lod[] = { lodReduction, lodMaxError };
+			redox::u64 flags = (optimizeMeshes ? 0x1 : 0x0) | (optimizeOverdraw ? 0x2 : 0x0) | (buildMeshlets ? 0x4 : 0x0) |
+				(static_cast<redox::u64>(lodLevels) << 8);
+			return redox::hash::xxh64(lod, sizeof(lod), flags);
+		}
+	};
+
+	//Submeshes own separate vertex ranges and are optimized one by one
+	void optimize_mesh(redox::GLTFImporter::mesh_data& mesh, const import_settings& settings, const redox::Path& path) {
+		namespace opt = redox::mesh_optimizer;
+		using redox::graphics::MeshVertex;
 
 		redox::Buffer<MeshVertex> vertices;
-		vertices.reserve(mesh.vertexCount);
+		redox::Buffer<uint32_t> indices;
+		vertices.reserve(mesh.vertices.size());
+		indices.reserve(mesh.indices.size());
 
-		for (std::size_t i = 0; i < vertices.capacity(); ++i) {
-			vertices.push_back({
-				{ mesh.positions[i * 3 + 0], mesh.positions[i * 3 + 1], mesh.positions[i * 3 + 2] },
-				( mesh.normals.empty() ? math::Vec3f{} : math::Vec3f{ mesh.normals[i * 3 + 0], mesh.normals[i * 3 + 1], mesh.normals[i * 3 + 2] }),
-				( mesh.texcoords.empty() ? math::Vec2f{} : math::Vec2f{ mesh.texcoords[i * 2 + 0], mesh.texcoords[i * 2 + 1] })
-			});
+		redox::f64 missesBefore = 0.0, missesAfter = 0.0;
+		std::size_t triangles = 0;
+
+		for (auto& sm : mesh.submeshes) {
+			auto vertexBegin = mesh.vertices.begin() + sm.attributeOffset;
+			auto indexBegin = mesh.indices.begin() + sm.indexOffset;
+			redox::Buffer<MeshVertex> v(vertexBegin, vertexBegin + sm.attributeCount);
+			redox::Buffer<uint32_t> i(indexBegin, indexBegin + sm.indexCount);
+			auto triangleCount = i.size() / 3;
+
+			missesBefore += opt::acmr(i.data(), i.size(), v.size()) * triangleCount;
+
+			v.resize(opt::deduplicate_vertices(v.data(), v.size(), i.data(), i.size()));
+			opt::optimize_vertex_cache(i.data(), i.size(), v.size());
+			if (settings.optimizeOverdraw) {
+				opt::optimize_overdraw(i.data(), i.size(), v.data(), v.size());
+			}
+			v.resize(opt::optimize_vertex_fetch(v.data(), v.size(), i.data(), i.size()));
+
+			missesAfter += opt::acmr(i.data(), i.size(), v.size()) * triangleCount;
+			triangles += triangleCount;
+
+			sm.attributeOffset = vertices.size();
+			sm.attributeCount = v.size();
+			sm.indexOffset = indices.size();
+
+			vertices.insert(vertices.end(), v.begin(), v.end());
+			indices.insert(indices.end(), i.begin(), i.end());
+		}
+
+		if (triangles > 0) {
+			RDX_LOG("Optimized {0} ({1}): ACMR {2} -> {3}, {4} -> {5} vertices",
+				path.filename(), mesh.name, missesBefore / triangles, missesAfter / triangles,
+				static_cast<redox::u64>(mesh.vertices.size()), static_cast<redox::u64>(vertices.size()));
+		}
+
+		mesh.vertices = std::move(vertices);
+		mesh.indices = std::move(indices);
+	}
+
+	//Each level is simplified from the previous one and appended behind the full detail indices,
+	//they keep indexing the submesh vertices so the vertex buffer is shared by all levels
+	void generate_lods(redox::graphics::SubMesh& submesh, redox::Buffer<uint32_t>& indices,
+		const redox::graphics::MeshVertex* vertices, std::size_t vertexCount, const import_settings& settings) {
+		namespace opt = redox::mesh_optimizer;
+
+		auto first = indices.begin() + submesh.indexOffset;
+		redox::Buffer<uint32_t> source(first, first + submesh.indexCount);
+
+		auto extent = opt::extent(vertices, vertexCount);
+		auto levels = std::min<std::size_t>(settings.lodLevels, redox::graphics::MAX_MESH_LODS);
+		redox::f32 error = 0.0f; //Relative to the extent, summed up over the levels
+
+		while (submesh.lodCount < levels) {
+			auto target = static_cast<std::size_t>(source.size() * settings.lodReduction);
+			redox::f32 levelError = 0.0f;
+
+			redox::Buffer<uint32_t> lod(source.size());
+			lod.resize(opt::simplify(lod.data(), source.data(), source.size(), vertices, vertexCount,
+				target, settings.lodMaxError - error, &levelError));
+
+			//Locked borders or the error budget keep it too close to the previous level
+			if (lod.empty() || lod.size() * 10 > source.size() * 9) {
+				break;
+			}
+
+			opt::optimize_vertex_cache(lod.data(), lod.size(), vertexCount);
+			error += levelError;
+
+			submesh.lods[submesh.lodCount++] = {
+				static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()), error * extent
+			};
+
+			indices.insert(indices.end(), lod.begin(), lod.end());
+			source = std::move(lod);
+		}
+	}
+
+	//Meshlets are index ranges in the mesh index buffer, their offsets are made absolute here
+	void append_meshlets(imported_mesh& mesh, uint32_t indexOffset, uint32_t indexCount,
+		const redox::graphics::MeshVertex* vertices, std::size_t vertexCount,
+		uint32_t& meshletOffset, uint32_t& meshletCount) {
+
+		auto meshlets = redox::mesh_optimizer::build_meshlets(
+			mesh.indices.data() + indexOffset, indexCount, vertices, vertexCount);
+
+		for (auto& meshlet : meshlets) {
+			meshlet.indexOffset += indexOffset;
+		}
+
+		meshletOffset = static_cast<uint32_t>(mesh.meshlets.size());
+		meshletCount = static_cast<uint32_t>(meshlets.size());
+		mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+	}
+
+	redox::u64 hash_file(const redox::Path& path) {
+		auto file = redox::ResourceManager::instance()->vfs()->read(path);
+		return redox::hash::xxh64(file.data(), file.size());
+	}
+
+	//Work fanned out to the thread pool, every task has finished before this goes out of scope
+	class task_group : public redox::NonCopyable {
+	public:
+		task_group() :
+			_pool(redox::Application::instance->thread_pool()),
+			_group(_pool->create_group()) {
+		}
+
+		~task_group() {
+			for (auto& task : _tasks) {
+				_pool->wait(task, _group);
+			}
+		}
+
+		//Ahead of queued loads so a started model finishes first, nested loads stay tracked as dependencies
+		void run(redox::Function<void()> fn) {
+			auto task = redox::ResourceManager::instance()->bind_load_context(std::move(fn));
+			_tasks.push_back(_pool->submit(std::move(task), redox::TaskPriority::HIGH, _group));
+		}
+
+		//Helps out with this group's tasks until every one is done, then rethrows the first failure
+		void wait() {
+			for (auto& task : _tasks) {
+				_pool->wait(task, _group);
+			}
+
+			auto tasks = std::move(_tasks);
+			_tasks.clear();
+
+			for (auto& task : tasks) {
+				task.get();
+			}
+		}
+
+	private:
+		redox::ThreadPool* _pool;
+		redox::u64 _group;
+		redox::Buffer<std::future<void>> _tasks;
+	};
+
+	imported_mesh convert_mesh(redox::GLTFImporter::mesh_data mesh, const import_settings& settings, const redox::Path& path) {
+		using namespace redox::graphics;
+
+		if (settings.optimizeMeshes) {
+			optimize_mesh(mesh, settings, path);
 		}
 
-		redox::Buffer<SubMesh> submeshes;
-		submeshes.reserve(mesh.submeshes.size());
+		imported_mesh output;
+
+		output.vertices = std::move(mesh.vertices);
+		output.indices = std::move(mesh.indices);
+		output.submeshes.reserve(mesh.submeshes.size());
 
 		for (auto& sm : mesh.submeshes) {
 			SubMesh submesh{};
 			submesh.materialIndex = static_cast<uint32_t>(sm.materialIndex);
 			submesh.indexCount = static_cast<uint32_t>(sm.indexCount);
 			submesh.indexOffset = static_cast<uint32_t>(sm.indexOffset);
+			submesh.vertexOffset = static_cast<int32_t>(sm.attributeOffset);
+
+			auto vertices = output.vertices.data() + sm.attributeOffset;
+
+			if (settings.lodLevels > 0) {
+				generate_lods(submesh, output.indices, vertices, sm.attributeCount, settings);
+			}
+
+			if (settings.buildMeshlets) {
+				append_meshlets(output, submesh.indexOffset, submesh.indexCount, vertices, sm.attributeCount,
+					submesh.meshletOffset, submesh.meshletCount);
+
+				for (uint32_t level = 0; level < submesh.lodCount; ++level) {
+					auto& lod = submesh.lods[level];
+					append_meshlets(output, lod.indexOffset, lod.indexCount, vertices, sm.attributeCount,
+						lod.meshletOffset, lod.meshletCount);
+				}
+			}
+
+			output.submeshes.push_back(submesh);
+		}
+
+		return output;
+	}
+
+	//Materials are read right away, meshes are converted on the pool straight into their slot of model
+	void import_gltf(redox::GLTFImporter& importer, const redox::Path& path, const import_settings& settings,
+		imported_model& model, task_group& tasks) {
+
+		for (const auto& file : importer.buffer_files()) {
+			model.sources.push_back({ file.lexically_relative(path.parent_path()).generic_string(), hash_file(file) });
+		}
 
-			submeshes.push_back(submesh);
+		model.meshes.resize(importer.mesh_count());
+
+		for (std::size_t i = 0; i < importer.mesh_count(); i++) {
+			tasks.run([&importer, &path, &settings, &output = model.meshes[i], i]() {
+				output = convert_mesh(importer.import_mesh(i), settings, path);
+			});
+		}
+
+		model.materials.reserve(importer.material_count());
+
+		for (std::size_t i = 0; i < importer.material_count(); i++) {
+			auto impMat = importer.import_material(i);
+			model.materials.push_back({ std::move(impMat.albedoMap), std::move(impMat.normalMap) });
+		}
+	}
+
+	void serialize(const imported_model& model, redox::BinaryWriter& writer) {
+		writer.write(static_cast<redox::u32>(model.sources.size()));
+		for (const auto& source : model.sources) {
+			writer.write_string(source.path);
+			writer.write(source.hash);
+		}
+
+		writer.write(static_cast<redox::u32>(model.meshes.size()));
+		for (const auto& mesh : model.meshes) {
+			writer.write_array(mesh.vertices);
+			writer.write_array(mesh.indices);
+			writer.write_array(mesh.submeshes);
+			writer.write_array(mesh.meshlets);
+		}
+
+		writer.write(static_cast<redox::u32>(model.materials.size()));
+		for (const auto& material : model.materials) {
+			writer.write_string(material.albedoMap);
+			writer.write_string(material.normalMap);
+		}
+	}
+
+	imported_model deserialize(redox::BinaryReader& reader) {
+		imported_model model;
+
+		model.sources.resize(reader.read<redox::u32>());
+		for (auto& source : model.sources) {
+			source.path = reader.read_string();
+			source.hash = reader.read<redox::u64>();
+		}
+
+		model.meshes.resize(reader.read<redox::u32>());
+		for (auto& mesh : model.meshes) {
+			mesh.vertices = reader.read_array<redox::graphics::MeshVertex>();
+			mesh.indices = reader.read_array<uint32_t>();
+			mesh.submeshes = reader.read_array<redox::graphics::SubMesh>();
+			mesh.meshlets = reader.read_array<redox::graphics::Meshlet>();
+		}
+
+		model.materials.resize(reader.read<redox::u32>());
+		for (auto& material : model.materials) {
+			material.albedoMap = reader.read_string();
+			material.normalMap = reader.read_string();
+		}
+
+		return model;
+	}
+
+	//Looks up the converted model, valid as long as none of the buffers it was built from changed
+	std::optional<imported_model> load_cached(redox::DerivedDataCache* cache, const redox::Path& path, redox::u64 contentHash) {
+		auto cached = cache->load("models", contentHash, IMPORTER_VERSION);
+		if (!cached) {
+			return std::nullopt;
+		}
+
+		auto resources = redox::ResourceManager::instance();
+
+		try {
+			redox::BinaryReader reader(cached->data(), cached->size());
+			auto model = deserialize(reader);
+
+			for (const auto& source : model.sources) {
+				auto file = path.parent_path() / source.path;
+				if (!resources->vfs()->exists(file) || hash_file(file) != source.hash) {
+					return std::nullopt;
+				}
+			}
+
+			//The importer records these on a cold load
+			for (const auto& source : model.sources) {
+				resources->add_dependency(path.parent_path() / source.path);
+			}
+
+			return model;
+		}
+		catch (const redox::Exception&) {
+			return std::nullopt;
+		}
+	}
+}
+
+redox::graphics::ModelFactory::ModelFactory(const DescriptorPool* dp, PipelineCache* pc) 
+: _descriptorPool(dp), _pipelineCache(pc) {
+	auto config = Application::instance->config();
+	_optimizeMeshes = config->get("Resources", "OptimizeMeshes");
+	_optimizeOverdraw = config->get("Resources", "OptimizeOverdraw");
+	_buildMeshlets = config->get("Resources", "BuildMeshlets");
+	_lodLevels = config->get("Resources", "LodLevels");
+	_lodReduction = config->get("Resources", "LodReduction");
+	_lodMaxError = config->get("Resources", "LodMaxError");
+}
+
+redox::ResourceHandle<redox::IResource> redox::graphics::ModelFactory::load(const Path& path) {
+	auto resources = ResourceManager::instance();
+	auto cache = resources->derived_data();
+
+	//Mapped once, hashed for the cache and parsed in place by the importer
+	auto source = resources->vfs()->read(path);
+	import_settings settings{ _optimizeMeshes, _optimizeOverdraw, _buildMeshlets, _lodLevels, _lodReduction, _lodMaxError };
+	std::optional<imported_model> model;
+	std::optional<GLTFImporter> importer;
+	u64 contentHash = 0;
+
+	if (cache) {
+		contentHash = hash::xxh64(source.data(), source.size(), settings.cache_seed());
+		model = load_cached(cache, path, contentHash);
+	}
+
+	task_group meshTasks;
+	bool imported = !model;
+
+	if (imported) {
+		importer.emplace(path, std::move(source));
+		import_gltf(*importer, path, settings, model.emplace(), meshTasks);
+	}
+
+	//Textures decode concurrently with the mesh conversion. Materials sharing a map load it once,
+	//two tasks of this model loading the same path would only end up waiting on each other
+	struct texture_load {
+		Path path;
+		bool placeholder;
+		ResourceHandle<SampleTexture> texture;
+	};
+
+	struct material_textures {
+		std::optional<std::size_t> albedo;
+		std::optional<std::size_t> normal;
+	};
+
+	redox::Buffer<texture_load> textureLoads;
+	redox::Buffer<material_textures> textures(model->materials.size());
+
+	auto add_texture = [&textureLoads](const String& uri, bool placeholder) {
+		auto path = "textures" / Path(uri).filename();
+		for (std::size_t i = 0; i < textureLoads.size(); ++i) {
+			if (textureLoads[i].path == path && textureLoads[i].placeholder == placeholder) {
+				return i;
+			}
 		}
 
-		meshes.push_back(std::make_shared<Mesh>(
-			std::move(vertices), std::move(mesh.indices), std::move(submeshes)));
+		textureLoads.push_back({ std::move(path), placeholder, nullptr });
+		return textureLoads.size() - 1;
+	};
+
+	//Maps the material doesn't reference are left out, its shader variant doesn't sample them
+	for (std::size_t i = 0; i < model->materials.size(); ++i) {
+		const auto& impMat = model->materials[i];
+		if (!impMat.albedoMap.empty()) {
+			textures[i].albedo = add_texture(impMat.albedoMap, true);
+		}
+		if (!impMat.normalMap.empty()) {
+			textures[i].normal = add_texture(impMat.normalMap, false);
+		}
+	}
+
+	//Missing normal maps are dropped, a placeholder would distort the shading
+	task_group textureTasks;
+	for (auto& load : textureLoads) {
+		textureTasks.run([&load]() {
+			load.texture = load.placeholder ?
+				ResourceManager::instance()->load<SampleTexture>(load.path, "builtin:textures/uvcheck.png") :
+				ResourceManager::instance()->load<SampleTexture>(load.path);
+		});
+	}
+
+	meshTasks.wait();
+
+	if (imported && cache) {
+		BinaryWriter writer;
+		serialize(*model, writer);
+		cache->store("models", contentHash, IMPORTER_VERSION, writer.buffer().data(), writer.buffer().size());
+	}
+
+	//GPU objects are only created here, on the loading thread
+	redox::Buffer<ResourceHandle<Mesh>> meshes;
+	meshes.reserve(model->meshes.size());
+
+	for (auto& mesh : model->meshes) {
+		auto& handle = meshes.emplace_back(std::make_shared<Mesh>(
+			std::move(mesh.vertices), std::move(mesh.indices), std::move(mesh.submeshes), mesh.meshlets));
+
+		if (handle->meshlet_count() > 0) {
+			auto pipeline = _pipelineCache->load(PipelineType::CLUSTER_CULL_PIPELINE);
+			auto dset = _descriptorPool->allocate(pipeline->descriptorLayout());
+			handle->init_culling(std::move(pipeline), std::move(dset));
+		}
 	}
 
 	//import materials
 	redox::Buffer<ResourceHandle<Material>> materials;
-	materials.reserve(importer.material_count());
+	materials.reserve(model->materials.size());
 
-	auto resources = ResourceManager::instance();
+	textureTasks.wait();
 
-	for (std::size_t i = 0; i < importer.material_count(); i++) {
-		auto impMat = importer.import_material(i);
-		auto pipeline = _pipelineCache->load(PipelineType::DEFAULT_MESH_PIPELINE);
-		auto dset = _descriptorPool->allocate(pipeline->descriptorLayout());
+	for (const auto& maps : textures) {
+		auto albedo = maps.albedo ? textureLoads[*maps.albedo].texture : nullptr;
+		auto normal = maps.normal ? textureLoads[*maps.normal].texture : nullptr;
+		auto source = [&textureLoads](std::size_t i) {
+			return ResourceManager::instance()->resolve_path(textureLoads[i].path);
+		};
 
-		auto& material = materials.emplace_back(std::make_shared<Material>(pipeline, dset));
+		ShaderPermutation permutation;
+		if (albedo)
+			permutation.keywords |= ShaderKeywords::ALBEDO_MAP;
+		if (normal)
+			permutation.keywords |= ShaderKeywords::NORMAL_MAP;
 
-		Path albedoPath(impMat.albedoMap);
-		auto albedo = resources->load<SampleTexture>(
-			"textures" / albedoPath.filename(),
-			"builtin:textures/uvcheck.png"
-		);
-		material->set_texture(TextureKeys::ALBEDO, std::move(albedo));
+		auto pipeline = _pipelineCache->load(PipelineType::DEFAULT_MESH_PIPELINE, permutation);
+		auto dset = _descriptorPool->allocate(pipeline->descriptorLayout());
 
-		Path normalPath(impMat.normalMap);
-		auto normal = resources->load<SampleTexture>(
-			"textures" / normalPath.filename(),
-			"builtin:textures/uvcheck.png"
-		);
-		material->set_texture(TextureKeys::NORMAL, std::move(normal));
+		auto& material = materials.emplace_back(std::make_shared<Material>(pipeline, std::move(dset)));
+		if (albedo)
+			material->set_texture(TextureKeys::ALBEDO, std::move(albedo), source(*maps.albedo));
+		if (normal)
+			material->set_texture(TextureKeys::NORMAL, std::move(normal), source(*maps.normal));
 	}
 
 	return std::make_shared<Model>(std::move(meshes), std::move(materials));
 }
 
 bool redox::graphics::ModelFactory::supports_ext(const Path& ext) {
-	return (ext == ".gltf");
+	return (ext == ".gltf" || ext == ".glb");
 }
 
@@ -42,5 +42,11 @@ namespace redox::graphics {
 	private:
 		const DescriptorPool* _descriptorPool;
 		PipelineCache* _pipelineCache;
+		bool _optimizeMeshes;
+		bool _optimizeOverdraw;
+		bool _buildMeshlets;
+		u32 _lodLevels;
+		f32 _lodReduction;
+		f32 _lodMaxError;
 	};
 }
\ No newline at end of file
@@ -24,25 +24,15 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "shader_factory.h"
-#include <resources/resource_manager.h>
 
 #include <algorithm> //std::find
 
 redox::ResourceHandle<redox::IResource> redox::graphics::ShaderFactory::load(const Path& path) {
-
-	auto outputDir = path.parent_path() / "compiled";
-	if (!io::exists(outputDir)) {
-		io::create_directory(outputDir);
-	}
-
-	auto output = ShaderCompiler::compile(path, outputDir, true);
-	io::File fstream(output, io::File::Mode::READ | io::File::Mode::THROW_IF_INVALID);
-
-	auto buffer = fstream.read();
-	return std::make_shared<Shader>(std::move(buffer));
+	//Mapped cache entries keep the SPIR-V words 4 byte aligned
+	return std::make_shared<Shader>(ShaderCompiler::compile(path));
 }
 
 bool redox::graphics::ShaderFactory::supports_ext(const Path& ext) {
-	Array<StringView, 4> supported = { ".frag", ".vert", ".geom" };
+	Array<StringView, 4> supported = { ".frag", ".vert", ".geom", ".comp" };
 	return std::find(supported.begin(), supported.end(), ext) != supported.end();
 }
@@ -24,15 +24,33 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "texture_factory.h"
+#include <resources/resource_manager.h>
+#include <resources/importer/texture_compressor.h>
+#include <resources/importer/mip_generator.h>
+#include <resources/importer/ktx.h>
+#include <graphics/vulkan/graphics.h>
+#include <graphics/vulkan/texture_streamer.h>
+#include <core/application.h>
+#include <core/hash/xxhash.h>
+#include <core/serialization/binary_stream.h>
+
+#include <algorithm> //std::all_of, std::max, std::transform
+#include <cctype> //std::tolower
+#include <future> //std::future
+#include <optional> //std::optional
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <thirdparty/stbimage/stb_image.h>
 
 namespace {
-	bool load_image(const redox::Path& path, redox::Buffer<redox::byte>& buffer, redox::i32& width, redox::i32& height) {
+	//Bump whenever the cached payload layout or the decode settings change
+	constexpr redox::u32 IMPORTER_VERSION = 3;
+
+	using redox::texture_compressor::BlockFormat;
+
+	bool load_image(const redox::io::FileView& file, redox::Buffer<redox::byte>& buffer, redox::i32& width, redox::i32& height) {
 		[[maybe_unused]] redox::i32 chan;
-		auto ps = path.string();
-		stbi_uc* pixels = stbi_load(ps.c_str(),
+		stbi_uc* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()),
 			&width, &height, &chan, STBI_rgb_alpha);
 
 		if (pixels == nullptr) {
@@ -48,23 +66,271 @@ namespace {
 		buffer.assign(pixels, pixels + size);
 		return true;
 	}
+
+	//Tangent space normal maps by the usual naming conventions
+	bool is_normal_map(const redox::Path& path) {
+		auto stem = path.stem().string();
+		std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) {
+			return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		});
+
+		for (redox::StringView suffix : { "normal", "_n", "_nrm", "_ddn" }) {
+			if (stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	BlockFormat pick_block_format(redox::graphics::TextureCompression compression,
+		bool normalMap, const redox::Buffer<redox::byte>& pixels) {
+
+		if (normalMap) {
+			return BlockFormat::BC5;
+		}
+
+		if (compression == redox::graphics::TextureCompression::BC7) {
+			return BlockFormat::BC7;
+		}
+
+		for (std::size_t i = 3; i < pixels.size(); i += 4) {
+			if (pixels[i] != 255) {
+				return BlockFormat::BC3;
+			}
+		}
+		return BlockFormat::BC1;
+	}
+
+	VkFormat vk_format(BlockFormat format) {
+		switch (format) {
+		case BlockFormat::BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case BlockFormat::BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case BlockFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case BlockFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case BlockFormat::BC7: return VK_FORMAT_BC7_UNORM_BLOCK;
+		}
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	//Bands of block rows are encoded across the pool. They form their own group, the calling
+	//thread only helps with its own bands and never queues behind unrelated loads
+	redox::Buffer<redox::byte> compress(const redox::Buffer<redox::byte>& pixels,
+		redox::u32 width, redox::u32 height, BlockFormat format) {
+		namespace tc = redox::texture_compressor;
+
+		redox::Buffer<redox::byte> output(tc::compressed_size(format, width, height));
+
+		auto pool = redox::Application::instance->thread_pool();
+		auto group = pool->create_group();
+		auto rows = (height + tc::BLOCK_DIMENSION - 1) / tc::BLOCK_DIMENSION;
+		auto bandRows = std::max(rows / static_cast<redox::u32>(pool->size() * 4 + 1), 1u);
+
+		redox::Buffer<std::future<void>> bands;
+		for (redox::u32 first = 0; first < rows; first += bandRows) {
+			bands.push_back(pool->submit([&, first]() {
+				tc::compress_rows(pixels.data(), width, height, format, first, bandRows, output.data());
+			}, redox::TaskPriority::HIGH, group));
+		}
+
+		for (auto& band : bands) {
+			pool->wait(band, group);
+		}
+
+		return output;
+	}
+
+	//Pre-encoded textures go to the GPU as they are, including their mip chain
+	void load_ktx2(const redox::io::FileView& file, redox::Buffer<redox::byte>& data,
+		redox::Buffer<VkDeviceSize>& levelOffsets, VkFormat& format, VkExtent2D& extent) {
+		using namespace redox::graphics;
+
+		auto info = redox::ktx::parse(file.data(), file.size());
+		format = static_cast<VkFormat>(info.vkFormat);
+		extent = { info.width, info.height };
+
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(Graphics::instance().physical_device(), format, &properties);
+		if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+			throw redox::Exception("ktx2 texture format not supported by the device");
+		}
+
+		for (const auto& level : info.levels) {
+			levelOffsets.push_back(data.size());
+			data.insert(data.end(), file.data() + level.offset, file.data() + level.offset + level.size);
+		}
+	}
+}
+
+redox::graphics::TextureFactory::TextureFactory(TextureStreamer* streamer) :
+	_streamer(streamer) {
+	auto compression = Application::instance->config()->get("Resources", "TextureCompression").as<String>();
+
+	if (compression == "None") {
+		_compression = TextureCompression::NONE;
+	}
+	else if (compression == "BC1") {
+		_compression = TextureCompression::BC1;
+	}
+	else if (compression == "BC7") {
+		_compression = TextureCompression::BC7;
+	}
+	else {
+		throw Exception("unknown texture compression, expected None, BC1 or BC7");
+	}
+
+	_generateMipmaps = Application::instance->config()->get("Resources", "GenerateMipmaps");
+
+	if (_compression != TextureCompression::NONE && !Graphics::instance().supports_block_compression()) {
+		RDX_LOG("Device lacks BC texture support, textures stay uncompressed", ConsoleColor::RED);
+		_compression = TextureCompression::NONE;
+	}
 }
 
 redox::ResourceHandle<redox::IResource> redox::graphics::TextureFactory::load(const Path& path) {
+	auto resources = ResourceManager::instance();
+	auto cache = resources->derived_data();
+	auto source = resources->vfs()->read(path);
+
+	bool ktx2 = path.extension() == ".ktx2";
+	bool normalMap = !ktx2 && is_normal_map(path);
+	auto settings = static_cast<u64>(_compression) | (normalMap ? 0x100 : 0x0) | (_generateMipmaps ? 0x200 : 0x0);
+	auto contentHash = hash::xxh64(source.data(), source.size(), settings);
+
+	//Byte identical files imported the same way are decoded and uploaded once
+	if (auto texture = _find_shared(contentHash, path)) {
+		return texture;
+	}
+
+	if (ktx2) {
+		redox::Buffer<byte> data;
+		redox::Buffer<VkDeviceSize> levelOffsets;
+		VkFormat format;
+		VkExtent2D extent;
+		load_ktx2(source, data, levelOffsets, format, extent);
+		return _create_texture(contentHash, path, std::move(data), format, extent, std::move(levelOffsets));
+	}
+
 	i32 width, height;
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
 	redox::Buffer<byte> buffer;
-	if (!load_image(path, buffer, width, height)) {
+	redox::Buffer<VkDeviceSize> levelOffsets;
+
+	//Decoded and block compressed pixels are cached, warm loads skip the decoder and the encoder
+	if (auto cached = cache ? cache->load("textures", contentHash, IMPORTER_VERSION) : std::nullopt) {
+		try {
+			BinaryReader reader(cached->data(), cached->size());
+			width = reader.read<i32>();
+			height = reader.read<i32>();
+			format = static_cast<VkFormat>(reader.read<u32>());
+			levelOffsets = reader.read_array<VkDeviceSize>();
+			buffer = reader.read_array<byte>();
+		}
+		catch (const Exception&) {
+			buffer.clear();
+		}
+	}
+
+	if (buffer.empty()) {
+		if (!load_image(source, buffer, width, height)) {
+			return nullptr;
+		}
+
+		//The chain is filtered from the uncompressed pixels, each level is encoded on its own
+		redox::Buffer<mip_generator::MipLevel> chain;
+		if (_generateMipmaps) {
+			chain = mip_generator::generate(buffer.data(), static_cast<u32>(width), static_cast<u32>(height), normalMap);
+		}
+
+		std::optional<BlockFormat> blockFormat;
+		if (_compression != TextureCompression::NONE) {
+			blockFormat = pick_block_format(_compression, normalMap, buffer);
+			format = vk_format(*blockFormat);
+		}
+
+		auto encode = [&](redox::Buffer<byte> pixels, u32 levelWidth, u32 levelHeight) {
+			if (blockFormat) {
+				return compress(pixels, levelWidth, levelHeight, *blockFormat);
+			}
+			return pixels;
+		};
+
+		buffer = encode(std::move(buffer), static_cast<u32>(width), static_cast<u32>(height));
+		levelOffsets = { 0 };
+
+		for (auto& level : chain) {
+			levelOffsets.push_back(buffer.size());
+			auto data = encode(std::move(level.pixels), level.width, level.height);
+			buffer.insert(buffer.end(), data.begin(), data.end());
+		}
+
+		if (cache) {
+			BinaryWriter writer;
+			writer.write(width);
+			writer.write(height);
+			writer.write(static_cast<u32>(format));
+			writer.write_array(levelOffsets);
+			writer.write_array(buffer);
+			cache->store("textures", contentHash, IMPORTER_VERSION, writer.buffer().data(), writer.buffer().size());
+		}
+	}
+
+	return _create_texture(contentHash, path, std::move(buffer), format,
+		VkExtent2D{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) },
+		std::move(levelOffsets));
+}
+
+redox::ResourceHandle<redox::IResource> redox::graphics::TextureFactory::_find_shared(u64 contentHash, const Path& path) {
+	std::lock_guard lock(_sharedMutex);
+
+	auto it = _shared.find(contentHash);
+	if (it == _shared.end()) {
 		return nullptr;
 	}
 
-	return std::make_shared<SampleTexture>(
-		std::move(buffer), VK_FORMAT_R8G8B8A8_UNORM,
-		VkExtent2D{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) 
-	});
+	auto texture = it->second.texture.lock();
+	if (!texture) {
+		_shared.erase(it);
+		return nullptr;
+	}
+
+	auto saved = texture->resident_size(0);
+	_sharedBytes += saved;
+
+	RDX_LOG("Texture {0} is identical to {1}, sharing it ({2} KB saved, {3} KB in total)",
+		path, it->second.path, saved / 1024, _sharedBytes / 1024);
+
+	return texture;
+}
+
+redox::ResourceHandle<redox::IResource> redox::graphics::TextureFactory::_create_texture(u64 contentHash,
+	const Path& path, redox::Buffer<byte> pixels, VkFormat format, const VkExtent2D& extent,
+	redox::Buffer<VkDeviceSize> levelOffsets) {
+
+	//Streamed textures start out with their small levels, the streamer refines them once drawn
+	auto levels = static_cast<u32>(levelOffsets.size());
+	auto residentMip = _streamer ? _streamer->initial_mip(extent, levels) : 0;
+
+	auto texture = std::make_shared<SampleTexture>(std::move(pixels), format, extent,
+		std::move(levelOffsets), residentMip);
+
+	{
+		//Loads of the same payload may race, the first one to finish is kept
+		std::lock_guard lock(_sharedMutex);
+		auto& shared = _shared[contentHash];
+		if (auto existing = shared.texture.lock()) {
+			return existing;
+		}
+		shared = shared_texture{ path, texture };
+	}
+
+	if (_streamer) {
+		_streamer->add(texture);
+	}
+	return texture;
 }
 
 bool redox::graphics::TextureFactory::supports_ext(const Path& ext) {
-	Array<StringView, 9> supported = { ".jpeg", ".jpg", ".png", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic" };
+	Array<StringView, 10> supported = { ".jpeg", ".jpg", ".png", ".tga", ".bmp", ".psd", ".gif", ".hdr", ".pic", ".ktx2" };
 	return std::find(supported.begin(), supported.end(), ext) != supported.end();
 }
 
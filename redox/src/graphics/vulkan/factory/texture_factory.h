@@ -27,13 +27,46 @@ SOFTWARE.
 #include "graphics\vulkan\resources\texture.h"
 #include "resources\resource.h"	
 
+#include <mutex> //std::mutex
+
 namespace redox::graphics {
 	
+	enum class TextureCompression {
+		NONE,
+		BC1, //BC1 for opaque, BC3 for translucent images
+		BC7
+	};
+
+	class TextureStreamer;
+
 	class TextureFactory : public IResourceFactory {
 	public:
+		//Textures are registered with the streamer if there is one
+		TextureFactory(TextureStreamer* streamer = nullptr);
 		~TextureFactory() override = default;
 		ResourceHandle<IResource> load(const Path& path) override;
 		bool supports_ext(const Path& ext) override;
+
+	private:
+		struct shared_texture {
+			Path path; //First file the payload was loaded from
+			WeakResourceHandle<SampleTexture> texture;
+		};
+
+		ResourceHandle<IResource> _find_shared(u64 contentHash, const Path& path);
+		ResourceHandle<IResource> _create_texture(u64 contentHash, const Path& path, redox::Buffer<byte> pixels,
+			VkFormat format, const VkExtent2D& extent, redox::Buffer<VkDeviceSize> levelOffsets);
+
+		TextureStreamer* _streamer;
+
+		//Keyed by the hash of the file and the import settings
+		std::mutex _sharedMutex;
+		Hashmap<u64, shared_texture> _shared;
+		std::size_t _sharedBytes{ 0 }; //Guarded by _sharedMutex
+
+		//Normal maps are always stored as BC5 unless compression is off
+		TextureCompression _compression;
+		bool _generateMipmaps;
 	};
 
 }
\ No newline at end of file
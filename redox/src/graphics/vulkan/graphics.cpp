@@ -75,11 +75,23 @@ redox::graphics::Graphics::Graphics(const platform::Window& window) {
 	_init_physical_device();
 	_init_surface(window);
 	_init_device();
+
+	_allocator = make_unique<MemoryAllocator>(_device, _physicalDevice);
+	_stagingPool = make_unique<StagingPool>();
+	_uploadTimeline = make_unique<UploadTimeline>();
+	_releaseQueue = make_unique<ReleaseQueue>();
 }
 
 redox::graphics::Graphics::~Graphics() {
 	ResourceManager::instance()->clear_cache(ResourceGroup::GRAPHICS);
 
+	//Flushed while release_queue() is still valid, the releases may queue further ones
+	_releaseQueue->flush();
+	_releaseQueue.reset();
+	_uploadTimeline.reset();
+	_stagingPool.reset();
+	_allocator.reset();
+
 	vkDestroySurfaceKHR(_instance, _surface, nullptr);
 
 #ifdef RDX_VULKAN_VALIDATION
@@ -120,6 +132,26 @@ void redox::graphics::Graphics::wait_pending() const {
 	vkDeviceWaitIdle(_device);
 }
 
+redox::graphics::MemoryAllocator& redox::graphics::Graphics::allocator() const {
+	return *_allocator;
+}
+
+redox::graphics::StagingPool& redox::graphics::Graphics::staging_pool() const {
+	return *_stagingPool;
+}
+
+redox::graphics::UploadTimeline& redox::graphics::Graphics::upload_timeline() const {
+	return *_uploadTimeline;
+}
+
+redox::graphics::ReleaseQueue& redox::graphics::Graphics::release_queue() const {
+	return *_releaseQueue;
+}
+
+bool redox::graphics::Graphics::supports_block_compression() const {
+	return _blockCompression;
+}
+
 std::optional<uint32_t> redox::graphics::Graphics::pick_memory_type(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
 	VkPhysicalDeviceMemoryProperties memProperties;
 	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memProperties);
@@ -265,9 +297,14 @@ void redox::graphics::Graphics::_init_device() {
 	queueInfo.queueCount = 1;
 	queueInfo.pQueuePriorities = &queuePriority;
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &supportedFeatures);
+	_blockCompression = supportedFeatures.textureCompressionBC == VK_TRUE;
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.fillModeNonSolid = VK_TRUE;
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -33,6 +33,9 @@ SOFTWARE.
 #include "pipeline_cache.h"
 #include "render_pass.h"
 #include "swapchain.h"
+#include "memory_allocator.h"
+#include "upload_batch.h"
+#include "release_queue.h"
 
 #include "factory/model_factory.h"
 #include "factory/shader_factory.h"
@@ -57,6 +60,14 @@ namespace redox::graphics {
 
 		void wait_pending() const;
 
+		MemoryAllocator& allocator() const;
+		StagingPool& staging_pool() const;
+		UploadTimeline& upload_timeline() const;
+		ReleaseQueue& release_queue() const;
+
+		//BC1-BC7 sampling, enabled whenever the device offers it
+		bool supports_block_compression() const;
+
 		std::optional<uint32_t> pick_memory_type(
 			uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
 
@@ -80,6 +91,11 @@ namespace redox::graphics {
 		VkDevice _device;
 		VkPhysicalDevice _physicalDevice;
 		VkSurfaceKHR _surface;
+		bool _blockCompression{ false };
+		UniquePtr<MemoryAllocator> _allocator;
+		UniquePtr<StagingPool> _stagingPool;
+		UniquePtr<UploadTimeline> _uploadTimeline;
+		UniquePtr<ReleaseQueue> _releaseQueue;
 
 #ifdef RDX_VULKAN_VALIDATION
 		VkDebugReportCallbackEXT _debugReportCallback;
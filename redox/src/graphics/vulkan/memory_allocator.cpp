@@ -0,0 +1,312 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "memory_allocator.h"
+#include "graphics.h"
+
+#include <algorithm> //std::max, std::find_if, std::count_if
+
+namespace {
+	constexpr VkDeviceSize LARGE_HEAP_BLOCK_SIZE = 256ull << 20;
+	constexpr VkDeviceSize SMALL_HEAP_SIZE = 1ull << 30;
+
+	redox::u32 pool_key(redox::u32 memoryType, redox::graphics::AllocationStrategy strategy, bool image) {
+		return (memoryType << 2) | (static_cast<redox::u32>(strategy) << 1) | (image ? 1u : 0u);
+	}
+}
+
+namespace redox::graphics {
+	struct MemoryBlock {
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		void* mapped;
+		u32 memoryType;
+		AllocationStrategy strategy;
+		bool image;
+		bool dedicated;
+
+		std::optional<TlsfAllocator> tlsf;
+		std::optional<LinearAllocator> linear;
+
+		bool empty() const {
+			return tlsf ? tlsf->allocation_count() == 0 : linear->allocation_count() == 0;
+		}
+	};
+}
+
+redox::graphics::MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) :
+	_device(device) {
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	_bufferImageGranularity = properties.limits.bufferImageGranularity;
+	_nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+}
+
+redox::graphics::MemoryAllocator::~MemoryAllocator() {
+	u32 leaked = 0;
+	for (auto& [key, blocks] : _pools) {
+		for (auto& block : blocks) {
+			leaked += block->tlsf ? block->tlsf->allocation_count() : block->linear->allocation_count();
+			_destroy_block(*block);
+		}
+	}
+
+	for (auto& block : _dedicated) {
+		++leaked;
+		_destroy_block(*block);
+	}
+
+	if (leaked > 0)
+		RDX_LOG("{0} device memory allocations were not freed", ConsoleColor::RED, leaked);
+}
+
+redox::graphics::MemoryAllocation redox::graphics::MemoryAllocator::bind_buffer(VkBuffer buffer,
+	VkMemoryPropertyFlags memFlags, AllocationStrategy strategy) {
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_device, buffer, &requirements);
+
+	auto allocation = _allocate(requirements, memFlags, strategy, false);
+	if (vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		free(allocation);
+		throw Exception("failed to bind buffer memory");
+	}
+	return allocation;
+}
+
+redox::graphics::MemoryAllocation redox::graphics::MemoryAllocator::bind_image(VkImage image,
+	VkMemoryPropertyFlags memFlags, AllocationStrategy strategy) {
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(_device, image, &requirements);
+
+	auto allocation = _allocate(requirements, memFlags, strategy, true);
+	if (vkBindImageMemory(_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+		free(allocation);
+		throw Exception("failed to bind image memory");
+	}
+	return allocation;
+}
+
+void redox::graphics::MemoryAllocator::free(const MemoryAllocation& allocation) {
+	std::lock_guard guard(_mutex);
+
+	auto* block = allocation.block;
+	if (!block) {
+		auto it = std::find_if(_dedicated.begin(), _dedicated.end(), [&](const auto& dedicated) {
+			return dedicated->memory == allocation.memory;
+		});
+
+		_destroy_block(**it);
+		_dedicated.erase(it);
+		return;
+	}
+
+	if (block->tlsf) {
+		block->tlsf->free(allocation.handle);
+	}
+	else {
+		block->linear->free(allocation.size);
+	}
+
+	if (!block->empty())
+		return;
+
+	//One empty block per pool is kept around, so alternating allocations don't thrash
+	auto& blocks = _pools[pool_key(block->memoryType, block->strategy, block->image)];
+	auto emptyBlocks = std::count_if(blocks.begin(), blocks.end(), [](const auto& b) {
+		return b->empty();
+	});
+
+	if (emptyBlocks > 1) {
+		auto it = std::find_if(blocks.begin(), blocks.end(), [block](const auto& b) {
+			return b.get() == block;
+		});
+
+		_destroy_block(*block);
+		blocks.erase(it);
+	}
+}
+
+redox::Buffer<redox::graphics::MemoryBlockStats> redox::graphics::MemoryAllocator::statistics() const {
+	std::lock_guard guard(_mutex);
+
+	redox::Buffer<MemoryBlockStats> stats;
+	auto add = [&stats](const MemoryBlock& block) {
+		auto& s = stats.emplace_back();
+		s.memoryType = block.memoryType;
+		s.strategy = block.strategy;
+		s.dedicated = block.dedicated;
+		s.images = block.image;
+		s.size = block.size;
+
+		if (block.dedicated) {
+			s.used = block.size;
+			s.largestFreeRange = 0;
+			s.allocationCount = 1;
+			s.freeRanges = 0;
+		}
+		else if (block.tlsf) {
+			s.used = block.tlsf->used();
+			s.largestFreeRange = block.tlsf->largest_free_range();
+			s.allocationCount = block.tlsf->allocation_count();
+			s.freeRanges = block.tlsf->free_range_count();
+		}
+		else {
+			s.used = block.linear->used();
+			s.largestFreeRange = block.size - block.linear->head();
+			s.allocationCount = block.linear->allocation_count();
+			s.freeRanges = 1;
+		}
+	};
+
+	for (const auto& [key, blocks] : _pools) {
+		for (const auto& block : blocks)
+			add(*block);
+	}
+
+	for (const auto& block : _dedicated)
+		add(*block);
+
+	return stats;
+}
+
+redox::graphics::MemoryAllocation redox::graphics::MemoryAllocator::_allocate(const VkMemoryRequirements& requirements,
+	VkMemoryPropertyFlags memFlags, AllocationStrategy strategy, bool image) {
+
+	auto memType = Graphics::instance().pick_memory_type(requirements.memoryTypeBits, memFlags);
+	if (!memType)
+		throw Exception("failed to determine memory type");
+
+	auto alignment = requirements.alignment;
+	auto typeFlags = _memoryProperties.memoryTypes[*memType].propertyFlags;
+	if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+		alignment = std::max(alignment, _nonCoherentAtomSize);
+
+	//Buffers and optimal images only share blocks if the device doesn't care
+	if (_bufferImageGranularity <= 1)
+		image = false;
+
+	std::lock_guard guard(_mutex);
+
+	auto blockSize = _block_size(*memType);
+	if (requirements.size > blockSize / 2) {
+		auto& block = _dedicated.emplace_back(_create_block(*memType, requirements.size, strategy, image));
+		block->dedicated = true;
+
+		MemoryAllocation allocation;
+		allocation.memory = block->memory;
+		allocation.size = requirements.size;
+		allocation.mapped = block->mapped;
+		return allocation;
+	}
+
+	auto& blocks = _pools[pool_key(*memType, strategy, image)];
+	for (auto& block : blocks) {
+		if (auto allocation = _allocate_from(*block, requirements.size, alignment))
+			return *allocation;
+	}
+
+	auto& block = blocks.emplace_back(_create_block(*memType, blockSize, strategy, image));
+	return _allocate_from(*block, requirements.size, alignment).value();
+}
+
+std::optional<redox::graphics::MemoryAllocation> redox::graphics::MemoryAllocator::_allocate_from(
+	MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment) {
+
+	MemoryAllocation allocation;
+	allocation.memory = block.memory;
+	allocation.size = size;
+	allocation.block = &block;
+
+	if (block.tlsf) {
+		auto range = block.tlsf->allocate(size, alignment);
+		if (!range)
+			return std::nullopt;
+
+		allocation.offset = range->offset;
+		allocation.handle = range->handle;
+	}
+	else {
+		auto offset = block.linear->allocate(size, alignment);
+		if (!offset)
+			return std::nullopt;
+
+		allocation.offset = *offset;
+	}
+
+	if (block.mapped)
+		allocation.mapped = static_cast<byte*>(block.mapped) + allocation.offset;
+	return allocation;
+}
+
+redox::UniquePtr<redox::graphics::MemoryBlock> redox::graphics::MemoryAllocator::_create_block(u32 memoryType,
+	VkDeviceSize size, AllocationStrategy strategy, bool image) {
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	auto block = make_unique<MemoryBlock>();
+	block->size = size;
+	block->mapped = nullptr;
+	block->memoryType = memoryType;
+	block->strategy = strategy;
+	block->image = image;
+	block->dedicated = false;
+
+	if (vkAllocateMemory(_device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS)
+		throw Exception("failed to allocate device memory");
+
+	if (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+			vkFreeMemory(_device, block->memory, nullptr);
+			throw Exception("failed to map device memory");
+		}
+	}
+
+	if (strategy == AllocationStrategy::TRANSIENT) {
+		block->linear.emplace(size);
+	}
+	else {
+		block->tlsf.emplace(size);
+	}
+	return block;
+}
+
+void redox::graphics::MemoryAllocator::_destroy_block(MemoryBlock& block) {
+	if (block.mapped)
+		vkUnmapMemory(_device, block.memory);
+	vkFreeMemory(_device, block.memory, nullptr);
+}
+
+VkDeviceSize redox::graphics::MemoryAllocator::_block_size(u32 memoryType) const {
+	auto heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+	return heapSize <= SMALL_HEAP_SIZE ? heapSize / 8 : LARGE_HEAP_BLOCK_SIZE;
+}
@@ -0,0 +1,101 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "vulkan.h"
+#include "range_allocator.h"
+
+#include "core\non_copyable.h"
+#include "core\utility.h"
+
+#include <mutex> //std::mutex
+
+namespace redox::graphics {
+	struct MemoryBlock;
+
+	enum class AllocationStrategy {
+		DEFAULT, //Best fit in the general blocks
+		TRANSIENT //Short lived, bump allocated in blocks that are reused once empty
+	};
+
+	//Range of a device memory block, host visible memory stays mapped while the block lives
+	struct MemoryAllocation {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize offset{ 0 };
+		VkDeviceSize size{ 0 };
+		void* mapped{ nullptr }; //Already offset
+
+		MemoryBlock* block{ nullptr }; //Null for dedicated allocations
+		TlsfAllocator::Handle handle{ 0 };
+	};
+
+	struct MemoryBlockStats {
+		u32 memoryType;
+		AllocationStrategy strategy;
+		bool dedicated;
+		bool images; //Optimal tiling images, kept apart from buffers for bufferImageGranularity
+		VkDeviceSize size;
+		VkDeviceSize used;
+		VkDeviceSize largestFreeRange;
+		u32 allocationCount;
+		u32 freeRanges;
+	};
+
+	//Sub-allocates buffers and images from large blocks per memory type, so the number of
+	//vkAllocateMemory calls stays far below maxMemoryAllocationCount. Thread safe
+	class MemoryAllocator : public NonCopyable {
+	public:
+		MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+		~MemoryAllocator();
+
+		//Allocates and binds the memory, throws if none of a suitable type is left
+		MemoryAllocation bind_buffer(VkBuffer buffer, VkMemoryPropertyFlags memFlags,
+			AllocationStrategy strategy = AllocationStrategy::DEFAULT);
+		MemoryAllocation bind_image(VkImage image, VkMemoryPropertyFlags memFlags,
+			AllocationStrategy strategy = AllocationStrategy::DEFAULT);
+
+		void free(const MemoryAllocation& allocation);
+
+		redox::Buffer<MemoryBlockStats> statistics() const;
+
+	private:
+		MemoryAllocation _allocate(const VkMemoryRequirements& requirements,
+			VkMemoryPropertyFlags memFlags, AllocationStrategy strategy, bool image);
+		std::optional<MemoryAllocation> _allocate_from(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment);
+		UniquePtr<MemoryBlock> _create_block(u32 memoryType, VkDeviceSize size, AllocationStrategy strategy, bool image);
+		void _destroy_block(MemoryBlock& block);
+		VkDeviceSize _block_size(u32 memoryType) const;
+
+		VkDevice _device;
+		VkPhysicalDeviceMemoryProperties _memoryProperties;
+		VkDeviceSize _bufferImageGranularity;
+		VkDeviceSize _nonCoherentAtomSize;
+
+		mutable std::mutex _mutex;
+		//By memory type, strategy and resource kind
+		Hashmap<u32, redox::Buffer<UniquePtr<MemoryBlock>>> _pools;
+		redox::Buffer<UniquePtr<MemoryBlock>> _dedicated;
+	};
+}
\ No newline at end of file
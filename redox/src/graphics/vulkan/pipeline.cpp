@@ -28,39 +28,96 @@ SOFTWARE.
 #include "command_pool.h"
 #include "render_pass.h"
 
+VkSpecializationInfo redox::graphics::SpecializationConstants::info() const {
+	VkSpecializationInfo info{};
+	info.mapEntryCount = static_cast<uint32_t>(_entries.size());
+	info.pMapEntries = _entries.data();
+	info.dataSize = _data.size();
+	info.pData = _data.data();
+	return info;
+}
+
+bool redox::graphics::SpecializationConstants::empty() const {
+	return _entries.empty();
+}
+
 redox::graphics::Pipeline::Pipeline(const RenderPass& renderPass, const VertexLayout& vLayout,
-	const DescriptorLayout& dLayout, ResourceHandle<Shader> vs, ResourceHandle<Shader> fs) :
+	SharedPtr<PipelineLayout> layout, ResourceHandle<Shader> vs, ResourceHandle<Shader> fs,
+	SpecializationConstants specialization) :
+	_layout(std::move(layout)),
+	_vertexLayout(vLayout),
+	_specialization(std::move(specialization)),
+	_renderPass(&renderPass),
+	_bindPoint(VK_PIPELINE_BIND_POINT_GRAPHICS),
 	_vs(std::move(vs)),
 	_fs(std::move(fs)) {
 
-	_init_desriptors(dLayout);
-	_init(vLayout, renderPass);
+	_init_pipeline();
+}
+
+redox::graphics::Pipeline::Pipeline(SharedPtr<PipelineLayout> layout, ResourceHandle<Shader> cs) :
+	_layout(std::move(layout)),
+	_bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE),
+	_cs(std::move(cs)) {
+
+	_init_compute_pipeline();
 }
 
 redox::graphics::Pipeline::~Pipeline() {
-	vkDestroyDescriptorSetLayout(Graphics::instance().device(), _descriptorSetLayout, nullptr);
 	vkDestroyPipeline(Graphics::instance().device(), _handle, nullptr);
-	vkDestroyPipelineLayout(Graphics::instance().device(), _layout, nullptr);
 }
 
 void redox::graphics::Pipeline::bind(const CommandBufferView& commandBuffer) {
-	vkCmdBindPipeline(commandBuffer.handle(), VK_PIPELINE_BIND_POINT_GRAPHICS, _handle);
-	_update_viewport(commandBuffer);
+	vkCmdBindPipeline(commandBuffer.handle(), _bindPoint, _handle);
 }
 
-void redox::graphics::Pipeline::set_viewport(const VkExtent2D& viewport) {
-	_viewport = viewport;
+void redox::graphics::Pipeline::push_constants(const CommandBufferView& commandBuffer, const void* data, uint32_t size) {
+	vkCmdPushConstants(commandBuffer.handle(), _layout->handle(), _layout->push_constant_stages(), 0, size, data);
 }
 
 VkPipelineLayout redox::graphics::Pipeline::layout() const {
-	return _layout;
+	return _layout->handle();
 }
 
 VkDescriptorSetLayout redox::graphics::Pipeline::descriptorLayout() const {
-	return _descriptorSetLayout;
+	return _layout->descriptor_layout();
 }
 
-void redox::graphics::Pipeline::_init(const VertexLayout& vLayout, const RenderPass& renderPass) {
+VkPipelineBindPoint redox::graphics::Pipeline::bind_point() const {
+	return _bindPoint;
+}
+
+bool redox::graphics::Pipeline::replace_shader(const ResourceHandle<Shader>& oldShader,
+	const ResourceHandle<Shader>& newShader) {
+
+	if (_vs != oldShader && _fs != oldShader && _cs != oldShader)
+		return false;
+
+	if (_vs == oldShader)
+		_vs = newShader;
+
+	if (_fs == oldShader)
+		_fs = newShader;
+
+	if (_cs == oldShader)
+		_cs = newShader;
+
+	//Submitted frames may still reference the old pipeline
+	Graphics::instance().release_queue().release([handle = _handle]() {
+		vkDestroyPipeline(Graphics::instance().device(), handle, nullptr);
+	});
+
+	if (_bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) {
+		_init_compute_pipeline();
+	}
+	else {
+		_init_pipeline();
+	}
+	return true;
+}
+
+void redox::graphics::Pipeline::_init_pipeline() {
+	const auto& vLayout = _vertexLayout;
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -125,15 +182,6 @@ void redox::graphics::Pipeline::_init(const VertexLayout& vLayout, const RenderP
 	colorBlending.attachmentCount = 1;
 	colorBlending.pAttachments = &colorBlendAttachment;
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
-
-	if (vkCreatePipelineLayout(Graphics::instance().device(), &pipelineLayoutInfo, nullptr, &_layout) != VK_SUCCESS) {
-		throw Exception("failed to create pipeline layout");
-	}
-
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 	vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -146,6 +194,12 @@ void redox::graphics::Pipeline::_init(const VertexLayout& vLayout, const RenderP
 	fragShaderStageInfo.module = _fs->handle();
 	fragShaderStageInfo.pName = "main";
 
+	auto specialization = _specialization.info();
+	if (!_specialization.empty()) {
+		vertShaderStageInfo.pSpecializationInfo = &specialization;
+		fragShaderStageInfo.pSpecializationInfo = &specialization;
+	}
+
 	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
 	VkPipelineDynamicStateCreateInfo dynamicStateInfo{};
@@ -168,8 +222,8 @@ void redox::graphics::Pipeline::_init(const VertexLayout& vLayout, const RenderP
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = &dynamicStateInfo;
 	pipelineInfo.pDepthStencilState = &depthStencil;
-	pipelineInfo.layout = _layout;
-	pipelineInfo.renderPass = renderPass.handle();
+	pipelineInfo.layout = _layout->handle();
+	pipelineInfo.renderPass = _renderPass->handle();
 	pipelineInfo.subpass = 0;
 
 	if (vkCreateGraphicsPipelines(Graphics::instance().device(),
@@ -179,32 +233,18 @@ void redox::graphics::Pipeline::_init(const VertexLayout& vLayout, const RenderP
 	}
 }
 
-void redox::graphics::Pipeline::_init_desriptors(const DescriptorLayout& dLayout) {
+void redox::graphics::Pipeline::_init_compute_pipeline() {
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = _cs->handle();
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = _layout->handle();
 
-	VkDescriptorSetLayoutCreateInfo layoutInfo{};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(dLayout.bindings.size());
-	layoutInfo.pBindings = dLayout.bindings.data();
-	//VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	if (vkCreateComputePipelines(Graphics::instance().device(),
+		VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_handle) != VK_SUCCESS) {
 
-	if (vkCreateDescriptorSetLayout(Graphics::instance().device(), 
-		&layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
-		throw Exception("failed to create descriptor set layout");
+		throw Exception("failed to create compute pipeline");
 	}
 }
-
-void redox::graphics::Pipeline::_update_viewport(const CommandBufferView& cbo) {
-	VkViewport vp{};
-	vp.x = 0.0f;
-	vp.y = 0.0f;
-	vp.width = static_cast<float>(_viewport.width);
-	vp.height = static_cast<float>(_viewport.height);
-	vp.minDepth = 0.0f;
-	vp.maxDepth = 1.0f;
-	vkCmdSetViewport(cbo.handle(), 0, 1, &vp);
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = _viewport;
-	vkCmdSetScissor(cbo.handle(), 0, 1, &scissor);
-}
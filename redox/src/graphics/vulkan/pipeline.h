@@ -28,7 +28,7 @@ SOFTWARE.
 #include <graphics/vulkan/sampler.h>
 #include <graphics/vulkan/buffer.h>
 #include <graphics/vulkan/vertex_layout.h>
-#include <graphics/vulkan/descriptor_layout.h>
+#include <graphics/vulkan/pipeline_layout.h>
 
 #include <graphics/vulkan/resources/shader.h>
 #include <graphics/vulkan/resources/texture.h>
@@ -40,31 +40,66 @@ namespace redox::graphics {
 	class CommandBufferView;
 	class RenderPass;
 
+	//Values for the specialization constants of the graphics stages, ids a stage doesn't declare are
+	//ignored by it. GLSL bools are 32 bit, set them as u32
+	class SpecializationConstants {
+	public:
+		template<class T>
+		void set(uint32_t constantId, const T& value) {
+			static_assert(std::is_trivially_copyable_v<T>, "<T> must be trivially copyable");
+
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constantId;
+			entry.offset = static_cast<uint32_t>(_data.size());
+			entry.size = sizeof(T);
+			_entries.push_back(entry);
+
+			auto bytes = reinterpret_cast<const byte*>(&value);
+			_data.insert(_data.end(), bytes, bytes + sizeof(T));
+		}
+
+		//Points into this object, it must outlive the pipeline creation
+		VkSpecializationInfo info() const;
+		bool empty() const;
+
+	private:
+		redox::Buffer<VkSpecializationMapEntry> _entries;
+		redox::Buffer<byte> _data;
+	};
+
 	class Pipeline {
 	public:
-		Pipeline(const RenderPass& renderPass,
-			const VertexLayout& vLayout, const DescriptorLayout& dLayout,
-			ResourceHandle<Shader> vs, ResourceHandle<Shader> fs);
+		Pipeline(const RenderPass& renderPass, const VertexLayout& vLayout,
+			SharedPtr<PipelineLayout> layout, ResourceHandle<Shader> vs, ResourceHandle<Shader> fs,
+			SpecializationConstants specialization = {});
+		Pipeline(SharedPtr<PipelineLayout> layout, ResourceHandle<Shader> cs);
 		~Pipeline();
 
 		void bind(const CommandBufferView& commandBuffer);
-		void set_viewport(const VkExtent2D& size);
+		void push_constants(const CommandBufferView& commandBuffer, const void* data, uint32_t size);
 
 		VkPipelineLayout layout() const;
 		VkDescriptorSetLayout descriptorLayout() const;
+		VkPipelineBindPoint bind_point() const;
+
+		//Recreates the pipeline in place if it uses oldShader, existing handles stay valid.
+		//The layout is kept, the new shader must keep the interface
+		bool replace_shader(const ResourceHandle<Shader>& oldShader,
+			const ResourceHandle<Shader>& newShader);
 
 	private:
-		void _init(const VertexLayout& vLayout, const RenderPass& renderPass);
-		void _init_desriptors(const DescriptorLayout& dLayout);
-		void _update_viewport(const CommandBufferView& cbo);
+		void _init_pipeline();
+		void _init_compute_pipeline();
 
 		VkPipeline _handle;
-		VkPipelineLayout _layout;
+		SharedPtr<PipelineLayout> _layout;
+		VertexLayout _vertexLayout;
+		SpecializationConstants _specialization;
+		const RenderPass* _renderPass{ nullptr };
+		VkPipelineBindPoint _bindPoint;
 
-		VkDescriptorSetLayout _descriptorSetLayout;
 		ResourceHandle<Shader> _vs;
 		ResourceHandle<Shader> _fs;
-
-		VkExtent2D _viewport{ 0,0 };
+		ResourceHandle<Shader> _cs;
 	};
 }
\ No newline at end of file
@@ -27,78 +27,222 @@ SOFTWARE.
 
 #include "graphics.h"
 #include "core/application.h"
+#include "resources/shader_compiler.h"
+
+#include <algorithm> //std::clamp
+#include <future> //std::promise
+
+namespace {
+	redox::u64 pipeline_key(redox::graphics::PipelineType type, const redox::graphics::ShaderPermutation& permutation) {
+		return (static_cast<redox::u64>(type) << 56) | permutation.key();
+	}
+
+	redox::Buffer<redox::String> keyword_defines(redox::graphics::ShaderKeywords keywords) {
+		using redox::graphics::ShaderKeywords;
+
+		redox::Buffer<redox::String> defines;
+		if (redox::util::check_flag(keywords, ShaderKeywords::ALBEDO_MAP))
+			defines.push_back("ALBEDO_MAP");
+		if (redox::util::check_flag(keywords, ShaderKeywords::NORMAL_MAP))
+			defines.push_back("NORMAL_MAP");
+		return defines;
+	}
+
+	//Attributes come from the vertex shader inputs, the offsets from MeshVertex by location
+	redox::graphics::VertexLayout mesh_vertex_layout(const redox::graphics::Shader& vs) {
+		using redox::graphics::MeshVertex;
+
+		const uint32_t offsets[] = {
+			redox::util::offset_of<uint32_t>(&MeshVertex::pos),
+			redox::util::offset_of<uint32_t>(&MeshVertex::normal),
+			redox::util::offset_of<uint32_t>(&MeshVertex::uv)
+		};
+
+		redox::graphics::VertexLayout vLayout{};
+		vLayout.binding.binding = 0;
+		vLayout.binding.stride = sizeof(MeshVertex);
+		vLayout.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		for (const auto& input : vs.reflection().inputs) {
+			if (input.location >= redox::util::array_size<uint32_t>(offsets))
+				throw redox::Exception("vertex shader input has no matching MeshVertex attribute");
+
+			VkVertexInputAttributeDescription attrib{};
+			attrib.binding = 0;
+			attrib.location = input.location;
+			attrib.format = static_cast<VkFormat>(input.format);
+			attrib.offset = offsets[input.location];
+			vLayout.attribs.push_back(attrib);
+		}
+		return vLayout;
+	}
+}
+
+redox::u64 redox::graphics::ShaderPermutation::key() const {
+	return static_cast<u64>(keywords) | (static_cast<u64>(lightCount) << 32);
+}
 
 redox::graphics::PipelineCache::PipelineCache(const RenderPass* rp) :
 	_renderPass(rp) {
+
+	ResourceManager::instance()->onReloadResource += [this](const auto& oldResource, const auto& newResource) {
+		_event_resource_reloaded(oldResource, newResource);
+	};
 }
 
-redox::graphics::PipelineHandle redox::graphics::PipelineCache::load(PipelineType type) {
-	if (auto hit = _pipelines.find(type); hit != _pipelines.end())
-		return hit->second;
+redox::graphics::PipelineHandle redox::graphics::PipelineCache::load(PipelineType type, const ShaderPermutation& permutation) {
+	auto key = pipeline_key(type, permutation);
+
+	std::promise<PipelineHandle> promise;
+	{
+		std::unique_lock lock(_mutex);
+		if (auto hit = _pipelines.find(key); hit != _pipelines.end())
+			return hit->second;
+
+		//Someone else is already building this pipeline, wait for their result
+		if (auto fit = _inflight.find(key); fit != _inflight.end()) {
+			auto future = fit->second;
+			lock.unlock();
+			return future.get();
+		}
+
+		_inflight.emplace(key, promise.get_future().share());
+	}
+
+	//Built without the lock, shader compiles take a while and wait on the thread pool
+	PipelineHandle pipeline;
+	try {
+		pipeline = _create_pipeline(type, permutation);
+		onCreate(pipeline);
+	}
+	catch (...) {
+		{
+			std::lock_guard guard(_mutex);
+			_inflight.erase(key);
+		}
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard guard(_mutex);
+		_pipelines.emplace(key, pipeline);
+		_inflight.erase(key);
+	}
 
-	auto pipeline = _create_pipeline(type);
-	onCreate(pipeline);
+	promise.set_value(pipeline);
 	return pipeline;
 }
 
-redox::graphics::PipelineHandle redox::graphics::PipelineCache::_create_pipeline(PipelineType type) {
+void redox::graphics::PipelineCache::_event_resource_reloaded(
+	const ResourceHandle<IResource>& oldResource, const ResourceHandle<IResource>& newResource) {
+
+	auto oldShader = std::dynamic_pointer_cast<Shader>(oldResource);
+	auto newShader = std::dynamic_pointer_cast<Shader>(newResource);
+	if (!oldShader || !newShader)
+		return;
+
+	//Variants follow the source of their keyword free shader
+	redox::Buffer<std::pair<ResourceHandle<Shader>, ResourceHandle<Shader>>> replaced{ { oldShader, newShader } };
+	{
+		std::lock_guard guard(_variantMutex);
+		for (auto& variant : _variants) {
+			if (variant.base != oldShader)
+				continue;
+
+			auto shader = std::make_shared<Shader>(ShaderCompiler::compile(variant.source, keyword_defines(variant.keywords)));
+			replaced.emplace_back(variant.shader, shader);
+			variant.base = newShader;
+			variant.shader = std::move(shader);
+		}
+	}
+
+	//Only pipelines built from the old modules are recreated
+	std::lock_guard guard(_mutex);
+	for (auto& [key, pipeline] : _pipelines) {
+		for (const auto& [from, to] : replaced) {
+			if (pipeline->replace_shader(from, to)) {
+				RDX_LOG("Rebuilt pipeline {0} after shader reload", key);
+			}
+		}
+	}
+}
+
+redox::ResourceHandle<redox::graphics::Shader> redox::graphics::PipelineCache::_load_shader(const Path& path,
+	ShaderKeywords keywords) {
+
+	auto resources = ResourceManager::instance();
+	auto base = resources->load<Shader>(path);
+	if (keywords == ShaderKeywords::NONE)
+		return base;
+
+	auto source = resources->resolve_path(path);
+	auto find_variant = [&]() -> ResourceHandle<Shader> {
+		for (const auto& variant : _variants) {
+			if (variant.base == base && variant.keywords == keywords)
+				return variant.shader;
+		}
+		return nullptr;
+	};
+
+	{
+		std::lock_guard guard(_variantMutex);
+		if (auto shader = find_variant())
+			return shader;
+	}
+
+	//Compiled without the lock, so variants of different stages build concurrently
+	auto shader = std::make_shared<Shader>(ShaderCompiler::compile(source, keyword_defines(keywords)));
+
+	std::lock_guard guard(_variantMutex);
+	if (auto existing = find_variant())
+		return existing;
+
+	_variants.push_back({ source, keywords, base, shader });
+	return shader;
+}
+
+redox::graphics::PipelineHandle redox::graphics::PipelineCache::_create_pipeline(PipelineType type,
+	const ShaderPermutation& permutation) {
 
 	switch (type) {
 	case redox::graphics::PipelineType::DEFAULT_MESH_PIPELINE:
-		return _create_default_mesh_pipeline();
+		return _create_default_mesh_pipeline(permutation);
+	case redox::graphics::PipelineType::CLUSTER_CULL_PIPELINE:
+		return _create_cluster_cull_pipeline();
 	}
 	
 	throw Exception("invalid pipeline type");
 }
 
-redox::graphics::PipelineHandle redox::graphics::PipelineCache::_create_default_mesh_pipeline() {
+redox::graphics::PipelineHandle redox::graphics::PipelineCache::_create_default_mesh_pipeline(const ShaderPermutation& permutation) {
 
-	VkDescriptorSetLayoutBinding mvpBinding{};
-	mvpBinding.binding = 0;
-	mvpBinding.descriptorCount = 1;
-	mvpBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	mvpBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	//Both stages compile at once, this thread runs the fragment shader itself if no worker got to it
+	auto pool = Application::instance->thread_pool();
+	auto group = pool->create_group();
+	auto fsTask = pool->submit([this, keywords = permutation.keywords]() {
+		return _load_shader("builtin:shader\\mesh.frag", keywords);
+	}, TaskPriority::HIGH, group);
 
-	VkDescriptorSetLayoutBinding albedoBinding{};
-	albedoBinding.binding = 1;
-	albedoBinding.descriptorCount = 1;
-	albedoBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	albedoBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	auto vs = _load_shader("builtin:shader\\mesh.vert");
+	pool->wait(fsTask, group);
+	auto fs = fsTask.get();
 
-	VkDescriptorSetLayoutBinding normalBinding{};
-	normalBinding.binding = 2;
-	normalBinding.descriptorCount = 1;
-	normalBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	normalBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	SpecializationConstants specialization;
+	specialization.set<i32>(0, std::clamp(permutation.lightCount, 1u, ShaderPermutation::MAX_LIGHTS));
 
-	DescriptorLayout dLayout{ { mvpBinding, albedoBinding, normalBinding } };
-
-	VertexLayout vLayout{};
-	vLayout.binding.binding = 0;
-	vLayout.binding.stride = sizeof(MeshVertex);
-	vLayout.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-	vLayout.attribs.resize(3);
-	vLayout.attribs[0].binding = 0;
-	vLayout.attribs[0].location = 0;
-	vLayout.attribs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	vLayout.attribs[0].offset = util::offset_of<uint32_t>(&MeshVertex::pos);
-
-	vLayout.attribs[1].binding = 0;
-	vLayout.attribs[1].location = 1;
-	vLayout.attribs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	vLayout.attribs[1].offset = util::offset_of<uint32_t>(&MeshVertex::normal);
+	auto layout = _layouts.load({ vs.get(), fs.get() });
+	return redox::make_shared<Pipeline>(*_renderPass, mesh_vertex_layout(*vs),
+		std::move(layout), std::move(vs), std::move(fs), std::move(specialization));
+}
 
-	vLayout.attribs[2].binding = 0;
-	vLayout.attribs[2].location = 2;
-	vLayout.attribs[2].format = VK_FORMAT_R32G32_SFLOAT;
-	vLayout.attribs[2].offset = util::offset_of<uint32_t>(&MeshVertex::uv);
+redox::graphics::PipelineHandle redox::graphics::PipelineCache::_create_cluster_cull_pipeline() {
 
-	auto vs = ResourceManager::instance()->load<Shader>("builtin:shader\\mesh.vert");
-	auto fs = ResourceManager::instance()->load<Shader>("builtin:shader\\mesh.frag");
+	auto cs = _load_shader("builtin:shader\\cluster_cull.comp");
 
-	auto pipeline = redox::make_shared<Pipeline>(*_renderPass, vLayout,
-		dLayout, std::move(vs), std::move(fs));
+	auto layout = _layouts.load({ cs.get() });
+	if (cs->reflection().pushConstantSize != sizeof(ClusterCullConstants))
+		throw Exception("cluster_cull.comp push constants don't match ClusterCullConstants");
 
-	return _pipelines.insert({ PipelineType::DEFAULT_MESH_PIPELINE, std::move(pipeline) }).first->second;
+	return redox::make_shared<Pipeline>(std::move(layout), std::move(cs));
 }
@@ -28,6 +28,9 @@ SOFTWARE.
 
 #include "pipeline.h"
 
+#include <mutex> //std::mutex
+#include <future> //std::shared_future
+
 namespace redox::graphics {
 	class RenderPass;
 
@@ -35,7 +38,27 @@ namespace redox::graphics {
 		DEFAULT_MESH_PIPELINE,
 		SKINNED_MESH_PIPELINE,
 		DEFAULT_2D_PIPELINE,
-		TERRAIN_PIPELINE
+		TERRAIN_PIPELINE,
+		CLUSTER_CULL_PIPELINE
+	};
+
+	//Compiled into separate shader variants, every keyword set is #defined in the source
+	enum class ShaderKeywords : u32 {
+		NONE = 0,
+		ALBEDO_MAP = 0x1 << 0,
+		NORMAL_MAP = 0x1 << 1
+	};
+
+	//Shader variant plus the specialization constants of a pipeline. Keywords cost a compile
+	//per combination, constants only a pipeline
+	struct ShaderPermutation {
+		static constexpr u32 MAX_LIGHTS = 4;
+
+		ShaderKeywords keywords{ ShaderKeywords::NONE };
+		u32 lightCount{ 1 }; //Directional lights evaluated by mesh.frag, 1 to MAX_LIGHTS
+
+		//Keywords in the low half, constants above, the top byte is left to the pipeline type
+		u64 key() const;
 	};
 
 	using PipelineHandle = SharedPtr<Pipeline>;
@@ -44,18 +67,38 @@ namespace redox::graphics {
 	public:
 
 		PipelineCache(const RenderPass* rp);
-		PipelineHandle load(PipelineType type);
-
-		auto begin() const { return _pipelines.begin(); }
-		auto end() const { return _pipelines.end(); }
+		PipelineHandle load(PipelineType type, const ShaderPermutation& permutation = {});
 
+		//Raised on the loading thread, before the pipeline is handed out
 		Event<PipelineHandle> onCreate;
 
 	private:
-		PipelineHandle _create_pipeline(PipelineType type);
-		PipelineHandle _create_default_mesh_pipeline();
+		void _event_resource_reloaded(const ResourceHandle<IResource>& oldResource,
+			const ResourceHandle<IResource>& newResource);
+
+		struct shader_variant {
+			Path source; //Resolved
+			ShaderKeywords keywords;
+			ResourceHandle<Shader> base; //Without keywords, its reloads rebuild the variant
+			ResourceHandle<Shader> shader;
+		};
+
+		//Thread safe, keyword free shaders are the resources themselves
+		ResourceHandle<Shader> _load_shader(const Path& path, ShaderKeywords keywords = ShaderKeywords::NONE);
 
-		Hashmap<PipelineType, PipelineHandle> _pipelines;
+		PipelineHandle _create_pipeline(PipelineType type, const ShaderPermutation& permutation);
+		PipelineHandle _create_default_mesh_pipeline(const ShaderPermutation& permutation);
+		PipelineHandle _create_cluster_cull_pipeline();
+
+		std::mutex _mutex;
+		PipelineLayoutCache _layouts; //Outlives the pipelines
+		Hashmap<u64, PipelineHandle> _pipelines; //By pipeline type and permutation key
+		Hashmap<u64, std::shared_future<PipelineHandle>> _inflight; //Being built, same keys
 		const RenderPass* _renderPass;
+
+		std::mutex _variantMutex;
+		redox::Buffer<shader_variant> _variants;
 	};
-}
\ No newline at end of file
+}
+
+RDX_ENABLE_ENUM_FLAGS(::redox::graphics::ShaderKeywords);
\ No newline at end of file
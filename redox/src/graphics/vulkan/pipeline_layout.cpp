@@ -0,0 +1,136 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "pipeline_layout.h"
+#include "graphics.h"
+#include <core/hash/xxhash.h>
+
+#include <algorithm> //std::find_if, std::max, std::sort
+
+redox::graphics::PipelineLayout::PipelineLayout(const DescriptorLayout& dLayout, const VkPushConstantRange& pushConstants) :
+	_pushConstantStages(pushConstants.stageFlags) {
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(dLayout.bindings.size());
+	layoutInfo.pBindings = dLayout.bindings.data();
+
+	if (vkCreateDescriptorSetLayout(Graphics::instance().device(),
+		&layoutInfo, nullptr, &_descriptorSetLayout) != VK_SUCCESS) {
+		throw Exception("failed to create descriptor set layout");
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+
+	if (pushConstants.size > 0) {
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstants;
+	}
+
+	if (vkCreatePipelineLayout(Graphics::instance().device(), &pipelineLayoutInfo, nullptr, &_handle) != VK_SUCCESS) {
+		vkDestroyDescriptorSetLayout(Graphics::instance().device(), _descriptorSetLayout, nullptr);
+		throw Exception("failed to create pipeline layout");
+	}
+}
+
+redox::graphics::PipelineLayout::~PipelineLayout() {
+	vkDestroyPipelineLayout(Graphics::instance().device(), _handle, nullptr);
+	vkDestroyDescriptorSetLayout(Graphics::instance().device(), _descriptorSetLayout, nullptr);
+}
+
+VkPipelineLayout redox::graphics::PipelineLayout::handle() const {
+	return _handle;
+}
+
+VkDescriptorSetLayout redox::graphics::PipelineLayout::descriptor_layout() const {
+	return _descriptorSetLayout;
+}
+
+VkShaderStageFlags redox::graphics::PipelineLayout::push_constant_stages() const {
+	return _pushConstantStages;
+}
+
+redox::SharedPtr<redox::graphics::PipelineLayout> redox::graphics::PipelineLayoutCache::load(
+	std::initializer_list<const Shader*> stages) {
+
+	DescriptorLayout dLayout;
+	VkPushConstantRange pushConstants{};
+
+	for (const auto* stage : stages) {
+		const auto& info = stage->reflection();
+		auto stageFlag = static_cast<VkShaderStageFlags>(info.stage);
+
+		for (const auto& b : info.bindings) {
+			if (b.set != 0) {
+				throw Exception("only descriptor set 0 is supported");
+			}
+
+			auto it = std::find_if(dLayout.bindings.begin(), dLayout.bindings.end(), [&](const auto& existing) {
+				return existing.binding == b.binding;
+			});
+
+			if (it == dLayout.bindings.end()) {
+				VkDescriptorSetLayoutBinding binding{};
+				binding.binding = b.binding;
+				binding.descriptorType = static_cast<VkDescriptorType>(b.descriptorType);
+				binding.descriptorCount = b.count;
+				binding.stageFlags = stageFlag;
+				dLayout.bindings.push_back(binding);
+			}
+			else if (it->descriptorType != static_cast<VkDescriptorType>(b.descriptorType) || it->descriptorCount != b.count) {
+				throw Exception("shader stages disagree on a descriptor binding");
+			}
+			else {
+				it->stageFlags |= stageFlag;
+			}
+		}
+
+		if (info.pushConstantSize > 0) {
+			pushConstants.size = std::max(pushConstants.size, info.pushConstantSize);
+			pushConstants.stageFlags |= stageFlag;
+		}
+	}
+
+	std::sort(dLayout.bindings.begin(), dLayout.bindings.end(), [](const auto& lhs, const auto& rhs) {
+		return lhs.binding < rhs.binding;
+	});
+
+	//Hashed field by field, the structs have padding
+	auto signature = hash::xxh64(&pushConstants.size, sizeof(pushConstants.size), pushConstants.stageFlags);
+	for (const auto& b : dLayout.bindings) {
+		const uint32_t fields[] = { b.binding, static_cast<uint32_t>(b.descriptorType), b.descriptorCount, b.stageFlags };
+		signature = hash::xxh64(fields, sizeof(fields), signature);
+	}
+
+	std::lock_guard guard(_mutex);
+	auto& layout = _layouts[signature];
+	if (!layout) {
+		layout = make_shared<PipelineLayout>(dLayout, pushConstants);
+	}
+	return layout;
+}
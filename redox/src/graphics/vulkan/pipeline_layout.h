@@ -0,0 +1,64 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <graphics/vulkan/vulkan.h>
+#include <graphics/vulkan/descriptor_layout.h>
+#include <graphics/vulkan/resources/shader.h>
+
+#include <core/non_copyable.h>
+
+#include <initializer_list> //std::initializer_list
+#include <mutex> //std::mutex
+
+namespace redox::graphics {
+	//Descriptor set layout (set 0) and pipeline layout of one shader signature
+	class PipelineLayout : public NonCopyable {
+	public:
+		PipelineLayout(const DescriptorLayout& dLayout, const VkPushConstantRange& pushConstants);
+		~PipelineLayout();
+
+		VkPipelineLayout handle() const;
+		VkDescriptorSetLayout descriptor_layout() const;
+		VkShaderStageFlags push_constant_stages() const;
+
+	private:
+		VkDescriptorSetLayout _descriptorSetLayout;
+		VkPipelineLayout _handle;
+		VkShaderStageFlags _pushConstantStages;
+	};
+
+	//Builds layouts from the reflected interfaces of the shader stages, pipelines with the same
+	//signature share one layout and stay compatible for descriptor set binding
+	class PipelineLayoutCache : public NonCopyable {
+	public:
+		//Bindings used by several stages must agree on their type and count
+		SharedPtr<PipelineLayout> load(std::initializer_list<const Shader*> stages);
+
+	private:
+		std::mutex _mutex;
+		Hashmap<u64, SharedPtr<PipelineLayout>> _layouts; //By signature hash
+	};
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "range_allocator.h"
+
+#include <algorithm> //std::max
+#include <utility> //std::pair
+
+#ifdef RDX_COMPILER_MSVC
+#include <intrin.h> //_BitScanForward64, _BitScanReverse64
+#endif
+
+namespace {
+	redox::u32 lowest_bit(redox::u64 value) {
+#ifdef RDX_COMPILER_MSVC
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<redox::u32>(index);
+#else
+		return static_cast<redox::u32>(__builtin_ctzll(value));
+#endif
+	}
+
+	redox::u32 highest_bit(redox::u64 value) {
+#ifdef RDX_COMPILER_MSVC
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<redox::u32>(index);
+#else
+		return 63u - static_cast<redox::u32>(__builtin_clzll(value));
+#endif
+	}
+
+	redox::u64 align_up(redox::u64 value, redox::u64 alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//First level is the power of two, the second splits it linearly into SL_COUNT classes.
+	//Sizes below SL_COUNT all land in the first level
+	template<redox::u32 SlBits>
+	std::pair<redox::u32, redox::u32> size_class(redox::u64 size) {
+		if (size < (1ull << SlBits))
+			return { 0, static_cast<redox::u32>(size) };
+
+		auto msb = highest_bit(size);
+		auto sl = static_cast<redox::u32>(size >> (msb - SlBits)) ^ (1u << SlBits);
+		return { msb - SlBits + 1, sl };
+	}
+}
+
+redox::graphics::TlsfAllocator::TlsfAllocator(u64 size) :
+	_size(size) {
+
+	for (auto& lists : _freeLists) {
+		for (auto& head : lists)
+			head = NO_NODE;
+	}
+
+	if (size > 0)
+		_insert_free(_create_node(0, size));
+}
+
+std::optional<redox::graphics::TlsfAllocator::allocation> redox::graphics::TlsfAllocator::allocate(u64 size, u64 alignment) {
+	size = std::max<u64>(size, 1);
+
+	//Worst case padding, so the first range of the list always fits
+	auto index = _find_free(size + alignment - 1);
+	if (index == NO_NODE)
+		return std::nullopt;
+
+	_remove_free(index);
+
+	auto aligned = align_up(_nodes[index].offset, alignment);
+	auto padding = aligned - _nodes[index].offset;
+
+	//The padding goes back to the free lists as its own range
+	if (padding > 0) {
+		auto front = _create_node(_nodes[index].offset, padding);
+		_nodes[front].prevPhysical = _nodes[index].prevPhysical;
+		_nodes[front].nextPhysical = index;
+		if (_nodes[front].prevPhysical != NO_NODE)
+			_nodes[_nodes[front].prevPhysical].nextPhysical = front;
+
+		_nodes[index].prevPhysical = front;
+		_nodes[index].offset = aligned;
+		_nodes[index].size -= padding;
+		_insert_free(front);
+	}
+
+	if (_nodes[index].size > size) {
+		auto back = _create_node(aligned + size, _nodes[index].size - size);
+		_nodes[back].prevPhysical = index;
+		_nodes[back].nextPhysical = _nodes[index].nextPhysical;
+		if (_nodes[back].nextPhysical != NO_NODE)
+			_nodes[_nodes[back].nextPhysical].prevPhysical = back;
+
+		_nodes[index].nextPhysical = back;
+		_nodes[index].size = size;
+		_insert_free(back);
+	}
+
+	_nodes[index].free = false;
+	_used += size;
+	++_allocationCount;
+	return allocation{ index, aligned };
+}
+
+void redox::graphics::TlsfAllocator::free(Handle handle) {
+	auto& freed = _nodes[handle];
+	_used -= freed.size;
+	--_allocationCount;
+
+	auto prev = freed.prevPhysical;
+	if (prev != NO_NODE && _nodes[prev].free) {
+		_remove_free(prev);
+		_nodes[handle].offset = _nodes[prev].offset;
+		_nodes[handle].size += _nodes[prev].size;
+		_nodes[handle].prevPhysical = _nodes[prev].prevPhysical;
+		if (_nodes[handle].prevPhysical != NO_NODE)
+			_nodes[_nodes[handle].prevPhysical].nextPhysical = handle;
+		_release_node(prev);
+	}
+
+	auto next = _nodes[handle].nextPhysical;
+	if (next != NO_NODE && _nodes[next].free) {
+		_remove_free(next);
+		_nodes[handle].size += _nodes[next].size;
+		_nodes[handle].nextPhysical = _nodes[next].nextPhysical;
+		if (_nodes[handle].nextPhysical != NO_NODE)
+			_nodes[_nodes[handle].nextPhysical].prevPhysical = handle;
+		_release_node(next);
+	}
+
+	_insert_free(handle);
+}
+
+redox::u64 redox::graphics::TlsfAllocator::size() const {
+	return _size;
+}
+
+redox::u64 redox::graphics::TlsfAllocator::used() const {
+	return _used;
+}
+
+redox::u32 redox::graphics::TlsfAllocator::allocation_count() const {
+	return _allocationCount;
+}
+
+redox::u32 redox::graphics::TlsfAllocator::free_range_count() const {
+	return _freeRanges;
+}
+
+redox::u64 redox::graphics::TlsfAllocator::largest_free_range() const {
+	if (_flBitmap == 0)
+		return 0;
+
+	//Only the highest non-empty class can hold the largest range
+	auto fl = highest_bit(_flBitmap);
+	auto sl = highest_bit(_slBitmaps[fl]);
+
+	u64 largest = 0;
+	for (auto index = _freeLists[fl][sl]; index != NO_NODE; index = _nodes[index].nextFree)
+		largest = std::max(largest, _nodes[index].size);
+	return largest;
+}
+
+redox::u32 redox::graphics::TlsfAllocator::_create_node(u64 offset, u64 size) {
+	u32 index;
+	if (!_unusedNodes.empty()) {
+		index = _unusedNodes.back();
+		_unusedNodes.pop_back();
+	}
+	else {
+		index = static_cast<u32>(_nodes.size());
+		_nodes.emplace_back();
+	}
+
+	_nodes[index] = { offset, size, NO_NODE, NO_NODE, NO_NODE, NO_NODE, false };
+	return index;
+}
+
+void redox::graphics::TlsfAllocator::_release_node(u32 index) {
+	_unusedNodes.push_back(index);
+}
+
+void redox::graphics::TlsfAllocator::_insert_free(u32 index) {
+	auto [fl, sl] = size_class<SL_BITS>(_nodes[index].size);
+
+	auto& head = _freeLists[fl][sl];
+	_nodes[index].free = true;
+	_nodes[index].prevFree = NO_NODE;
+	_nodes[index].nextFree = head;
+	if (head != NO_NODE)
+		_nodes[head].prevFree = index;
+	head = index;
+
+	_flBitmap |= 1ull << fl;
+	_slBitmaps[fl] |= 1u << sl;
+	++_freeRanges;
+}
+
+void redox::graphics::TlsfAllocator::_remove_free(u32 index) {
+	auto [fl, sl] = size_class<SL_BITS>(_nodes[index].size);
+	auto& n = _nodes[index];
+
+	if (n.prevFree != NO_NODE)
+		_nodes[n.prevFree].nextFree = n.nextFree;
+	else
+		_freeLists[fl][sl] = n.nextFree;
+
+	if (n.nextFree != NO_NODE)
+		_nodes[n.nextFree].prevFree = n.prevFree;
+
+	if (_freeLists[fl][sl] == NO_NODE) {
+		_slBitmaps[fl] &= ~(1u << sl);
+		if (_slBitmaps[fl] == 0)
+			_flBitmap &= ~(1ull << fl);
+	}
+
+	n.free = false;
+	--_freeRanges;
+}
+
+redox::u32 redox::graphics::TlsfAllocator::_find_free(u64 size) const {
+	//Rounded up to the next class, so any range found is large enough
+	if (size >= (1ull << SL_BITS)) {
+		auto round = (1ull << (highest_bit(size) - SL_BITS)) - 1;
+		if (size > ~0ull - round)
+			return NO_NODE;
+		size += round;
+	}
+
+	auto [fl, sl] = size_class<SL_BITS>(size);
+
+	auto slMap = _slBitmaps[fl] & (~0u << sl);
+	if (slMap == 0) {
+		auto flMap = fl + 1 < 64 ? _flBitmap & (~0ull << (fl + 1)) : 0;
+		if (flMap == 0)
+			return NO_NODE;
+
+		fl = lowest_bit(flMap);
+		slMap = _slBitmaps[fl];
+	}
+
+	return _freeLists[fl][lowest_bit(slMap)];
+}
+
+redox::graphics::LinearAllocator::LinearAllocator(u64 size) :
+	_size(size) {
+}
+
+std::optional<redox::u64> redox::graphics::LinearAllocator::allocate(u64 size, u64 alignment) {
+	auto offset = align_up(_head, alignment);
+	if (offset > _size || size > _size - offset)
+		return std::nullopt;
+
+	_head = offset + size;
+	_used += size;
+	++_allocationCount;
+	return offset;
+}
+
+void redox::graphics::LinearAllocator::free(u64 size) {
+	_used -= size;
+	if (--_allocationCount == 0)
+		_head = 0;
+}
+
+redox::u64 redox::graphics::LinearAllocator::size() const {
+	return _size;
+}
+
+redox::u64 redox::graphics::LinearAllocator::used() const {
+	return _used;
+}
+
+redox::u64 redox::graphics::LinearAllocator::head() const {
+	return _head;
+}
+
+redox::u32 redox::graphics::LinearAllocator::allocation_count() const {
+	return _allocationCount;
+}
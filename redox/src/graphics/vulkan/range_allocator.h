@@ -0,0 +1,110 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+
+#include <optional> //std::optional
+
+namespace redox::graphics {
+	//Two level segregated fit over the range [0, size), only offsets are handed out and the
+	//memory itself is never touched. Allocating and freeing are O(1), free neighbours are merged
+	class TlsfAllocator {
+	public:
+		using Handle = u32;
+
+		struct allocation {
+			Handle handle;
+			u64 offset;
+		};
+
+		explicit TlsfAllocator(u64 size);
+
+		//alignment must be a power of two
+		std::optional<allocation> allocate(u64 size, u64 alignment = 1);
+		void free(Handle handle);
+
+		u64 size() const;
+		u64 used() const;
+		u32 allocation_count() const;
+		u32 free_range_count() const;
+		u64 largest_free_range() const;
+
+	private:
+		static constexpr u32 SL_BITS = 4;
+		static constexpr u32 SL_COUNT = 1u << SL_BITS;
+		static constexpr u32 FL_COUNT = 64 - SL_BITS + 1;
+		static constexpr u32 NO_NODE = ~0u;
+
+		struct node {
+			u64 offset;
+			u64 size;
+			u32 prevPhysical;
+			u32 nextPhysical;
+			u32 prevFree;
+			u32 nextFree;
+			bool free;
+		};
+
+		u32 _create_node(u64 offset, u64 size);
+		void _release_node(u32 index);
+		void _insert_free(u32 index);
+		void _remove_free(u32 index);
+		u32 _find_free(u64 size) const;
+
+		Buffer<node> _nodes;
+		Buffer<u32> _unusedNodes;
+
+		u64 _flBitmap{ 0 };
+		u32 _slBitmaps[FL_COUNT]{};
+		u32 _freeLists[FL_COUNT][SL_COUNT];
+
+		u64 _size;
+		u64 _used{ 0 };
+		u32 _allocationCount{ 0 };
+		u32 _freeRanges{ 0 };
+	};
+
+	//Bump allocator for transient allocations, the range is reused once all of them are freed
+	class LinearAllocator {
+	public:
+		explicit LinearAllocator(u64 size);
+
+		//alignment must be a power of two
+		std::optional<u64> allocate(u64 size, u64 alignment = 1);
+		void free(u64 size);
+
+		u64 size() const;
+		u64 used() const;
+		u64 head() const;
+		u32 allocation_count() const;
+
+	private:
+		u64 _size;
+		u64 _head{ 0 };
+		u64 _used{ 0 };
+		u32 _allocationCount{ 0 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "release_queue.h"
+
+redox::graphics::ReleaseQueue::~ReleaseQueue() {
+	flush();
+}
+
+void redox::graphics::ReleaseQueue::release(Function<void()> fn) {
+	std::lock_guard guard(_mutex);
+	_pending.push_back({ std::move(fn), _frame });
+}
+
+void redox::graphics::ReleaseQueue::end_frame() {
+	std::lock_guard guard(_mutex);
+	++_frame;
+}
+
+void redox::graphics::ReleaseQueue::collect() {
+	//Released without the lock, destructors may hand over further objects
+	redox::Buffer<Function<void()>> ready;
+	{
+		std::lock_guard guard(_mutex);
+		while (!_pending.empty() && _pending.front().frame < _frame) {
+			ready.push_back(std::move(_pending.front().release));
+			_pending.pop_front();
+		}
+	}
+
+	for (auto& fn : ready) {
+		fn();
+	}
+}
+
+void redox::graphics::ReleaseQueue::flush() {
+	//Released objects may hand over their own, e.g. a model its descriptor sets
+	for (;;) {
+		std::deque<pending_release> pending;
+		{
+			std::lock_guard guard(_mutex);
+			pending.swap(_pending);
+		}
+
+		if (pending.empty()) {
+			return;
+		}
+
+		for (auto& entry : pending) {
+			entry.release();
+		}
+	}
+}
@@ -0,0 +1,66 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core\core.h"
+#include "core\non_copyable.h"
+
+#include <mutex> //std::mutex
+#include <deque> //std::deque
+
+namespace redox::graphics {
+	//Keeps objects the GPU may still read alive until the frames submitted so far completed,
+	//replaced pipelines, images and models are handed over here instead of waiting on the queue. Thread safe
+	class ReleaseQueue : public NonCopyable {
+	public:
+		ReleaseQueue() = default;
+		~ReleaseQueue();
+
+		//Runs fn once every frame submitted before this call has completed
+		void release(Function<void()> fn);
+
+		template<class T>
+		void release(SharedPtr<T> object) {
+			release([object = std::move(object)]() {});
+		}
+
+		//Called after a frame was submitted
+		void end_frame();
+		//Called after waiting for every submitted frame
+		void collect();
+		//The device has to be idle
+		void flush();
+
+	private:
+		struct pending_release {
+			Function<void()> release;
+			u64 frame;
+		};
+
+		std::mutex _mutex;
+		std::deque<pending_release> _pending;
+		u64 _frame{ 0 };
+	};
+}
@@ -113,6 +113,18 @@ void redox::graphics::RenderPass::begin(const Framebuffer& frameBuffer, const Co
 	renderPassInfo.pClearValues = clearValues;
 
 	vkCmdBeginRenderPass(commandBuffer.handle(), &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	//Viewport and scissor are dynamic in every graphics pipeline and kept across pipeline binds.
+	//Set from the framebuffer as it is recorded, pipelines built by loader threads never see the swapchain
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(renderPassInfo.renderArea.extent.width);
+	viewport.height = static_cast<float>(renderPassInfo.renderArea.extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer.handle(), 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer.handle(), 0, 1, &renderPassInfo.renderArea);
 }
 
 void redox::graphics::RenderPass::end(const CommandBufferView& commandBuffer) const {
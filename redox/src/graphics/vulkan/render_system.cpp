@@ -28,6 +28,13 @@ SOFTWARE.
 #include <core/profiling/profiler.h>
 #include <core/application.h>
 
+#include <cmath> //std::sqrt
+
+namespace {
+	//Screen space error a simplified submesh may show before a finer level is drawn
+	constexpr redox::f32 LOD_PIXEL_ERROR = 1.0f;
+}
+
 const redox::graphics::RenderSystem* redox::graphics::RenderSystem::instance() {
 	return Application::instance->render_system();
 }
@@ -35,7 +42,7 @@ const redox::graphics::RenderSystem* redox::graphics::RenderSystem::instance() {
 redox::graphics::RenderSystem::RenderSystem() :
 	_mvpBuffer(sizeof(mvp_uniform)),
 	//TODO: Set depending on application
-	_descriptorPool(100, 100, 100) {
+	_descriptorPool(100, 100, 100, 100) {
 
 	_swapchain = make_unique<Swapchain>();
 	_swapchain->onResize += [this]() {
@@ -46,11 +53,14 @@ redox::graphics::RenderSystem::RenderSystem() :
 	_swapchain->create_fbs(*_forwardPass);
 
 	_pipelineCache = make_unique<PipelineCache>(_forwardPass.get());
-	_pipelineCache->onCreate += [this](PipelineHandle pipeline) {
-		pipeline->set_viewport(_swapchain->extent());
-	};
 
-	_textureFactory = make_unique<TextureFactory>();
+	auto config = Application::instance->config();
+	if (config->get("Resources", "TextureStreaming")) {
+		u32 budget = config->get("Resources", "TextureStreamingBudget");
+		_textureStreamer = make_unique<TextureStreamer>(static_cast<std::size_t>(budget) * 1024 * 1024);
+	}
+
+	_textureFactory = make_unique<TextureFactory>(_textureStreamer.get());
 	_modelFactory = make_unique<ModelFactory>(&_descriptorPool, _pipelineCache.get());
 	_shaderFactory = make_unique<ShaderFactory>();
 
@@ -90,12 +100,20 @@ void redox::graphics::RenderSystem::_demo_cam_move() {
 		camPosition.y -= 0.5f;
 	}
 
-	_mvpBuffer.map<mvp_uniform>([this](mvp_uniform* data) {
-		auto extent = _swapchain->extent();
+	constexpr f32 fov = 45.0f;
+	auto extent = _swapchain->extent();
+
+	//Object space size of one pixel at the model, matches the vertical scale of Mat44f::perspective
+	//with the model at the origin. The LOD error may project to at most LOD_PIXEL_ERROR pixels
+	auto distance = std::sqrt(camPosition.dot(camPosition));
+	_demoPixelSize = static_cast<f32>(2.0f * distance * math::deg2rad(fov / 2.0f) / extent.height);
+	_demoLodError = LOD_PIXEL_ERROR * _demoPixelSize;
+
+	_mvpBuffer.map<mvp_uniform>([this, extent, fov](mvp_uniform* data) {
 		auto ratio = static_cast<f32>(extent.width) / static_cast<f32>(extent.height);
 
 		data->model = math::Mat44f::rotate_euler({ -90, 0, 0 });
-		data->projection = math::Mat44f::perspective(45.0f, ratio, 0.1f, 1000.f);
+		data->projection = math::Mat44f::perspective(fov, ratio, 0.1f, 1000.f);
 		data->view = math::Mat44f::translate(camPosition);
 	});
 
@@ -105,44 +123,132 @@ void redox::graphics::RenderSystem::_demo_cam_move() {
 void redox::graphics::RenderSystem::_demo_draw() {
 	_swapchain->visit([this](const Framebuffer& frameBuffer, CommandBufferView commandBuffer) {
 		RDX_UNUSED(commandBuffer.scoped_record());
+
+		auto model = _demoScene ? _demoScene : _demoModel.get();
+
+		//Culling has to be recorded before the render pass starts
+		if (model) {
+			for (const auto& mesh : model->meshes()) {
+				if (!mesh->culling_enabled()) {
+					continue;
+				}
+
+				redox::Buffer<MeshLod> levels;
+				for (const auto& sm : mesh->submeshes()) {
+					levels.push_back(sm.select_lod(_demoLodError));
+				}
+
+				mesh->cull(commandBuffer, levels);
+			}
+		}
+
 		RDX_UNUSED(_forwardPass->scoped_begin(frameBuffer, commandBuffer));
 
-		for (const auto& mesh : _demoModel->meshes()) {
-			for (const auto& sm : mesh->submeshes()) {
-				auto material = _demoModel->materials()[sm.materialIndex];
+		if (!model) {
+			return;
+		}
+
+		for (const auto& mesh : model->meshes()) {
+			const auto& submeshes = mesh->submeshes();
+
+			for (std::size_t i = 0; i < submeshes.size(); ++i) {
+				const auto& sm = submeshes[i];
+				auto material = model->materials()[sm.materialIndex];
+
+				if (mesh->culling_enabled()) {
+					commandBuffer.submit(make_unique<IndirectDraw>(mesh, material, i));
+					continue;
+				}
+
+				auto lod = sm.select_lod(_demoLodError);
 				commandBuffer.submit(make_unique<IndexedDraw>(
-					mesh, material, IndexRange{sm.indexOffset, sm.indexCount}
+					mesh, material, IndexRange{lod.indexOffset, lod.indexCount, sm.vertexOffset}
 				));
 			}
 		}
 	});
 }
 
-void redox::graphics::RenderSystem::_demo_load_assets() {
-	_demoModel = ResourceManager::instance()->load<Model>("meshes\\scene.gltf");
+void redox::graphics::RenderSystem::_demo_request_textures() {
+	auto model = _demoScene ? _demoScene : _demoModel.get();
+	if (!_textureStreamer || !model || _demoPixelSize <= 0.0f) {
+		return;
+	}
+
+	//Textures are assumed to cover their mesh once, so the projected diameter bounds the texels needed
+	for (const auto& mesh : model->meshes()) {
+		auto pixels = 2.0f * mesh->bounds_radius() / _demoPixelSize;
 
-	if (!_demoModel) {
-		throw Exception("failed to load model.");
+		for (const auto& sm : mesh->submeshes()) {
+			model->materials()[sm.materialIndex]->visit_textures([&](const ResourceHandle<SampleTexture>& texture) {
+				_textureStreamer->request(*texture, pixels);
+			});
+		}
 	}
+}
+
+void redox::graphics::RenderSystem::_demo_load_assets() {
+	//The common variants are created up front so the loader threads mostly hit the cache
+	for (auto keywords : { ShaderKeywords::ALBEDO_MAP, ShaderKeywords::ALBEDO_MAP | ShaderKeywords::NORMAL_MAP }) {
+		ShaderPermutation permutation;
+		permutation.keywords = keywords;
+		_pipelineCache->load(PipelineType::DEFAULT_MESH_PIPELINE, permutation);
+	}
+
+	_demoModel = ResourceManager::instance()->load_async<Model>(
+		"meshes\\scene.gltf", TaskPriority::HIGH);
+
+	_demoModel.then([this](const ResourceHandle<Model>& model) {
+		if (!model) {
+			RDX_LOG("Failed to load the demo model.", ConsoleColor::RED);
+			return;
+		}
+
+		model->upload();
+		_demo_bind_model(model);
+	});
 
-	for (auto& mat : _demoModel->materials()) {
+	//Texture edits are patched into the materials, anything else replaces the model
+	ResourceManager::instance()->onReloadResource += [this](const auto& oldResource, const auto& newResource) {
+		if (_demoScene && oldResource == _demoScene) {
+			_demo_bind_model(std::static_pointer_cast<Model>(newResource));
+		}
+	};
+}
+
+void redox::graphics::RenderSystem::_demo_bind_model(const ResourceHandle<Model>& model) {
+	for (auto& mat : model->materials()) {
 		mat->set_buffer(BufferKeys::MVP, _mvpBuffer);
 	}
 
-	_demoModel->upload();
+	for (auto& mesh : model->meshes()) {
+		mesh->set_view_buffer(_mvpBuffer);
+	}
+
+	//The frame in flight may still draw the replaced model
+	if (_demoScene) {
+		Graphics::instance().release_queue().release(std::move(_demoScene));
+	}
+
+	_demoScene = model;
 }
 
 void redox::graphics::RenderSystem::render() {
+	_swapchain->wait_frame();
+
 	_demo_cam_move();
+	_demo_request_textures();
+
+	//Materials write swapped images into their descriptor sets while the frame is recorded
+	if (_textureStreamer) {
+		_textureStreamer->update();
+	}
+
 	_demo_draw();
 	_swapchain->present();
 }
 
 void redox::graphics::RenderSystem::_swapchain_event_resize() {
-	for (const auto& p : *_pipelineCache) {
-		p.second->set_viewport(_swapchain->extent());
-	}
-
 	_forwardPass->resize_attachments(_swapchain->extent());
 	_swapchain->create_fbs(*_forwardPass);
 }
\ No newline at end of file
@@ -31,7 +31,9 @@ SOFTWARE.
 #include "platform\window.h"
 #include "graphics.h"
 #include "render_pass.h"
+#include "texture_streamer.h"
 #include "math\math.h"
+#include "resources\async_resource.h"
 
 namespace redox::graphics {
 
@@ -57,15 +59,21 @@ namespace redox::graphics {
 		DescriptorPool _descriptorPool;
 
 		//@DEMO
-		ResourceHandle<Model> _demoModel;
+		AsyncResourceHandle<Model> _demoModel;
+		ResourceHandle<Model> _demoScene;
+		f32 _demoLodError{ 0.0f };
+		f32 _demoPixelSize{ 0.0f }; //Object space size of a pixel at the model
+		void _demo_bind_model(const ResourceHandle<Model>& model);
 		void _demo_cam_move();
 		void _demo_draw();
+		void _demo_request_textures();
 		void _demo_load_assets();
 		//@@@
 
 		UniquePtr<Swapchain> _swapchain;
 		UniquePtr<RenderPass> _forwardPass;
 		UniquePtr<PipelineCache> _pipelineCache;
+		UniquePtr<TextureStreamer> _textureStreamer;
 
 		UniquePtr<ModelFactory> _modelFactory;
 		UniquePtr<TextureFactory> _textureFactory;
@@ -26,25 +26,38 @@ SOFTWARE.
 #include "material.h"
 #include "graphics\vulkan\graphics.h"
 
-redox::graphics::Material::Material(PipelineHandle pipeline, DescriptorSetView descSet) :
-	_pipeline(std::move(pipeline)),
-	_descSet(descSet) {
+redox::graphics::Material::Material(PipelineHandle pipeline, DescriptorSet descSet) :
+	_descSet(std::move(descSet)),
+	_pipeline(std::move(pipeline)) {
 }
 
 void redox::graphics::Material::bind(const CommandBufferView& commandBuffer) {
+	_bind_textures();
 	_pipeline->bind(commandBuffer);
 	_descSet.bind(commandBuffer, *_pipeline);
 }
 
 void redox::graphics::Material::upload() {
+	UploadBatch batch;
+	upload(batch);
+	batch.wait();
+}
+
+void redox::graphics::Material::upload(UploadBatch& batch) {
 	for (auto& it : _textures)
-		it.second->upload();
+		it.second.texture->upload(batch);
+
+	_bind_textures();
 }
 
 redox::ResourceGroup redox::graphics::Material::res_group() const {
 	return ResourceGroup::GRAPHICS;
 }
 
+std::size_t redox::graphics::Material::memory_usage() const {
+	return 0;
+}
+
 void redox::graphics::Material::set_buffer(BufferKeys key, const UniformBuffer& buffer) {
 
 	switch (key) {
@@ -54,16 +67,54 @@ void redox::graphics::Material::set_buffer(BufferKeys key, const UniformBuffer&
 	}
 }
 
-void redox::graphics::Material::set_texture(TextureKeys key, ResourceHandle<SampleTexture> texture) {
+void redox::graphics::Material::set_texture(TextureKeys key, ResourceHandle<SampleTexture> texture, Path source) {
+	_textures.insert_or_assign(key, texture_binding{ std::move(texture), std::move(source), 0 });
+}
 
-	switch (key) {
-	case redox::graphics::TextureKeys::ALBEDO:
-		_descSet.bind_resource(*texture, 1);
-		break;
-	case redox::graphics::TextureKeys::NORMAL:
-		_descSet.bind_resource(*texture, 2);
-		break;
+bool redox::graphics::Material::replace_texture(const Path& source, const ResourceHandle<SampleTexture>& oldTexture,
+	const ResourceHandle<SampleTexture>& newTexture) {
+
+	Buffer<TextureKeys> keys;
+	for (const auto& [key, binding] : _textures) {
+		if (binding.texture == oldTexture && binding.source == source)
+			keys.push_back(key);
 	}
 
-	_textures.insert({ key, std::move(texture) });
+	if (keys.empty())
+		return false;
+
+	//The descriptor set is rewritten by the next bind, after the frame in flight completed.
+	//Until then that frame may still sample the old image
+	for (auto key : keys)
+		set_texture(key, newTexture, source);
+
+	Graphics::instance().release_queue().release(oldTexture);
+
+	return true;
+}
+
+void redox::graphics::Material::visit_textures(FunctionRef<void(const ResourceHandle<SampleTexture>&)> fn) const {
+	for (const auto& it : _textures)
+		fn(it.second.texture);
+}
+
+void redox::graphics::Material::_bind_textures() {
+	for (auto& [key, binding] : _textures) {
+		auto generation = binding.texture->generation();
+		if (generation == 0 || generation == binding.generation)
+			continue;
+
+		switch (key) {
+		case redox::graphics::TextureKeys::ALBEDO:
+			_descSet.bind_resource(binding.texture->texture(), 1);
+			break;
+		case redox::graphics::TextureKeys::NORMAL:
+			_descSet.bind_resource(binding.texture->texture(), 2);
+			break;
+		default:
+			break;
+		}
+
+		binding.generation = generation;
+	}
 }
@@ -33,6 +33,7 @@ SOFTWARE.
 
 namespace redox::graphics {
 	class CommandBufferView;
+	class UploadBatch;
 
 	enum class TextureKeys {
 		ALBEDO, ROUGHNESS_METALNESS, NORMAL, DISPLACEMENT, LIGHT, OCCLUSION
@@ -44,20 +45,39 @@ namespace redox::graphics {
 
 	class Material : public IResource {
 	public:
-		Material(PipelineHandle pipeline, DescriptorSetView descSet);
+		Material(PipelineHandle pipeline, DescriptorSet descSet);
 		~Material() override = default;
 
 		void bind(const CommandBufferView& commandBuffer);
 		void upload() override;
+		void upload(UploadBatch& batch);
 		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
 
 		void set_buffer(BufferKeys key, const UniformBuffer& buffer);
-		void set_texture(TextureKeys key, ResourceHandle<SampleTexture> texture);
+		//Written to the descriptor set by the next bind or upload. source is the resolved path
+		//the texture was requested from, identical files may share one texture
+		void set_texture(TextureKeys key, ResourceHandle<SampleTexture> texture, Path source);
+
+		//Rebinds every slot loaded from source that references oldTexture, returns true if any did
+		bool replace_texture(const Path& source, const ResourceHandle<SampleTexture>& oldTexture,
+			const ResourceHandle<SampleTexture>& newTexture);
+
+		void visit_textures(FunctionRef<void(const ResourceHandle<SampleTexture>&)> fn) const;
 
 	private:
-		DescriptorSetView _descSet;
+		struct texture_binding {
+			ResourceHandle<SampleTexture> texture;
+			Path source;
+			u64 generation; //Of the image currently in the descriptor set
+		};
+
+		//Writes the images of textures that were uploaded or streamed since they were last bound
+		void _bind_textures();
+
+		DescriptorSet _descSet;
 		PipelineHandle _pipeline;
 
-		redox::Hashmap<TextureKeys, ResourceHandle<SampleTexture>> _textures;
+		redox::Hashmap<TextureKeys, texture_binding> _textures;
 	};
 }
\ No newline at end of file
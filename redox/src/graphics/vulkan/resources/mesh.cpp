@@ -26,40 +26,142 @@ SOFTWARE.
 #include "mesh.h"
 #include "graphics\vulkan\graphics.h"
 #include "graphics\vulkan\command_pool.h"
+#include "graphics\vulkan\pipeline.h"
 
-redox::graphics::Mesh::Mesh(const redox::Buffer<MeshVertex>& vertices,
-	const redox::Buffer<uint16_t>& indices, redox::Buffer<SubMesh> submeshes) :
+#include <algorithm> //std::max, std::max_element
+
+namespace {
+	VkIndexType select_index_type(const redox::Buffer<uint32_t>& indices) {
+		auto max = std::max_element(indices.begin(), indices.end());
+		return (max == indices.end() || *max <= UINT16_MAX) ?
+			VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
+	VkDeviceSize index_size(VkIndexType type) {
+		return type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	//Whole words, the culling shader reads 16 bit indices in pairs
+	VkDeviceSize index_buffer_size(std::size_t count, VkIndexType type) {
+		return (count * index_size(type) + 3) & ~VkDeviceSize(3);
+	}
+
+	void buffer_barrier(VkCommandBuffer commandBuffer, VkBuffer buffer,
+		VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+}
+
+redox::graphics::MeshLod redox::graphics::SubMesh::select_lod(f32 maxError) const {
+	for (auto i = lodCount; i > 0; --i) {
+		if (lods[i - 1].error <= maxError) {
+			return lods[i - 1];
+		}
+	}
+	return { indexOffset, indexCount, 0.0f, meshletOffset, meshletCount };
+}
+
+redox::graphics::Mesh::Mesh(const redox::Buffer<MeshVertex>& vertices, const redox::Buffer<uint32_t>& indices,
+	redox::Buffer<SubMesh> submeshes, const redox::Buffer<Meshlet>& meshlets) :
 	_vertexCount(vertices.size()),
 	_indexCount(indices.size()),
+	_meshletCount(meshlets.size()),
+	_indexType(select_index_type(indices)),
 	_submeshes(std::move(submeshes)),
-	_vertexBuffer(util::byte_size(vertices)),
-	_indexBuffer(util::byte_size(indices)) {
+	_indexBuffer(index_buffer_size(indices.size(), _indexType)),
+	_vertexBuffer(util::byte_size(vertices)) {
 
 	_vertexBuffer.map([&vertices](void* dest) {
 		std::memcpy(dest, vertices.data(), util::byte_size(vertices));
 	});
 
-	_indexBuffer.map([&indices](void* dest) {
-		std::memcpy(dest, indices.data(), util::byte_size(indices));
+	for (const auto& vertex : vertices) {
+		_boundsRadius = std::max(_boundsRadius, vertex.pos.length());
+	}
+
+	_indexBuffer.map([this, &indices](void* dest) {
+		if (_indexType == VK_INDEX_TYPE_UINT32) {
+			std::memcpy(dest, indices.data(), util::byte_size(indices));
+			return;
+		}
+
+		//Narrowed while copying into the staging buffer
+		auto narrow = static_cast<uint16_t*>(dest);
+		for (std::size_t i = 0; i < indices.size(); ++i) {
+			narrow[i] = static_cast<uint16_t>(indices[i]);
+		}
 	});
+
+	if (meshlets.empty()) {
+		return;
+	}
+
+	_meshletBuffer = make_unique<StorageBuffer>(util::byte_size(meshlets));
+	_meshletBuffer->map([&meshlets](void* dest) {
+		std::memcpy(dest, meshlets.data(), util::byte_size(meshlets));
+	});
+
+	_culledIndexBuffer = make_unique<graphics::Buffer>(indices.size() * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	_drawBuffer = make_unique<graphics::Buffer>(_submeshes.size() * sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 }
 
 void redox::graphics::Mesh::bind(const CommandBufferView& commandBuffer) {
 	VkBuffer vb = _vertexBuffer.handle();
 	VkDeviceSize offset = 0;
 	vkCmdBindVertexBuffers(commandBuffer.handle(), 0, 1, &vb, &offset);
-	vkCmdBindIndexBuffer(commandBuffer.handle(), _indexBuffer.handle(), 0, VK_INDEX_TYPE_UINT16);
+	vkCmdBindIndexBuffer(commandBuffer.handle(), _indexBuffer.handle(), 0, _indexType);
 }
 
 void redox::graphics::Mesh::upload() {
-	_vertexBuffer.upload();
-	_indexBuffer.upload();
+	UploadBatch batch;
+	upload(batch);
+	batch.wait();
+}
+
+void redox::graphics::Mesh::upload(UploadBatch& batch) {
+	_vertexBuffer.upload(batch);
+	_indexBuffer.upload(batch);
+
+	if (_meshletBuffer) {
+		_meshletBuffer->upload(batch);
+	}
 }
 
 redox::ResourceGroup redox::graphics::Mesh::res_group() const {
 	return ResourceGroup::GRAPHICS;
 }
 
+std::size_t redox::graphics::Mesh::memory_usage() const {
+	//Staging memory is only held until the upload
+	auto staged = _vertexBuffer.size() + _indexBuffer.size();
+	VkDeviceSize culling = 0;
+
+	if (_meshletBuffer) {
+		staged += _meshletBuffer->size();
+		culling = _culledIndexBuffer->size() + _drawBuffer->size();
+	}
+
+	return static_cast<std::size_t>(staged + culling);
+}
+
+redox::f32 redox::graphics::Mesh::bounds_radius() const {
+	return _boundsRadius;
+}
+
 uint32_t redox::graphics::Mesh::vertex_count() const {
 	return _vertexCount;
 }
@@ -68,6 +170,89 @@ uint32_t redox::graphics::Mesh::index_count() const {
 	return _indexCount;
 }
 
+VkIndexType redox::graphics::Mesh::index_type() const {
+	return _indexType;
+}
+
 const redox::Buffer<redox::graphics::SubMesh>& redox::graphics::Mesh::submeshes() const {
 	return _submeshes;
 }
+
+uint32_t redox::graphics::Mesh::meshlet_count() const {
+	return _meshletCount;
+}
+
+bool redox::graphics::Mesh::culling_enabled() const {
+	return _cullSet.has_value();
+}
+
+void redox::graphics::Mesh::init_culling(SharedPtr<Pipeline> pipeline, DescriptorSet descSet) {
+	if (!_meshletBuffer) {
+		throw Exception("mesh has no meshlets to cull");
+	}
+
+	descSet.bind_storage(_meshletBuffer->handle(), 1);
+	descSet.bind_storage(_indexBuffer.handle(), 2);
+	descSet.bind_storage(_culledIndexBuffer->handle(), 3);
+	descSet.bind_storage(_drawBuffer->handle(), 4);
+
+	_cullPipeline = std::move(pipeline);
+	_cullSet.emplace(std::move(descSet));
+}
+
+void redox::graphics::Mesh::set_view_buffer(const UniformBuffer& buffer) {
+	if (_cullSet) {
+		_cullSet->bind_resource(buffer, 0);
+	}
+}
+
+void redox::graphics::Mesh::cull(const CommandBufferView& commandBuffer, const redox::Buffer<MeshLod>& levels) {
+	auto cb = commandBuffer.handle();
+
+	//Every submesh draws from its own region of the compacted buffer, visible meshlets are appended to it
+	redox::Buffer<VkDrawIndexedIndirectCommand> draws(_submeshes.size());
+	for (std::size_t i = 0; i < _submeshes.size(); ++i) {
+		draws[i] = { 0, 1, _submeshes[i].indexOffset, _submeshes[i].vertexOffset, 0 };
+	}
+
+	vkCmdUpdateBuffer(cb, _drawBuffer->handle(), 0, util::byte_size(draws), draws.data());
+	buffer_barrier(cb, _drawBuffer->handle(),
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	_cullPipeline->bind(commandBuffer);
+	_cullSet->bind(commandBuffer, *_cullPipeline);
+
+	for (std::size_t i = 0; i < levels.size() && i < _submeshes.size(); ++i) {
+		if (levels[i].meshletCount == 0) {
+			continue;
+		}
+
+		ClusterCullConstants constants{
+			levels[i].meshletOffset, levels[i].meshletCount,
+			static_cast<uint32_t>(i), _indexType == VK_INDEX_TYPE_UINT16 ? 1u : 0u
+		};
+
+		_cullPipeline->push_constants(commandBuffer, &constants, sizeof(constants));
+		vkCmdDispatch(cb, levels[i].meshletCount, 1, 1);
+	}
+
+	buffer_barrier(cb, _drawBuffer->handle(),
+		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	buffer_barrier(cb, _culledIndexBuffer->handle(),
+		VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDEX_READ_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+}
+
+void redox::graphics::Mesh::bind_culled(const CommandBufferView& commandBuffer) {
+	VkBuffer vb = _vertexBuffer.handle();
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer.handle(), 0, 1, &vb, &offset);
+	vkCmdBindIndexBuffer(commandBuffer.handle(), _culledIndexBuffer->handle(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void redox::graphics::Mesh::draw_culled(const CommandBufferView& commandBuffer, std::size_t submesh) {
+	vkCmdDrawIndexedIndirect(commandBuffer.handle(), _drawBuffer->handle(),
+		submesh * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+}
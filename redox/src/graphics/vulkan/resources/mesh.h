@@ -26,11 +26,15 @@ SOFTWARE.
 #pragma once
 #include "graphics\vulkan\vulkan.h"
 #include "graphics\vulkan\buffer.h"
+#include "graphics\vulkan\descriptor_pool.h"
 #include "math\math.h"
 #include "resources\resource.h"
 
+#include <optional> //std::optional
+
 namespace redox::graphics {
 	class CommandBufferView;
+	class Pipeline;
 
 	struct MeshVertex {
 		math::Vec3f pos;
@@ -38,34 +42,105 @@ namespace redox::graphics {
 		math::Vec2f uv;
 	};
 
+	constexpr std::size_t MAX_MESH_LODS = 4;
+	constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+	constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	//Contiguous run of triangles culled as a whole, std430 layout of the cluster culling shader
+	struct Meshlet {
+		f32 center[3];
+		f32 radius;
+		f32 coneAxis[3];
+		f32 coneCutoff; //Sine of the normal cone angle, 1 if the meshlet can't be backface culled
+		uint32_t indexOffset;
+		uint32_t indexCount;
+		uint32_t padding[2];
+	};
+
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match the std430 layout");
+
+	//Push constants of the cluster culling shader, dispatched once per submesh
+	struct ClusterCullConstants {
+		uint32_t meshletOffset;
+		uint32_t meshletCount;
+		uint32_t drawIndex;
+		uint32_t shortIndices; //Source indices are packed two per word
+	};
+
+	//Reduced index range over the same vertices, error is the object space deviation from LOD0
+	struct MeshLod {
+		uint32_t indexOffset;
+		uint32_t indexCount;
+		f32 error;
+		uint32_t meshletOffset;
+		uint32_t meshletCount;
+	};
+
 	struct SubMesh {
 		uint32_t indexOffset;
 		uint32_t indexCount;
+		int32_t vertexOffset; //Indices are relative to the first vertex of the submesh
 		std::size_t materialIndex;
+
+		uint32_t meshletOffset{ 0 }; //Meshlets of the full detail range
+		uint32_t meshletCount{ 0 };
+
+		uint32_t lodCount{ 0 }; //Excluding the full detail range above
+		MeshLod lods[MAX_MESH_LODS]{};
+
+		//Coarsest level whose error stays within maxError, LOD0 if none does
+		MeshLod select_lod(f32 maxError) const;
 	};
 
 	class Mesh : public IResource {
 	public:
-		Mesh(const redox::Buffer<MeshVertex>& vertices, 
-			const redox::Buffer<uint16_t>& indices, redox::Buffer<SubMesh> submeshes);
+		//Indices are stored 16 bit wide whenever every index fits
+		Mesh(const redox::Buffer<MeshVertex>& vertices, const redox::Buffer<uint32_t>& indices,
+			redox::Buffer<SubMesh> submeshes, const redox::Buffer<Meshlet>& meshlets = {});
 		~Mesh() override = default;
 
 		void bind(const CommandBufferView& commandBuffer);
 		void upload() override;
+		void upload(UploadBatch& batch);
 		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
 
 		uint32_t vertex_count() const;
 		uint32_t index_count() const;
+		VkIndexType index_type() const;
+
+		//Radius of the sphere around the object space origin enclosing every vertex
+		f32 bounds_radius() const;
 
 		const redox::Buffer<SubMesh>& submeshes() const;
 
+		//Cluster culling, available once init_culling was called on a mesh with meshlets
+		uint32_t meshlet_count() const;
+		bool culling_enabled() const;
+		void init_culling(SharedPtr<Pipeline> pipeline, DescriptorSet descSet);
+		void set_view_buffer(const UniformBuffer& buffer);
+
+		//Records the culling pass outside of a render pass, levels holds one range per submesh
+		void cull(const CommandBufferView& commandBuffer, const redox::Buffer<MeshLod>& levels);
+		void bind_culled(const CommandBufferView& commandBuffer);
+		void draw_culled(const CommandBufferView& commandBuffer, std::size_t submesh);
+
 	private:
 		uint32_t _vertexCount;
 		uint32_t _indexCount;
+		uint32_t _meshletCount;
+		VkIndexType _indexType;
+		f32 _boundsRadius{ 0.0f };
 
 		redox::Buffer<SubMesh> _submeshes;
 
 		IndexBuffer _indexBuffer;
 		VertexBuffer _vertexBuffer;
+
+		UniquePtr<StorageBuffer> _meshletBuffer;
+		UniquePtr<graphics::Buffer> _culledIndexBuffer; //Compacted visible triangles, one region per submesh
+		UniquePtr<graphics::Buffer> _drawBuffer; //VkDrawIndexedIndirectCommand per submesh
+		SharedPtr<Pipeline> _cullPipeline;
+		std::optional<DescriptorSet> _cullSet;
 	};
 }
\ No newline at end of file
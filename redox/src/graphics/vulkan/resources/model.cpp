@@ -24,6 +24,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "model.h"
+#include "graphics\vulkan\upload_batch.h"
 
 redox::graphics::Model::Model(mesh_buffer meshBuffer, material_buffer materialBuffer) : 
 	_meshes(std::move(meshBuffer)),
@@ -31,17 +32,48 @@ redox::graphics::Model::Model(mesh_buffer meshBuffer, material_buffer materialBu
 }
 
 void redox::graphics::Model::upload() {
+	//One submission and wait for all meshes and textures
+	UploadBatch batch;
 	for (auto& mat : _materials)
-		mat->upload();
+		mat->upload(batch);
 
 	for (auto& mesh : _meshes)
-		mesh->upload();
+		mesh->upload(batch);
+
+	batch.wait();
 }
 
 redox::ResourceGroup redox::graphics::Model::res_group() const {
 	return ResourceGroup::GRAPHICS;
 }
 
+std::size_t redox::graphics::Model::memory_usage() const {
+	//Textures are cached and accounted for separately
+	std::size_t size{ 0 };
+	for (const auto& mesh : _meshes)
+		size += mesh->memory_usage();
+
+	return size;
+}
+
+bool redox::graphics::Model::patch_dependency(const Path& dependency, const ResourceHandle<IResource>& oldDependency,
+	const ResourceHandle<IResource>& newDependency) {
+
+	//Textures can be swapped in the descriptor sets, anything else (e.g. buffers) needs a full reload
+	auto oldTexture = std::dynamic_pointer_cast<SampleTexture>(oldDependency);
+	auto newTexture = std::dynamic_pointer_cast<SampleTexture>(newDependency);
+	if (!oldTexture || !newTexture) {
+		return false;
+	}
+
+	//Identical files share one texture, only the slots loaded from the reloaded file are rebound
+	bool patched = false;
+	for (auto& mat : _materials)
+		patched |= mat->replace_texture(dependency, oldTexture, newTexture);
+
+	return patched;
+}
+
 const redox::graphics::Model::mesh_buffer& redox::graphics::Model::meshes() const {
 	return _meshes;
 }
@@ -40,6 +40,9 @@ namespace redox::graphics {
 		~Model() override = default;
 		void upload() override;
 		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
+		bool patch_dependency(const Path& dependency, const ResourceHandle<IResource>& oldDependency,
+			const ResourceHandle<IResource>& newDependency) override;
 
 		const mesh_buffer& meshes() const;
 		const material_buffer& materials() const;
@@ -28,12 +28,14 @@ SOFTWARE.
 
 #include "platform\filesystem.h"
 
-redox::graphics::Shader::Shader(const redox::Buffer<i8>& buffer) {
+redox::graphics::Shader::Shader(const io::FileView& code) :
+	_codeSize(code.size()),
+	_reflection(spirv::reflect(reinterpret_cast<const u32*>(code.data()), code.size() / sizeof(u32))) {
 
 	VkShaderModuleCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = buffer.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
+	createInfo.codeSize = code.size();
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
 
 	if (vkCreateShaderModule(Graphics::instance().device(), &createInfo, nullptr, &_handle) != VK_SUCCESS)
 		throw Exception("failed to create shader module");
@@ -47,6 +49,10 @@ VkShaderModule redox::graphics::Shader::handle() const {
 	return _handle;
 }
 
+const redox::spirv::shader_info& redox::graphics::Shader::reflection() const {
+	return _reflection;
+}
+
 void redox::graphics::Shader::upload() {
 	//SPIR-V compile...?
 }
@@ -54,3 +60,7 @@ void redox::graphics::Shader::upload() {
 redox::ResourceGroup redox::graphics::Shader::res_group() const {
 	return ResourceGroup::GRAPHICS;
 }
+
+std::size_t redox::graphics::Shader::memory_usage() const {
+	return _codeSize;
+}
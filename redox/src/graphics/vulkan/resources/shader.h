@@ -28,20 +28,25 @@ SOFTWARE.
 #include <resources/resource.h>
 #include <core/core.h>
 #include <platform/filesystem.h>
+#include <graphics/vulkan/spirv_reflection.h>
 
 namespace redox::graphics {
 
 	class Shader : public IResource
 	{
 	public:
-		Shader(const redox::Buffer<i8>& buffer);
+		Shader(const io::FileView& code);
 		~Shader() override;
 
 		VkShaderModule handle() const;
+		const spirv::shader_info& reflection() const;
 		void upload() override;
 		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
 
 	private:
 		VkShaderModule _handle;
+		std::size_t _codeSize;
+		spirv::shader_info _reflection;
 	};
 }
\ No newline at end of file
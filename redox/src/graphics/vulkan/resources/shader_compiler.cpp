@@ -25,29 +25,224 @@ SOFTWARE.
 */
 #include "shader_compiler.h"
 #include <core/application.h>
-#include <platform/filesystem.h>
+#include <core/hash/xxhash.h>
 #include <platform/process.h>
+#include <resources/resource_manager.h>
 
-redox::Path redox::graphics::ShaderCompiler::compile(const Path& source, const Path& outputFolder, bool overwrite) {
-	std::hash<Path> hash;
-	auto cacheFile = outputFolder / (redox::lexical_cast(hash(source)) + ".spv");
+#include <atomic> //std::atomic
+#include <sstream> //std::istringstream
 
-	if (!io::exists(cacheFile) || overwrite) {
-		RDX_LOG("Compiling shader...");
+#ifdef RDX_SHADERC
+#include <shaderc/shaderc.h>
+#endif
 
-		auto args = redox::format("glslangValidator -o {0} -V {1}", cacheFile, source);
+namespace {
+	//Bump whenever the compiler or its settings change in a way the flags don't capture
+	constexpr redox::u32 COMPILER_VERSION = 1;
+
+#ifdef RDX_SHADERC
+	constexpr redox::StringView COMPILER_FLAGS = "shaderc vulkan1.0 O0";
+#else
+	constexpr redox::StringView COMPILER_FLAGS = "glslangValidator -V";
+#endif
+
+	struct shader_source {
+		redox::Path path;
+		redox::String code;
+	};
+
+	//Includes are resolved relative to the including file, like GL_GOOGLE_include_directive does
+	void collect_sources(const redox::Path& path, redox::Buffer<shader_source>& sources) {
+		for (const auto& source : sources) {
+			if (source.path == path) {
+				return;
+			}
+		}
+
+		auto vfs = redox::ResourceManager::instance()->vfs();
+		auto file = vfs->read(path);
+		//Copied, the recursion below may reallocate sources
+		auto code = sources.emplace_back(shader_source{ path, redox::String(file.begin(), file.end()) }).code;
+
+		std::istringstream lines(code);
+		for (redox::String line; std::getline(lines, line);) {
+			auto directive = line.find_first_not_of(" \t");
+			if (directive == redox::String::npos || line.compare(directive, 8, "#include") != 0) {
+				continue;
+			}
+
+			auto first = line.find_first_of("\"<", directive + 8);
+			auto last = line.find_first_of("\">", first + 1);
+			if (first == redox::String::npos || last == redox::String::npos) {
+				continue;
+			}
+
+			//Missing files are reported by the compiler
+			auto include = (path.parent_path() / line.substr(first + 1, last - first - 1)).lexically_normal();
+			if (vfs->exists(include)) {
+				collect_sources(include, sources);
+			}
+		}
+	}
+
+	redox::u64 hash_sources(const redox::Buffer<shader_source>& sources, const redox::Buffer<redox::String>& defines) {
+		auto hash = redox::hash::xxh64(COMPILER_FLAGS.data(), COMPILER_FLAGS.size());
+		for (const auto& define : defines) {
+			//Terminator included, so that A,BC and AB,C differ
+			hash = redox::hash::xxh64(define.c_str(), define.size() + 1, hash);
+		}
+
+		for (const auto& source : sources) {
+			auto name = source.path.filename().string();
+			hash = redox::hash::xxh64(name.data(), name.size(), hash);
+			hash = redox::hash::xxh64(source.code.data(), source.code.size(), hash);
+		}
+		return hash;
+	}
+
+#ifdef RDX_SHADERC
+	shaderc_shader_kind shader_kind(const redox::Path& path) {
+		auto ext = path.extension();
+		if (ext == ".vert") return shaderc_vertex_shader;
+		if (ext == ".frag") return shaderc_fragment_shader;
+		if (ext == ".geom") return shaderc_geometry_shader;
+		if (ext == ".comp") return shaderc_compute_shader;
+		throw redox::Exception("unknown shader stage");
+	}
+
+	struct include_result {
+		shaderc_include_result result;
+		redox::String name;
+	};
+
+	//Includes are served from the sources that were hashed, the compiler never touches the disk
+	shaderc_include_result* resolve_include(void* userData, const char* requested, int,
+		const char* requesting, std::size_t) {
+
+		const auto& sources = *static_cast<const redox::Buffer<shader_source>*>(userData);
+		auto path = (redox::Path(requesting).parent_path() / requested).lexically_normal();
+
+		auto include = new include_result{};
+		for (const auto& source : sources) {
+			if (source.path == path) {
+				include->name = path.string();
+				include->result.content = source.code.data();
+				include->result.content_length = source.code.size();
+				break;
+			}
+		}
+
+		//An empty name signals failure, the content is the error message
+		static constexpr redox::StringView notFound = "include file not found";
+		if (include->name.empty()) {
+			include->result.content = notFound.data();
+			include->result.content_length = notFound.size();
+		}
+
+		include->result.source_name = include->name.data();
+		include->result.source_name_length = include->name.size();
+		include->result.user_data = include;
+		return &include->result;
+	}
+
+	void release_include(void*, shaderc_include_result* result) {
+		delete static_cast<include_result*>(result->user_data);
+	}
+
+	redox::Buffer<redox::byte> compile_spirv(const redox::Buffer<shader_source>& sources,
+		const redox::Buffer<redox::String>& defines) {
+
+		const auto& main = sources.front();
+		auto name = main.path.string();
+
+		auto compiler = shaderc_compiler_initialize();
+		auto options = shaderc_compile_options_initialize();
+		shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+		shaderc_compile_options_set_include_callbacks(options, resolve_include, release_include,
+			const_cast<redox::Buffer<shader_source>*>(&sources));
+
+		for (const auto& define : defines) {
+			shaderc_compile_options_add_macro_definition(options, define.data(), define.size(), nullptr, 0);
+		}
+
+		auto result = shaderc_compile_into_spv(compiler, main.code.data(), main.code.size(),
+			shader_kind(main.path), name.c_str(), "main", options);
+
+		RDX_SCOPE_GUARD([compiler, options, result]() {
+			shaderc_result_release(result);
+			shaderc_compile_options_release(options);
+			shaderc_compiler_release(compiler);
+		});
+
+		if (shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success) {
+			RDX_LOG("Failed to compile shader {0}\n{1}", redox::ConsoleColor::RED,
+				main.path, shaderc_result_get_error_message(result));
+			throw redox::Exception("failed to compile shader.");
+		}
+
+		auto spirv = reinterpret_cast<const redox::byte*>(shaderc_result_get_bytes(result));
+		return redox::Buffer<redox::byte>(spirv, spirv + shaderc_result_get_length(result));
+	}
+#else
+	redox::Buffer<redox::byte> compile_spirv(const redox::Buffer<shader_source>& sources,
+		const redox::Buffer<redox::String>& defines) {
+
+		static std::atomic<redox::u64> counter{ 0 };
+
+		const auto& main = sources.front();
+		auto output = redox::io::temp_directory_path() /
+			redox::format("redox_shader_{0}.spv", counter++);
+
+		RDX_SCOPE_GUARD([output]() {
+			std::error_code ec;
+			redox::io::remove(output, ec);
+		});
+
+		redox::String args = redox::format("glslangValidator -o {0} -V", output);
+		for (const auto& define : defines) {
+			args += " -D" + define;
+		}
+		args += redox::format(" {0}", main.path);
 		RDX_DEBUG_LOG("{0}", args);
 
-		platform::Process p(args);
+		redox::platform::Process p(args);
 		auto result = p.join();
 
 		if (result.errorCode != 0) {
-			RDX_LOG("Failed to compile shader [Exit Code: {0}] \n {1}", ConsoleColor::RED,
+			RDX_LOG("Failed to compile shader [Exit Code: {0}] \n {1}", redox::ConsoleColor::RED,
 				result.errorCode, result.stdOut);
-			throw Exception("failed to invoke glslangValidator.");
+			throw redox::Exception("failed to invoke glslangValidator.");
 		}
 
+		redox::io::File file(output, redox::io::File::Mode::READ | redox::io::File::Mode::THROW_IF_INVALID);
+		auto spirv = file.read();
+		return redox::Buffer<redox::byte>(spirv.begin(), spirv.end());
+	}
+#endif
+}
+
+redox::io::FileView redox::graphics::ShaderCompiler::compile(const Path& source, const Buffer<String>& defines) {
+	redox::Buffer<shader_source> sources;
+	collect_sources(source, sources);
+
+	auto resources = ResourceManager::instance();
+	for (std::size_t i = 1; i < sources.size(); ++i) {
+		resources->add_dependency(sources[i].path);
+	}
+
+	auto cache = resources->derived_data();
+	auto contentHash = hash_sources(sources, defines);
+
+	if (auto cached = cache ? cache->load("shaders", contentHash, COMPILER_VERSION) : std::nullopt) {
+		return *cached;
+	}
+
+	RDX_LOG("Compiling shader {0}...", source.filename());
+	auto spirv = compile_spirv(sources, defines);
+
+	if (cache) {
+		cache->store("shaders", contentHash, COMPILER_VERSION, spirv.data(), spirv.size());
 	}
 
-	return cacheFile;
+	return io::FileView(std::move(spirv));
 }
@@ -26,10 +26,23 @@ SOFTWARE.
 #pragma once
 #include <core/core.h>
 #include <core/non_copyable.h>
+#include <platform/filesystem.h>
+
+//Compiles in-process through the shaderc library of the Vulkan SDK (shaderc_combined.lib).
+//Define RDX_GLSLANG_VALIDATOR to run the glslangValidator executable for every shader instead
+//#define RDX_GLSLANG_VALIDATOR
+
+#ifndef RDX_GLSLANG_VALIDATOR
+#define RDX_SHADERC
+#endif
 
 namespace redox::graphics {
 	class ShaderCompiler : public NonCopyable {
 	public:
-		static Path compile(const Path& source, const Path& outputFolder, bool overwrite = false);
+		//SPIR-V of a GLSL source, the stage is taken from the extension and every define is set
+		//without a value. Results are kept in the derived data cache keyed by the source, everything
+		//it includes, the defines and the compiler flags. Included files are recorded as dependencies
+		//of the resource being loaded
+		static io::FileView compile(const Path& source, const Buffer<String>& defines = {});
 	};
 }
\ No newline at end of file
@@ -27,9 +27,14 @@ SOFTWARE.
 #include "graphics\vulkan\graphics.h"
 #include "graphics\vulkan\render_system.h"
 #include "graphics\vulkan\command_pool.h"
+#include "graphics\vulkan\upload_batch.h"
+
+#include <algorithm> //std::min, std::max
 
 redox::graphics::Texture::Texture(VkFormat format, const VkExtent2D& size,
-	VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags) :
+	VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags, u32 mipLevels) :
+	_sampler(mipLevels),
+	_mipLevels(mipLevels),
 	_format(format),
 	_dimensions(size),
 	_usageFlags(usage),
@@ -45,8 +50,8 @@ redox::graphics::Texture::~Texture() {
 
 void redox::graphics::Texture::_destroy() {
 	vkDestroyImage(Graphics::instance().device(), _handle, nullptr);
-	vkFreeMemory(Graphics::instance().device(), _memory, nullptr);
 	vkDestroyImageView(Graphics::instance().device(), _view, nullptr);
+	Graphics::instance().allocator().free(_memory);
 }
 
 VkImage redox::graphics::Texture::handle() const {
@@ -69,6 +74,14 @@ const redox::graphics::Sampler& redox::graphics::Texture::sampler() const {
 	return _sampler;
 }
 
+VkDeviceSize redox::graphics::Texture::memory_size() const {
+	return _memorySize;
+}
+
+redox::u32 redox::graphics::Texture::mip_levels() const {
+	return _mipLevels;
+}
+
 void redox::graphics::Texture::_init() {
 
 	VkImageCreateInfo imageInfo{};
@@ -77,7 +90,7 @@ void redox::graphics::Texture::_init() {
 	imageInfo.extent.width = _dimensions.width;
 	imageInfo.extent.height = _dimensions.height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
+	imageInfo.mipLevels = _mipLevels;
 	imageInfo.arrayLayers = 1;
 	imageInfo.format = _format;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -89,21 +102,8 @@ void redox::graphics::Texture::_init() {
 	if (vkCreateImage(Graphics::instance().device(), &imageInfo, nullptr, &_handle) != VK_SUCCESS)
 		throw Exception("failed to create image");
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(Graphics::instance().device(), _handle, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	auto memType = Graphics::instance().pick_memory_type(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-	if (!memType)
-		throw Exception("could not find suitable memory type");
-	allocInfo.memoryTypeIndex = memType.value();
-
-	if (vkAllocateMemory(Graphics::instance().device(), &allocInfo, nullptr, &_memory) != VK_SUCCESS)
-		throw Exception("failed to allocate image memory");
-
-	vkBindImageMemory(Graphics::instance().device(), _handle, _memory, 0);
+	_memory = Graphics::instance().allocator().bind_image(_handle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	_memorySize = _memory.size;
 }
 
 void redox::graphics::Texture::_init_view() {
@@ -114,7 +114,7 @@ void redox::graphics::Texture::_init_view() {
 	viewInfo.format = _format;
 	viewInfo.subresourceRange.aspectMask = _viewAspectFlags; //VK_IMAGE_ASPECT_COLOR_BIT;
 	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.levelCount = _mipLevels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = 1;
 
@@ -123,7 +123,14 @@ void redox::graphics::Texture::_init_view() {
 }
 
 void redox::graphics::Texture::_transfer_layout(VkImageLayout oldLayout, VkImageLayout newLayout) const {
-	
+	AuxCommandPool::instance().submit([&](CommandBufferView cbo) {
+		_transfer_layout(cbo.handle(), oldLayout, newLayout);
+	});
+}
+
+void redox::graphics::Texture::_transfer_layout(VkCommandBuffer commandBuffer,
+	VkImageLayout oldLayout, VkImageLayout newLayout) const {
+
 	VkImageMemoryBarrier barrier{};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
@@ -132,7 +139,7 @@ void redox::graphics::Texture::_transfer_layout(VkImageLayout oldLayout, VkImage
 	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 	barrier.image = _handle;
 	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.levelCount = _mipLevels;
 	barrier.subresourceRange.baseArrayLayer = 0;
 	barrier.subresourceRange.layerCount = 1;
 
@@ -167,38 +174,146 @@ void redox::graphics::Texture::_transfer_layout(VkImageLayout oldLayout, VkImage
 	}
 	else throw Exception("unsupported layout transition");
 
-	AuxCommandPool::instance().submit([&](CommandBufferView cbo) {
-		vkCmdPipelineBarrier(cbo.handle(), sourceStage, destinationStage,
-			0, 0, nullptr, 0, nullptr, 1, &barrier);
-	});
+	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
-redox::graphics::StagedTexture::StagedTexture(const redox::Buffer<byte>& pixels, VkFormat format, const VkExtent2D& size,
-	VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags) :
-	Texture(format, size, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, viewAspectFlags),
-	_stagingBuffer(pixels.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) {
+redox::graphics::StagedTexture::StagedTexture(const byte* pixels, std::size_t size, VkFormat format, const VkExtent2D& extent,
+	VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags, const redox::Buffer<VkDeviceSize>& levelOffsets) :
+	Texture(format, extent, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, viewAspectFlags, static_cast<u32>(levelOffsets.size())),
+	_levelOffsets(levelOffsets) {
 
-	_stagingBuffer.map([&pixels](void* data) {
-		std::memcpy(data, pixels.data(), pixels.size());
-	});
+	_staging = Graphics::instance().staging_pool().acquire(size);
+	std::memcpy(_staging->data, pixels, size);
+}
+
+redox::graphics::StagedTexture::~StagedTexture() {
+	if (_staging) {
+		Graphics::instance().staging_pool().release(*_staging);
+	}
 }
 
 void redox::graphics::StagedTexture::map(FunctionRef<void(void*)> fn) {
-	_stagingBuffer.map(fn);
+	if (!_staging) {
+		throw Exception("texture was already uploaded");
+	}
+	fn(_staging->data);
 }
 
 void redox::graphics::StagedTexture::upload() {
-	_transfer_layout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	_stagingBuffer.copy_to(*this);
-	_transfer_layout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	if (!_staging) {
+		return;
+	}
+
+	UploadBatch batch;
+	upload(batch);
+	batch.wait();
+}
+
+void redox::graphics::StagedTexture::upload(UploadBatch& batch) {
+	if (!_staging) {
+		return;
+	}
+
+	auto commandBuffer = batch.command_buffer().handle();
+	_transfer_layout(commandBuffer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	batch.copy(*_staging, *this, _levelOffsets);
+	_transfer_layout(commandBuffer, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	_staging.reset();
 }
 
 redox::ResourceGroup redox::graphics::StagedTexture::res_group() const {
 	return ResourceGroup::GRAPHICS;
 }
 
-redox::graphics::SampleTexture::SampleTexture(const redox::Buffer<byte>& pixels, VkFormat format, const VkExtent2D& size) :
-	StagedTexture(pixels, format, size, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT) {
+std::size_t redox::graphics::StagedTexture::memory_usage() const {
+	return static_cast<std::size_t>(_memorySize + (_staging ? _staging->size : 0));
+}
+
+redox::graphics::SampleTexture::SampleTexture(redox::Buffer<byte> pixels, VkFormat format, const VkExtent2D& size,
+	redox::Buffer<VkDeviceSize> levelOffsets, u32 residentMip) :
+	_pixels(std::move(pixels)),
+	_levelOffsets(std::move(levelOffsets)),
+	_format(format),
+	_dimensions(size),
+	_residentMip(std::min(residentMip, static_cast<u32>(_levelOffsets.size()) - 1)) {
+}
+
+void redox::graphics::SampleTexture::upload() {
+	if (!_image) {
+		UploadBatch batch;
+		upload(batch);
+		batch.wait();
+	}
+}
+
+void redox::graphics::SampleTexture::upload(UploadBatch& batch) {
+	//Materials sharing this texture each upload it
+	if (!_image) {
+		set_resident(create_image(_residentMip), _residentMip, batch);
+	}
+}
+
+redox::ResourceGroup redox::graphics::SampleTexture::res_group() const {
+	return ResourceGroup::GRAPHICS;
+}
+
+std::size_t redox::graphics::SampleTexture::memory_usage() const {
+	return _pixels.size() + (_image ? _image->memory_usage() : 0);
+}
+
+const redox::graphics::Texture& redox::graphics::SampleTexture::texture() const {
+	if (!_image) {
+		throw Exception("texture was not uploaded");
+	}
+	return *_image;
+}
+
+redox::u64 redox::graphics::SampleTexture::generation() const {
+	return _generation;
+}
+
+const VkExtent2D& redox::graphics::SampleTexture::dimension() const {
+	return _dimensions;
+}
+
+redox::u32 redox::graphics::SampleTexture::mip_levels() const {
+	return static_cast<u32>(_levelOffsets.size());
+}
+
+redox::u32 redox::graphics::SampleTexture::resident_mip() const {
+	return _residentMip;
+}
+
+VkDeviceSize redox::graphics::SampleTexture::resident_size(u32 firstMip) const {
+	return _pixels.size() - _levelOffsets[firstMip];
+}
+
+redox::UniquePtr<redox::graphics::StagedTexture> redox::graphics::SampleTexture::create_image(u32 firstMip) const {
+	auto base = _levelOffsets[firstMip];
+
+	redox::Buffer<VkDeviceSize> levelOffsets;
+	for (auto i = firstMip; i < _levelOffsets.size(); ++i) {
+		levelOffsets.push_back(_levelOffsets[i] - base);
+	}
+
+	VkExtent2D extent{ std::max(_dimensions.width >> firstMip, 1u), std::max(_dimensions.height >> firstMip, 1u) };
+
+	return make_unique<StagedTexture>(_pixels.data() + base, static_cast<std::size_t>(_pixels.size() - base),
+		_format, extent, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, levelOffsets);
+}
+
+void redox::graphics::SampleTexture::set_resident(UniquePtr<StagedTexture> image, u32 firstMip, UploadBatch& batch) {
+	image->upload(batch);
+
+	//The frame in flight may still sample the old image
+	if (_image) {
+		Graphics::instance().release_queue().release(SharedPtr<StagedTexture>(std::move(_image)));
+	}
+
+	_image = std::move(image);
+	_residentMip = firstMip;
+	++_generation;
 }
 
 void redox::graphics::ResizableTexture::resize(const VkExtent2D& extent) {
@@ -32,11 +32,15 @@ SOFTWARE.
 
 #include "resources/resource.h"
 
+#include <optional> //std::optional
+
 namespace redox::graphics {
+	class UploadBatch;
+
 	class Texture : public NonCopyable {
 	public:
 		Texture(VkFormat format, const VkExtent2D& size, 
-			VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags);
+			VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags, u32 mipLevels = 1);
 		~Texture();
 
 		VkImage handle() const;
@@ -45,12 +49,15 @@ namespace redox::graphics {
 		const VkExtent2D& dimension() const;
 		const VkFormat& format() const;
 		const Sampler& sampler() const;
+		VkDeviceSize memory_size() const;
+		u32 mip_levels() const;
 	
 	protected:
 		void _destroy();
 		void _init();
 		void _init_view();
 		void _transfer_layout(VkImageLayout oldLayout, VkImageLayout newLayout) const;
+		void _transfer_layout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) const;
 
 		Sampler _sampler;
 		VkImage _handle;
@@ -58,9 +65,11 @@ namespace redox::graphics {
 
 		VkImageAspectFlags _viewAspectFlags;
 		VkImageUsageFlags _usageFlags;
-		VkDeviceMemory _memory;
+		MemoryAllocation _memory;
+		VkDeviceSize _memorySize;
 		VkFormat _format;
 		VkExtent2D _dimensions;
+		u32 _mipLevels;
 	};
 
 	class ResizableTexture : public Texture {
@@ -77,22 +86,66 @@ namespace redox::graphics {
 
 	class StagedTexture : public IResource, public Texture {
 	public:
-		StagedTexture(const redox::Buffer<byte>& pixels, VkFormat format,
-			const VkExtent2D& size, VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags);
+		//pixels holds the mip chain largest level first, each level starting at its levelOffsets entry
+		StagedTexture(const byte* pixels, std::size_t size, VkFormat format,
+			const VkExtent2D& extent, VkImageUsageFlags usage, VkImageAspectFlags viewAspectFlags,
+			const redox::Buffer<VkDeviceSize>& levelOffsets = { 0 });
 
 		void map(FunctionRef<void(void*)> fn);
 
-		~StagedTexture() override = default;
+		~StagedTexture() override;
+		//The staging memory is released once the image is filled, later calls do nothing
 		void upload() override;
+		void upload(UploadBatch& batch);
 		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
 
 	protected:
-		Buffer _stagingBuffer;
+		std::optional<StagingRegion> _staging;
+		redox::Buffer<VkDeviceSize> _levelOffsets;
 	};
 
-	class SampleTexture : public StagedTexture {
+	//Sampled texture that keeps its whole mip chain in host memory. The image only holds the
+	//levels from resident_mip() on, so the TextureStreamer can trade resolution for device memory
+	class SampleTexture : public IResource {
 	public:
-		SampleTexture(const redox::Buffer<byte>& pixels, VkFormat format, const VkExtent2D& size);
+		SampleTexture(redox::Buffer<byte> pixels, VkFormat format, const VkExtent2D& size,
+			redox::Buffer<VkDeviceSize> levelOffsets = { 0 }, u32 residentMip = 0);
+		~SampleTexture() override = default;
+
+		void upload() override;
+		void upload(UploadBatch& batch);
+		ResourceGroup res_group() const override;
+		std::size_t memory_usage() const override;
+
+		//Replaced whenever the residency changes, users rebind it once generation() moved on.
+		//Generation 0 means nothing was uploaded yet
+		const Texture& texture() const;
+		u64 generation() const;
+
+		const VkExtent2D& dimension() const;
+		u32 mip_levels() const;
+		u32 resident_mip() const;
+
+		//Device memory taken by the levels from firstMip on
+		VkDeviceSize resident_size(u32 firstMip) const;
+
+		//Creates and fills an image with the levels from firstMip on. Doesn't touch the queue,
+		//so it can run on worker threads while set_resident does the upload and the swap
+		UniquePtr<StagedTexture> create_image(u32 firstMip) const;
+
+		//The upload is recorded into batch and the image swapped right away, draws submitted after
+		//the batch see it filled. The previous image goes to the release queue
+		void set_resident(UniquePtr<StagedTexture> image, u32 firstMip, UploadBatch& batch);
+
+	private:
+		redox::Buffer<byte> _pixels;
+		redox::Buffer<VkDeviceSize> _levelOffsets;
+		VkFormat _format;
+		VkExtent2D _dimensions;
+		u32 _residentMip;
+		u64 _generation{ 0 };
+		UniquePtr<StagedTexture> _image;
 	};
 
 }
\ No newline at end of file
@@ -26,7 +26,7 @@ SOFTWARE.
 #include "sampler.h"
 #include "graphics.h"
 
-redox::graphics::Sampler::Sampler() {
+redox::graphics::Sampler::Sampler(u32 mipLevels) {
 
 	VkSamplerCreateInfo samplerInfo{};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -44,7 +44,7 @@ redox::graphics::Sampler::Sampler() {
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	samplerInfo.maxLod = static_cast<float>(mipLevels);
 
 	if (vkCreateSampler(Graphics::instance().device() , &samplerInfo, nullptr, &_handle) != VK_SUCCESS)
 		throw Exception("failed to create texture sampler");
@@ -31,7 +31,8 @@ namespace redox::graphics {
 
 	class Sampler : public NonCopyable {
 	public:
-		Sampler();
+		//LODs up to mipLevels are sampled, trilinear and anisotropic
+		Sampler(u32 mipLevels = 1);
 		~Sampler();
 
 		VkSampler handle() const;
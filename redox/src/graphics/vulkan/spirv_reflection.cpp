@@ -0,0 +1,367 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "spirv_reflection.h"
+
+#include <algorithm> //std::sort, std::max
+
+namespace {
+	constexpr redox::u32 MAGIC = 0x07230203;
+	constexpr std::size_t HEADER_WORDS = 5;
+
+	//Opcodes
+	constexpr redox::u32 OP_ENTRY_POINT = 15;
+	constexpr redox::u32 OP_TYPE_BOOL = 20;
+	constexpr redox::u32 OP_TYPE_INT = 21;
+	constexpr redox::u32 OP_TYPE_FLOAT = 22;
+	constexpr redox::u32 OP_TYPE_VECTOR = 23;
+	constexpr redox::u32 OP_TYPE_MATRIX = 24;
+	constexpr redox::u32 OP_TYPE_IMAGE = 25;
+	constexpr redox::u32 OP_TYPE_SAMPLER = 26;
+	constexpr redox::u32 OP_TYPE_SAMPLED_IMAGE = 27;
+	constexpr redox::u32 OP_TYPE_ARRAY = 28;
+	constexpr redox::u32 OP_TYPE_RUNTIME_ARRAY = 29;
+	constexpr redox::u32 OP_TYPE_STRUCT = 30;
+	constexpr redox::u32 OP_TYPE_POINTER = 32;
+	constexpr redox::u32 OP_CONSTANT = 43;
+	constexpr redox::u32 OP_VARIABLE = 59;
+	constexpr redox::u32 OP_DECORATE = 71;
+	constexpr redox::u32 OP_MEMBER_DECORATE = 72;
+
+	//Decorations
+	constexpr redox::u32 DECORATION_BLOCK = 2;
+	constexpr redox::u32 DECORATION_BUFFER_BLOCK = 3;
+	constexpr redox::u32 DECORATION_ARRAY_STRIDE = 6;
+	constexpr redox::u32 DECORATION_MATRIX_STRIDE = 7;
+	constexpr redox::u32 DECORATION_BUILT_IN = 11;
+	constexpr redox::u32 DECORATION_LOCATION = 30;
+	constexpr redox::u32 DECORATION_BINDING = 33;
+	constexpr redox::u32 DECORATION_DESCRIPTOR_SET = 34;
+	constexpr redox::u32 DECORATION_OFFSET = 35;
+
+	//Storage classes
+	constexpr redox::u32 STORAGE_UNIFORM_CONSTANT = 0;
+	constexpr redox::u32 STORAGE_INPUT = 1;
+	constexpr redox::u32 STORAGE_UNIFORM = 2;
+	constexpr redox::u32 STORAGE_PUSH_CONSTANT = 9;
+	constexpr redox::u32 STORAGE_STORAGE_BUFFER = 12;
+
+	//Vulkan values
+	constexpr redox::u32 DESCRIPTOR_SAMPLER = 0;
+	constexpr redox::u32 DESCRIPTOR_COMBINED_IMAGE_SAMPLER = 1;
+	constexpr redox::u32 DESCRIPTOR_SAMPLED_IMAGE = 2;
+	constexpr redox::u32 DESCRIPTOR_STORAGE_IMAGE = 3;
+	constexpr redox::u32 DESCRIPTOR_UNIFORM_TEXEL_BUFFER = 4;
+	constexpr redox::u32 DESCRIPTOR_STORAGE_TEXEL_BUFFER = 5;
+	constexpr redox::u32 DESCRIPTOR_UNIFORM_BUFFER = 6;
+	constexpr redox::u32 DESCRIPTOR_STORAGE_BUFFER = 7;
+
+	constexpr redox::u32 DIM_BUFFER = 5;
+
+	struct type_info {
+		redox::u32 opcode{ 0 };
+		redox::Buffer<redox::u32> operands; //Without the result id
+	};
+
+	struct decorations {
+		redox::u32 set{ 0 };
+		redox::u32 binding{ 0 };
+		redox::u32 location{ 0 };
+		redox::u32 arrayStride{ 0 };
+		bool hasBinding{ false };
+		bool hasLocation{ false };
+		bool builtIn{ false };
+		bool block{ false };
+		bool bufferBlock{ false };
+		redox::Hashmap<redox::u32, redox::u32> memberOffsets;
+		redox::Hashmap<redox::u32, redox::u32> memberMatrixStrides;
+	};
+
+	struct variable {
+		redox::u32 id;
+		redox::u32 pointerType;
+		redox::u32 storageClass;
+	};
+
+	class module {
+	public:
+		module(const redox::u32* words, std::size_t wordCount) {
+			if (wordCount < HEADER_WORDS || words[0] != MAGIC) {
+				throw redox::Exception("not a spir-v module");
+			}
+
+			for (auto i = HEADER_WORDS; i < wordCount;) {
+				auto count = words[i] >> 16;
+				auto opcode = words[i] & 0xFFFF;
+				if (count == 0 || i + count > wordCount) {
+					throw redox::Exception("truncated spir-v instruction");
+				}
+
+				_instruction(opcode, words + i + 1, count - 1);
+				i += count;
+			}
+		}
+
+		redox::u32 stage() const {
+			return _stage;
+		}
+
+		const redox::Buffer<variable>& variables() const {
+			return _variables;
+		}
+
+		const type_info& type(redox::u32 id) const {
+			auto it = _types.find(id);
+			if (it == _types.end()) {
+				throw redox::Exception("unknown spir-v type");
+			}
+			return it->second;
+		}
+
+		const decorations& decoration(redox::u32 id) const {
+			static const decorations none;
+			auto it = _decorations.find(id);
+			return it == _decorations.end() ? none : it->second;
+		}
+
+		redox::u32 constant(redox::u32 id) const {
+			auto it = _constants.find(id);
+			return it == _constants.end() ? 1 : it->second;
+		}
+
+		//Strips arrays, count is the number of elements
+		redox::u32 element_type(redox::u32 typeId, redox::u32& count) const {
+			count = 1;
+			for (;;) {
+				const auto& t = type(typeId);
+				if (t.opcode == OP_TYPE_ARRAY) {
+					count *= constant(t.operands[1]);
+				}
+				else if (t.opcode != OP_TYPE_RUNTIME_ARRAY) {
+					return typeId;
+				}
+				typeId = t.operands[0];
+			}
+		}
+
+		//Bytes up to the end of the last member, offsets and strides come from the decorations
+		redox::u32 size_of(redox::u32 typeId, redox::u32 matrixStride = 0) const {
+			const auto& t = type(typeId);
+			switch (t.opcode) {
+			case OP_TYPE_BOOL:
+				return 4;
+			case OP_TYPE_INT:
+			case OP_TYPE_FLOAT:
+				return t.operands[0] / 8;
+			case OP_TYPE_VECTOR:
+				return size_of(t.operands[0]) * t.operands[1];
+			case OP_TYPE_MATRIX:
+				return t.operands[1] * (matrixStride ? matrixStride : size_of(t.operands[0]));
+			case OP_TYPE_ARRAY: {
+				auto stride = decoration(typeId).arrayStride;
+				return constant(t.operands[1]) * (stride ? stride : size_of(t.operands[0]));
+			}
+			case OP_TYPE_RUNTIME_ARRAY:
+				return 0;
+			case OP_TYPE_STRUCT: {
+				const auto& dec = decoration(typeId);
+				redox::u32 size = 0;
+				for (redox::u32 m = 0; m < t.operands.size(); ++m) {
+					auto offset = dec.memberOffsets.count(m) ? dec.memberOffsets.at(m) : size;
+					auto stride = dec.memberMatrixStrides.count(m) ? dec.memberMatrixStrides.at(m) : 0;
+					size = std::max(size, offset + size_of(t.operands[m], stride));
+				}
+				return size;
+			}
+			}
+			throw redox::Exception("unsized spir-v type");
+		}
+
+	private:
+		void _instruction(redox::u32 opcode, const redox::u32* operands, redox::u32 count) {
+			switch (opcode) {
+			case OP_ENTRY_POINT:
+				_stage = _execution_stage(operands[0]);
+				break;
+			case OP_DECORATE:
+				_decorate(_decorations[operands[0]], operands[1], count > 2 ? operands[2] : 0);
+				break;
+			case OP_MEMBER_DECORATE: {
+				auto& dec = _decorations[operands[0]];
+				if (operands[2] == DECORATION_OFFSET)
+					dec.memberOffsets[operands[1]] = operands[3];
+				else if (operands[2] == DECORATION_MATRIX_STRIDE)
+					dec.memberMatrixStrides[operands[1]] = operands[3];
+				else if (operands[2] == DECORATION_BUILT_IN)
+					dec.builtIn = true;
+				break;
+			}
+			case OP_CONSTANT:
+				_constants[operands[1]] = operands[2];
+				break;
+			case OP_VARIABLE:
+				_variables.push_back({ operands[1], operands[0], operands[2] });
+				break;
+			default:
+				if (opcode >= OP_TYPE_BOOL && opcode <= OP_TYPE_POINTER) {
+					_types[operands[0]] = type_info{ opcode, redox::Buffer<redox::u32>(operands + 1, operands + count) };
+				}
+				break;
+			}
+		}
+
+		static void _decorate(decorations& dec, redox::u32 decoration, redox::u32 value) {
+			switch (decoration) {
+			case DECORATION_BLOCK: dec.block = true; break;
+			case DECORATION_BUFFER_BLOCK: dec.bufferBlock = true; break;
+			case DECORATION_ARRAY_STRIDE: dec.arrayStride = value; break;
+			case DECORATION_BUILT_IN: dec.builtIn = true; break;
+			case DECORATION_LOCATION: dec.location = value; dec.hasLocation = true; break;
+			case DECORATION_BINDING: dec.binding = value; dec.hasBinding = true; break;
+			case DECORATION_DESCRIPTOR_SET: dec.set = value; break;
+			}
+		}
+
+		static redox::u32 _execution_stage(redox::u32 model) {
+			switch (model) {
+			case 0: return 0x00000001; //Vertex
+			case 3: return 0x00000008; //Geometry
+			case 4: return 0x00000010; //Fragment
+			case 5: return 0x00000020; //GLCompute
+			}
+			throw redox::Exception("unsupported spir-v execution model");
+		}
+
+		redox::u32 _stage{ 0 };
+		redox::Buffer<variable> _variables;
+		redox::Hashmap<redox::u32, type_info> _types;
+		redox::Hashmap<redox::u32, decorations> _decorations;
+		redox::Hashmap<redox::u32, redox::u32> _constants;
+	};
+
+	redox::u32 descriptor_type(const module& m, redox::u32 storageClass, redox::u32 typeId) {
+		const auto& t = m.type(typeId);
+
+		if (storageClass == STORAGE_STORAGE_BUFFER) {
+			return DESCRIPTOR_STORAGE_BUFFER;
+		}
+
+		if (storageClass == STORAGE_UNIFORM) {
+			//Pre 1.3 modules mark storage buffers as BufferBlock in the uniform class
+			return m.decoration(typeId).bufferBlock ? DESCRIPTOR_STORAGE_BUFFER : DESCRIPTOR_UNIFORM_BUFFER;
+		}
+
+		switch (t.opcode) {
+		case OP_TYPE_SAMPLER:
+			return DESCRIPTOR_SAMPLER;
+		case OP_TYPE_SAMPLED_IMAGE:
+			return DESCRIPTOR_COMBINED_IMAGE_SAMPLER;
+		case OP_TYPE_IMAGE: {
+			//Sampled type, dim, depth, arrayed, multisampled, sampled
+			auto buffer = t.operands[1] == DIM_BUFFER;
+			auto storage = t.operands[5] == 2;
+			if (buffer)
+				return storage ? DESCRIPTOR_STORAGE_TEXEL_BUFFER : DESCRIPTOR_UNIFORM_TEXEL_BUFFER;
+			return storage ? DESCRIPTOR_STORAGE_IMAGE : DESCRIPTOR_SAMPLED_IMAGE;
+		}
+		}
+		throw redox::Exception("unsupported spir-v descriptor type");
+	}
+
+	redox::u32 vertex_format(const module& m, redox::u32 typeId) {
+		const auto& t = m.type(typeId);
+
+		redox::u32 components = 1;
+		auto scalar = &t;
+		if (t.opcode == OP_TYPE_VECTOR) {
+			components = t.operands[1];
+			scalar = &m.type(t.operands[0]);
+		}
+
+		if (components < 1 || components > 4 || scalar->operands[0] != 32) {
+			throw redox::Exception("unsupported vertex input type");
+		}
+
+		//R32_UINT = 98, R32_SINT = 99, R32_SFLOAT = 100, every further component adds 3
+		redox::u32 base = 100;
+		if (scalar->opcode == OP_TYPE_INT) {
+			base = scalar->operands[1] ? 99 : 98;
+		}
+		else if (scalar->opcode != OP_TYPE_FLOAT) {
+			throw redox::Exception("unsupported vertex input type");
+		}
+		return base + (components - 1) * 3;
+	}
+}
+
+redox::spirv::shader_info redox::spirv::reflect(const u32* words, std::size_t wordCount) {
+	module m(words, wordCount);
+
+	shader_info info;
+	info.stage = m.stage();
+
+	for (const auto& var : m.variables()) {
+		const auto& pointer = m.type(var.pointerType);
+		if (pointer.opcode != OP_TYPE_POINTER) {
+			continue;
+		}
+		auto pointee = pointer.operands[1];
+		const auto& dec = m.decoration(var.id);
+
+		switch (var.storageClass) {
+		case STORAGE_UNIFORM_CONSTANT:
+		case STORAGE_UNIFORM:
+		case STORAGE_STORAGE_BUFFER: {
+			if (!dec.hasBinding) {
+				continue;
+			}
+
+			u32 count;
+			auto element = m.element_type(pointee, count);
+			info.bindings.push_back({ dec.set, dec.binding, descriptor_type(m, var.storageClass, element), count });
+			break;
+		}
+		case STORAGE_PUSH_CONSTANT:
+			info.pushConstantSize = std::max(info.pushConstantSize, m.size_of(pointee));
+			break;
+		case STORAGE_INPUT:
+			//Built-ins (gl_VertexIndex, ...) have no location
+			if (info.stage == 0x1 && dec.hasLocation && !dec.builtIn) {
+				info.inputs.push_back({ dec.location, vertex_format(m, pointee) });
+			}
+			break;
+		}
+	}
+
+	std::sort(info.bindings.begin(), info.bindings.end(), [](const binding& lhs, const binding& rhs) {
+		return lhs.set != rhs.set ? lhs.set < rhs.set : lhs.binding < rhs.binding;
+	});
+
+	std::sort(info.inputs.begin(), info.inputs.end(), [](const vertex_input& lhs, const vertex_input& rhs) {
+		return lhs.location < rhs.location;
+	});
+
+	return info;
+}
@@ -0,0 +1,54 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+
+namespace redox::spirv {
+	//Enums are the numeric Vulkan values, so the parser stays independent of Vulkan
+
+	struct binding {
+		u32 set;
+		u32 binding;
+		u32 descriptorType; //VkDescriptorType
+		u32 count; //Array size, 1 for plain and runtime sized arrays
+	};
+
+	struct vertex_input {
+		u32 location;
+		u32 format; //VkFormat, 32 bit components
+	};
+
+	struct shader_info {
+		u32 stage{ 0 }; //VkShaderStageFlagBits
+		Buffer<binding> bindings; //Sorted by set and binding
+		Buffer<vertex_input> inputs; //Vertex stage only, sorted by location
+		u32 pushConstantSize{ 0 };
+	};
+
+	//Reflects the resource interface of a SPIR-V module with a single entry point. Only the
+	//declarations are read, resources the entry point never touches are reported as well
+	shader_info reflect(const u32* words, std::size_t wordCount);
+}
\ No newline at end of file
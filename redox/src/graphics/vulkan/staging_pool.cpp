@@ -0,0 +1,97 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "staging_pool.h"
+#include "buffer.h"
+#include "range_allocator.h"
+
+#include <algorithm> //std::find_if, std::count_if, std::max
+
+namespace {
+	constexpr VkDeviceSize PAGE_SIZE = 16ull << 20;
+	constexpr std::ptrdiff_t MAX_IDLE_PAGES = 1;
+
+	//Multiple of every texel block size and of the 4 bytes buffer to image copies require
+	constexpr VkDeviceSize REGION_ALIGNMENT = 16;
+}
+
+namespace redox::graphics {
+	struct StagingPage {
+		StagingPage(VkDeviceSize size, AllocationStrategy strategy) :
+			buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, strategy),
+			ranges(size) {
+		}
+
+		graphics::Buffer buffer;
+		LinearAllocator ranges;
+	};
+}
+
+redox::graphics::StagingPool::StagingPool() = default;
+
+redox::graphics::StagingPool::~StagingPool() = default;
+
+redox::graphics::StagingRegion redox::graphics::StagingPool::acquire(VkDeviceSize size) {
+	std::lock_guard guard(_mutex);
+
+	auto region = [size](StagingPage& page) -> std::optional<StagingRegion> {
+		auto offset = page.ranges.allocate(size, REGION_ALIGNMENT);
+		if (!offset)
+			return std::nullopt;
+
+		return StagingRegion{ &page.buffer, *offset, size,
+			static_cast<byte*>(page.buffer.mapped()) + *offset, &page };
+	};
+
+	for (auto& page : _pages) {
+		if (auto r = region(*page))
+			return *r;
+	}
+
+	//Larger uploads get a page of their own, it is dropped again once empty
+	auto strategy = size > PAGE_SIZE ? AllocationStrategy::TRANSIENT : AllocationStrategy::DEFAULT;
+	auto& page = _pages.emplace_back(make_unique<StagingPage>(std::max(size, PAGE_SIZE), strategy));
+	return region(*page).value();
+}
+
+void redox::graphics::StagingPool::release(const StagingRegion& region) {
+	std::lock_guard guard(_mutex);
+
+	auto* page = region.page;
+	page->ranges.free(region.size);
+	if (page->ranges.allocation_count() > 0)
+		return;
+
+	auto idlePages = std::count_if(_pages.begin(), _pages.end(), [](const auto& p) {
+		return p->ranges.allocation_count() == 0 && p->ranges.size() == PAGE_SIZE;
+	});
+
+	if (page->ranges.size() != PAGE_SIZE || idlePages > MAX_IDLE_PAGES) {
+		_pages.erase(std::find_if(_pages.begin(), _pages.end(), [page](const auto& p) {
+			return p.get() == page;
+		}));
+	}
+}
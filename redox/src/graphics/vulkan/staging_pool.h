@@ -0,0 +1,63 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "vulkan.h"
+
+#include "core\non_copyable.h"
+#include "core\utility.h"
+
+#include <mutex> //std::mutex
+
+namespace redox::graphics {
+	class Buffer;
+	struct StagingPage;
+
+	//Host visible range of a staging page, valid until it is released
+	struct StagingRegion {
+		const Buffer* buffer{ nullptr };
+		VkDeviceSize offset{ 0 };
+		VkDeviceSize size{ 0 };
+		void* data{ nullptr };
+		StagingPage* page{ nullptr };
+	};
+
+	//Staging memory shared by all uploads. Regions are bump allocated from recycled pages and
+	//released once their copy completed, so assets don't keep a host visible copy. Thread safe
+	class StagingPool : public NonCopyable {
+	public:
+		StagingPool();
+		~StagingPool();
+
+		//Offsets are aligned for buffer to image copies of any format
+		StagingRegion acquire(VkDeviceSize size);
+		//The copy reading the region must have completed
+		void release(const StagingRegion& region);
+
+	private:
+		std::mutex _mutex;
+		redox::Buffer<UniquePtr<StagingPage>> _pages;
+	};
+}
\ No newline at end of file
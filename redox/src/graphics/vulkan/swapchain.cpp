@@ -64,9 +64,12 @@ void redox::graphics::Swapchain::visit(FunctionRef<void(const Framebuffer&, Comm
 	}
 }
 
-void redox::graphics::Swapchain::present() {
+void redox::graphics::Swapchain::wait_frame() {
 	vkQueueWaitIdle(Graphics::instance().present_queue());
+	Graphics::instance().release_queue().collect();
+}
 
+void redox::graphics::Swapchain::present() {
 	uint32_t imageIndex;
 	vkAcquireNextImageKHR(Graphics::instance().device(), _handle,
 		std::numeric_limits<uint64_t>::max(), _imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
@@ -90,6 +93,7 @@ void redox::graphics::Swapchain::present() {
 	if (vkQueueSubmit(Graphics::instance().graphics_queue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
 		throw Exception("failed to submit queue");
 	}
+	Graphics::instance().release_queue().end_frame();
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
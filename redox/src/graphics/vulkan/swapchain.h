@@ -43,6 +43,9 @@ namespace redox::graphics {
 
 		void create_fbs(const RenderPass& renderPass);
 		void visit(FunctionRef<void(const Framebuffer&, CommandBufferView)> fn) const;
+
+		//Waits for the last submitted frame, command buffers and descriptor sets are free to change afterwards
+		void wait_frame();
 		void present();
 
 		VkSwapchainKHR handle() const;
@@ -0,0 +1,233 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "texture_streamer.h"
+#include "upload_batch.h"
+#include <core/application.h>
+
+#include <algorithm> //std::sort, std::min
+#include <cmath> //std::log2, std::floor
+#include <optional> //std::optional
+
+namespace {
+	//Levels up to this size are uploaded right away, they keep textures presentable while streaming
+	constexpr redox::u32 INITIAL_SIZE = 64;
+
+	//Frames a texture keeps its requested level after it was last drawn
+	constexpr redox::u64 RETAIN_FRAMES = 120;
+
+	//Images built at once, leaves the pool to loading work
+	constexpr std::size_t MAX_PENDING = 4;
+
+	//Bytes swapped in per frame, keeps a burst of finished builds from stalling one frame
+	constexpr VkDeviceSize UPLOAD_BYTES_PER_FRAME = 32 * 1024 * 1024;
+
+	bool is_ready(const std::future<redox::UniquePtr<redox::graphics::StagedTexture>>& future) {
+		return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+}
+
+redox::graphics::TextureStreamer::TextureStreamer(std::size_t budget) :
+	_budget(budget) {
+}
+
+redox::graphics::TextureStreamer::~TextureStreamer() {
+	//Builds reference the streamed textures, finish them before those go away. The pool isn't used
+	//here, the application shuts it down first, which already ran or dropped every build
+	for (auto& [texture, e] : _entries) {
+		if (e.pending.valid()) {
+			e.pending.wait();
+		}
+	}
+}
+
+redox::u32 redox::graphics::TextureStreamer::initial_mip(const VkExtent2D& extent, u32 mipLevels) const {
+	u32 mip = 0;
+	while (mip + 1 < mipLevels && std::max(extent.width >> mip, extent.height >> mip) > INITIAL_SIZE) {
+		++mip;
+	}
+	return mip;
+}
+
+void redox::graphics::TextureStreamer::add(const ResourceHandle<SampleTexture>& texture) {
+	std::lock_guard lock(_addedMutex);
+	_added.push_back(texture);
+}
+
+void redox::graphics::TextureStreamer::request(const SampleTexture& texture, f32 screenPixels) {
+	auto it = _entries.find(&texture);
+	if (it == _entries.end()) {
+		return;
+	}
+
+	//Level whose texels map to about one pixel each
+	auto size = static_cast<f32>(std::max(texture.dimension().width, texture.dimension().height));
+	auto ratio = size / std::max(screenPixels, 1.0f);
+	auto mip = ratio > 1.0f ? static_cast<u32>(std::floor(std::log2(ratio))) : 0u;
+
+	auto& e = it->second;
+	e.requestedMip = std::min({ e.requestedMip, mip, texture.mip_levels() - 1 });
+}
+
+void redox::graphics::TextureStreamer::update() {
+	{
+		std::lock_guard lock(_addedMutex);
+		for (auto& texture : _added) {
+			auto& e = _entries[texture.get()];
+			e.texture = texture;
+			e.requestedMip = NO_REQUEST;
+			e.retainedMip = texture->resident_mip();
+			e.lastRequest = _frame;
+		}
+		_added.clear();
+	}
+
+	//Builds keep their texture alive, so expired entries can't have one running
+	Buffer<entry*> entries;
+	for (auto it = _entries.begin(); it != _entries.end();) {
+		if (it->second.texture.expired()) {
+			it = _entries.erase(it);
+		}
+		else {
+			entries.push_back(&it->second);
+			++it;
+		}
+	}
+
+	for (auto* e : entries) {
+		auto texture = e->texture.lock();
+		if (e->requestedMip != NO_REQUEST) {
+			e->retainedMip = e->requestedMip;
+			e->lastRequest = _frame;
+			e->requestedMip = NO_REQUEST;
+		}
+
+		e->targetMip = _frame - e->lastRequest <= RETAIN_FRAMES ? e->retainedMip :
+			initial_mip(texture->dimension(), texture->mip_levels());
+	}
+
+	_apply_budget(entries);
+
+	//Textures furthest from their target first
+	std::sort(entries.begin(), entries.end(), [](const entry* lhs, const entry* rhs) {
+		auto lhsTexture = lhs->texture.lock();
+		auto rhsTexture = rhs->texture.lock();
+		return static_cast<i32>(lhsTexture->resident_mip()) - static_cast<i32>(lhs->targetMip) >
+			static_cast<i32>(rhsTexture->resident_mip()) - static_cast<i32>(rhs->targetMip);
+	});
+
+	//Swapped images are bound when the next frame is recorded, the queue orders it after the batch
+	std::optional<UploadBatch> batch;
+	VkDeviceSize uploaded = 0;
+	std::size_t pending = 0;
+	for (auto* e : entries) {
+		if (!e->pending.valid()) {
+			continue;
+		}
+
+		if (!is_ready(e->pending) || uploaded >= UPLOAD_BYTES_PER_FRAME) {
+			++pending;
+			continue;
+		}
+
+		auto texture = e->texture.lock();
+		try {
+			auto image = e->pending.get();
+			//Targets that moved on in the meantime get a new build below
+			if (e->pendingMip == e->targetMip) {
+				if (!batch) {
+					batch.emplace();
+				}
+
+				uploaded += texture->resident_size(e->pendingMip);
+				texture->set_resident(std::move(image), e->pendingMip, *batch);
+			}
+		}
+		catch (const Exception& ex) {
+			RDX_LOG("Failed to stream texture level {0}: {1}", ConsoleColor::RED, e->pendingMip, ex.what());
+		}
+	}
+
+	for (auto* e : entries) {
+		if (pending >= MAX_PENDING) {
+			break;
+		}
+
+		auto texture = e->texture.lock();
+		if (e->pending.valid() || texture->resident_mip() == e->targetMip) {
+			continue;
+		}
+
+		e->pendingMip = e->targetMip;
+		e->pending = Application::instance->thread_pool()->submit([texture, mip = e->targetMip]() {
+			return texture->create_image(mip);
+		}, TaskPriority::LOW);
+		++pending;
+	}
+
+	_residentSize = 0;
+	for (auto* e : entries) {
+		auto texture = e->texture.lock();
+		_residentSize += texture->resident_size(texture->resident_mip());
+	}
+
+	++_frame;
+}
+
+std::size_t redox::graphics::TextureStreamer::resident_size() const {
+	return _residentSize;
+}
+
+void redox::graphics::TextureStreamer::_apply_budget(Buffer<entry*>& entries) {
+	if (_budget == 0) {
+		return;
+	}
+
+	VkDeviceSize total = 0;
+	for (auto* e : entries) {
+		total += e->texture.lock()->resident_size(e->targetMip);
+	}
+
+	//Drop a level of the largest texture until everything fits, the coarsest levels always stay
+	while (total > _budget) {
+		entry* largest = nullptr;
+		VkDeviceSize largestSize = 0;
+		for (auto* e : entries) {
+			auto texture = e->texture.lock();
+			auto size = texture->resident_size(e->targetMip);
+			if (e->targetMip + 1 < texture->mip_levels() && size > largestSize) {
+				largest = e;
+				largestSize = size;
+			}
+		}
+
+		if (largest == nullptr) {
+			break;
+		}
+
+		++largest->targetMip;
+		total -= largestSize - largest->texture.lock()->resident_size(largest->targetMip);
+	}
+}
@@ -0,0 +1,84 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core\core.h"
+#include "core\non_copyable.h"
+#include "resources\texture.h"
+
+#include <future> //std::future
+#include <mutex> //std::mutex
+
+namespace redox::graphics {
+	//Keeps the resident mip levels of sampled textures under a device memory budget. Textures start
+	//out with their small levels only, finer ones are built on the thread pool once draws ask for
+	//them and swapped in between frames, textures nobody asked for in a while drop back again
+	class TextureStreamer : public NonCopyable {
+	public:
+		//budget in bytes of resident level data, 0 = unlimited
+		TextureStreamer(std::size_t budget);
+		~TextureStreamer();
+
+		//Finest level a texture is uploaded with before it is first requested
+		u32 initial_mip(const VkExtent2D& extent, u32 mipLevels) const;
+
+		//Thread safe, factories register textures while loading
+		void add(const ResourceHandle<SampleTexture>& texture);
+
+		//The texture is drawn this frame spanning roughly screenPixels, assuming its UV range
+		//covers the object once. The finest request of a frame wins
+		void request(const SampleTexture& texture, f32 screenPixels);
+
+		//Retargets the residencies, swaps in finished images and starts new builds. Main thread only,
+		//replaced images stay alive in the release queue until the frames drawing them completed
+		void update();
+
+		std::size_t resident_size() const;
+
+	private:
+		static constexpr u32 NO_REQUEST = ~0u;
+
+		struct entry {
+			WeakResourceHandle<SampleTexture> texture;
+			u32 requestedMip; //Finest level asked for this frame, NO_REQUEST if none
+			u32 retainedMip; //Level of the last frame with requests
+			u64 lastRequest{ 0 }; //Frame of the last request
+			u32 targetMip{ 0 };
+			u32 pendingMip{ 0 };
+			std::future<UniquePtr<StagedTexture>> pending;
+		};
+
+		void _apply_budget(Buffer<entry*>& entries);
+
+		std::size_t _budget;
+		std::size_t _residentSize{ 0 };
+		u64 _frame{ 0 };
+
+		Hashmap<const SampleTexture*, entry> _entries;
+
+		std::mutex _addedMutex;
+		Buffer<ResourceHandle<SampleTexture>> _added;
+	};
+}
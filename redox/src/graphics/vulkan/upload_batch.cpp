@@ -0,0 +1,223 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "upload_batch.h"
+#include "graphics.h"
+#include "command_pool.h"
+#include "buffer.h"
+#include "resources\texture.h"
+
+#include <algorithm> //std::max, std::find
+#include <limits> //std::numeric_limits
+
+redox::graphics::UploadBatch::UploadBatch() :
+	_context(Graphics::instance().upload_timeline()._acquire()) {
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(_context.commandBuffer, &beginInfo);
+}
+
+redox::graphics::UploadBatch::~UploadBatch() {
+	if (!_value) {
+		submit();
+	}
+}
+
+void redox::graphics::UploadBatch::copy(const StagingRegion& source, const Buffer& target) {
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = source.offset;
+	copyRegion.size = source.size;
+	vkCmdCopyBuffer(_context.commandBuffer, source.buffer->handle(), target.handle(), 1, &copyRegion);
+
+	_staging.push_back(source);
+	_bufferCopies = true;
+}
+
+void redox::graphics::UploadBatch::copy(const StagingRegion& source, const Texture& target,
+	const redox::Buffer<VkDeviceSize>& levelOffsets) {
+
+	const auto& ts = target.dimension();
+
+	redox::Buffer<VkBufferImageCopy> regions(levelOffsets.size());
+	for (uint32_t level = 0; level < regions.size(); ++level) {
+		auto& region = regions[level];
+		region.bufferOffset = source.offset + levelOffsets[level];
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { std::max(ts.width >> level, 1u), std::max(ts.height >> level, 1u), 1 };
+	}
+
+	vkCmdCopyBufferToImage(_context.commandBuffer, source.buffer->handle(), target.handle(),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	_staging.push_back(source);
+}
+
+redox::graphics::CommandBufferView redox::graphics::UploadBatch::command_buffer() const {
+	return _context.commandBuffer;
+}
+
+redox::u64 redox::graphics::UploadBatch::submit() {
+	if (_value) {
+		return *_value;
+	}
+
+	//One barrier makes all buffer copies visible, images are transitioned by their owners
+	if (_bufferCopies) {
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+		vkCmdPipelineBarrier(_context.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkEndCommandBuffer(_context.commandBuffer);
+
+	_value = Graphics::instance().upload_timeline()._submit(_context, std::move(_staging));
+	return *_value;
+}
+
+void redox::graphics::UploadBatch::wait() {
+	Graphics::instance().upload_timeline().wait(submit());
+}
+
+redox::graphics::UploadTimeline::~UploadTimeline() {
+	while (!_pending.empty()) {
+		_retire_front();
+	}
+
+	for (const auto& context : _idle) {
+		vkDestroyFence(Graphics::instance().device(), context.fence, nullptr);
+		vkDestroyCommandPool(Graphics::instance().device(), context.pool, nullptr);
+	}
+}
+
+redox::u64 redox::graphics::UploadTimeline::completed() {
+	std::lock_guard guard(_mutex);
+	_poll();
+	return _completed;
+}
+
+void redox::graphics::UploadTimeline::wait(u64 value) {
+	std::unique_lock lock(_mutex);
+	_poll();
+
+	while (_completed < value && !_pending.empty()) {
+		//Waited on without the lock, so other threads keep submitting and retiring meanwhile
+		auto fence = _pending.front().context.fence;
+		_waitedFences.push_back(fence);
+		lock.unlock();
+
+		vkWaitForFences(Graphics::instance().device(), 1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+		lock.lock();
+		_waitedFences.erase(std::find(_waitedFences.begin(), _waitedFences.end(), fence));
+		_poll();
+	}
+}
+
+redox::graphics::UploadTimeline::batch_context redox::graphics::UploadTimeline::_acquire() {
+	std::lock_guard guard(_mutex);
+	_poll();
+
+	//Fences are reset on reuse, skipping those a wait() is still blocked on
+	for (auto it = _idle.begin(); it != _idle.end(); ++it) {
+		if (std::find(_waitedFences.begin(), _waitedFences.end(), it->fence) != _waitedFences.end())
+			continue;
+
+		auto context = *it;
+		_idle.erase(it);
+		vkResetFences(Graphics::instance().device(), 1, &context.fence);
+		return context;
+	}
+
+	//Own pool per batch, so batches can record on several threads without locking
+	batch_context context;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = Graphics::instance().queue_family();
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	if (vkCreateCommandPool(Graphics::instance().device(), &poolInfo, nullptr, &context.pool) != VK_SUCCESS) {
+		throw Exception("failed to create upload command pool");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = context.pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	vkAllocateCommandBuffers(Graphics::instance().device(), &allocInfo, &context.commandBuffer);
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	vkCreateFence(Graphics::instance().device(), &fenceInfo, nullptr, &context.fence);
+
+	return context;
+}
+
+redox::u64 redox::graphics::UploadTimeline::_submit(const batch_context& context,
+	redox::Buffer<StagingRegion> staging) {
+
+	std::lock_guard guard(_mutex);
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &context.commandBuffer;
+	AuxCommandPool::instance().submit(submitInfo, context.fence);
+
+	_pending.push_back({ ++_submitted, context, std::move(staging) });
+	return _submitted;
+}
+
+void redox::graphics::UploadTimeline::_poll() {
+	while (!_pending.empty() &&
+		vkGetFenceStatus(Graphics::instance().device(), _pending.front().context.fence) == VK_SUCCESS) {
+		_retire_front();
+	}
+}
+
+void redox::graphics::UploadTimeline::_retire_front() {
+	auto batch = std::move(_pending.front());
+	_pending.erase(_pending.begin());
+
+	auto device = Graphics::instance().device();
+	vkWaitForFences(device, 1, &batch.context.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	for (const auto& region : batch.staging) {
+		Graphics::instance().staging_pool().release(region);
+	}
+
+	vkResetCommandPool(device, batch.context.pool, 0);
+	_idle.push_back(batch.context);
+	_completed = batch.value;
+}
@@ -0,0 +1,110 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "vulkan.h"
+#include "staging_pool.h"
+
+#include "core\non_copyable.h"
+#include "core\utility.h"
+
+#include <mutex> //std::mutex
+#include <optional> //std::optional
+
+namespace redox::graphics {
+	class Buffer;
+	class Texture;
+	class CommandBufferView;
+
+	//Completion of the submitted UploadBatches as an increasing value: n is reached once the
+	//nth batch and all batches before it completed. Emulated with one fence per batch,
+	//command pools and fences are recycled. Thread safe
+	class UploadTimeline : public NonCopyable {
+	public:
+		UploadTimeline() = default;
+		//Waits for everything that was submitted
+		~UploadTimeline();
+
+		//Polls the pending batches, completed ones give their staging memory back
+		u64 completed();
+		void wait(u64 value);
+
+	private:
+		friend class UploadBatch;
+
+		struct batch_context {
+			VkCommandPool pool;
+			VkCommandBuffer commandBuffer;
+			VkFence fence;
+		};
+
+		struct pending_batch {
+			u64 value;
+			batch_context context;
+			redox::Buffer<StagingRegion> staging;
+		};
+
+		batch_context _acquire();
+		u64 _submit(const batch_context& context, redox::Buffer<StagingRegion> staging);
+		void _poll();
+		void _retire_front();
+
+		std::mutex _mutex;
+		u64 _submitted{ 0 };
+		u64 _completed{ 0 };
+		redox::Buffer<pending_batch> _pending; //In submission order
+		redox::Buffer<batch_context> _idle; //Fences still signaled
+		redox::Buffer<VkFence> _waitedFences; //By wait() without the lock
+	};
+
+	//Records the transfers and layout transitions of many resources into one command buffer
+	//that is submitted at once. Staging regions copied from are released when it completed
+	class UploadBatch : public NonCopyable {
+	public:
+		UploadBatch();
+		//Submits what wasn't submitted yet, without waiting
+		~UploadBatch();
+
+		void copy(const StagingRegion& source, const Buffer& target);
+		//Levels are tightly packed at the region offset + levelOffsets, the image must be in
+		//VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+		void copy(const StagingRegion& source, const Texture& target, const redox::Buffer<VkDeviceSize>& levelOffsets);
+
+		//For barriers and layout transitions
+		CommandBufferView command_buffer() const;
+
+		//Returns the UploadTimeline value reached once everything recorded completed,
+		//nothing can be recorded afterwards
+		u64 submit();
+		//Submits if necessary and blocks until the batch completed
+		void wait();
+
+	private:
+		UploadTimeline::batch_context _context;
+		redox::Buffer<StagingRegion> _staging;
+		bool _bufferCopies{ false };
+		std::optional<u64> _value;
+	};
+}
\ No newline at end of file
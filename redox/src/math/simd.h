@@ -61,6 +61,20 @@ namespace redox::simd {
 		return _mm_div_ps(lhs, rhs);
 	}
 
+	RDX_INLINE f32x4 min(f32x4 lhs, f32x4 rhs) {
+		return _mm_min_ps(lhs, rhs);
+	}
+	RDX_INLINE f32x4 max(f32x4 lhs, f32x4 rhs) {
+		return _mm_max_ps(lhs, rhs);
+	}
+	RDX_INLINE f32x4 less(f32x4 lhs, f32x4 rhs) {
+		return _mm_cmplt_ps(lhs, rhs);
+	}
+	RDX_INLINE f32x4 select(f32x4 lhs, f32x4 rhs, f32x4 mask) {
+		//r[i] := mask[i] ? rhs[i] : lhs[i]
+		return _mm_blendv_ps(lhs, rhs, mask);
+	}
+
 	template<i32 mask>
 	RDX_INLINE f32x4 dot(f32x4 lhs, f32x4 rhs) {
 		return _mm_dp_ps(lhs, rhs, mask);
@@ -78,6 +92,17 @@ namespace redox::simd {
 	RDX_INLINE f32x4 set(f32 x, f32 y = 0.0f, f32 z = 0.0f, f32 w = 0.0f) {
 		return _mm_set_ps(w, z, y, x);
 	}
+	RDX_INLINE f32x4 load_unaligned(const f32* ptr) {
+		return _mm_loadu_ps(ptr);
+	}
+	RDX_INLINE f32x4 load_lower2(const f32* ptr) {
+		//upper two lanes are zeroed
+		return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const f64*>(ptr)));
+	}
+	RDX_INLINE void store_unaligned(f32* ptr, f32x4 xmm) {
+		_mm_storeu_ps(ptr, xmm);
+	}
+
 	RDX_INLINE f32x4 set_lower(f32 w) {
 		return _mm_set_ss(w); //really just no-op/cast
 	}
@@ -0,0 +1,100 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <platform/filesystem.h>
+
+#include <chrono> //std::chrono::steady_clock
+#include <optional> //std::optional
+
+namespace redox::io::detail {
+	//Platform independent part of DirectoryWatcher: merges raw notifications per file
+	//and releases them once no further event arrived within the debounce window
+	class change_coalescer {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		change_coalescer(clock::duration window) : _window(window) {}
+
+		void add(const Path& file, ChangeEvents events, clock::time_point now) {
+			auto& change = _pending[file];
+			change.events |= events;
+			change.last = now;
+		}
+
+		//Events are resolved against the current state of the file: anything that still
+		//exists was not removed, anything that is gone only reports the removal and
+		//files that were created and deleted within the window are dropped entirely
+		Buffer<FileChange> flush(const Path& directory, ChangeEvents subscribed, clock::time_point now) {
+			Buffer<FileChange> changes;
+			for (auto it = _pending.begin(); it != _pending.end();) {
+				if (now - it->second.last < _window) {
+					++it;
+					continue;
+				}
+
+				auto events = it->second.events;
+				if (io::is_regular_file(directory / it->first)) {
+					events = events & (ChangeEvents::FILE_ADDED | ChangeEvents::FILE_MODIFIED | ChangeEvents::FILE_RENAME);
+				}
+				else if (util::check_flag(events, ChangeEvents::FILE_ADDED)) {
+					events = ChangeEvents::NONE;
+				}
+				else events = events & (ChangeEvents::FILE_REMOVED | ChangeEvents::FILE_RENAME);
+
+				events = events & subscribed;
+				if (events != ChangeEvents::NONE) {
+					changes.push_back({ it->first, events });
+				}
+
+				it = _pending.erase(it);
+			}
+			return changes;
+		}
+
+		std::optional<clock::time_point> next_deadline() const {
+			std::optional<clock::time_point> deadline;
+			for (const auto& [file, change] : _pending) {
+				if (!deadline || change.last + _window < *deadline) {
+					deadline = change.last + _window;
+				}
+			}
+			return deadline;
+		}
+
+		bool empty() const {
+			return _pending.empty();
+		}
+
+	private:
+		struct pending_change {
+			ChangeEvents events{ ChangeEvents::NONE };
+			clock::time_point last;
+		};
+
+		clock::duration _window;
+		Hashmap<Path, pending_change> _pending;
+	};
+}
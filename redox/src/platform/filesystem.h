@@ -28,7 +28,72 @@ SOFTWARE.
 #include <core\non_copyable.h>
 #include <core\utility.h>
 
+#include <algorithm> //std::min
+#include <chrono> //std::chrono::milliseconds
+
 namespace redox::io {
+	//Read-only view over file contents, keeps whatever backs the memory alive
+	class FileView {
+	public:
+		FileView() = default;
+
+		FileView(Buffer<byte> buffer) {
+			auto owned = make_shared<Buffer<byte>>(std::move(buffer));
+			_data = owned->data();
+			_size = owned->size();
+			_owner = std::move(owned);
+		}
+
+		FileView(SharedPtr<const void> owner, const byte* data, std::size_t size) :
+			_owner(std::move(owner)), _data(data), _size(size) {
+		}
+
+		const byte* data() const {
+			return _data;
+		}
+
+		std::size_t size() const {
+			return _size;
+		}
+
+		bool empty() const {
+			return _size == 0;
+		}
+
+		const byte* begin() const {
+			return _data;
+		}
+
+		const byte* end() const {
+			return _data + _size;
+		}
+
+		//Shares ownership with this view, the range is clamped to the view
+		FileView subview(std::size_t offset, std::size_t size) const {
+			offset = std::min(offset, _size);
+			return FileView(_owner, _data + offset, std::min(size, _size - offset));
+		}
+
+	private:
+		SharedPtr<const void> _owner;
+		const byte* _data{ nullptr };
+		std::size_t _size{ 0 };
+	};
+
+	class MappedFile : public NonCopyable {
+	public:
+		MappedFile(const Path& file);
+		~MappedFile();
+
+		bool is_valid() const;
+		const byte* data() const;
+		std::size_t size() const;
+
+	private:
+		struct internal;
+		UniquePtr<internal> _internal;
+	};
+
 	class File : public NonCopyable {
 	public:
 		enum class Mode {
@@ -44,6 +109,9 @@ namespace redox::io {
 		bool is_valid() const;
 		std::size_t size() const;
 		Buffer<i8> read();
+		//Maps the file instead of copying it, the view stays valid after the file is closed
+		FileView read_view();
+		void write(const void* data, std::size_t size);
 
 	private:
 		struct internal;
@@ -51,6 +119,7 @@ namespace redox::io {
 	};
 
 	enum class ChangeEvents {
+		NONE = 0,
 		FILE_ADDED = 0x1 << 0,
 		FILE_REMOVED = 0x1 << 1,
 		FILE_MODIFIED = 0x1 << 2,
@@ -58,15 +127,23 @@ namespace redox::io {
 		UNKNOWN = 0x1 << 4
 	};
 
+	struct FileChange {
+		Path file; //Relative to the watched directory
+		ChangeEvents events;
+	};
+
+	//Watches a directory tree, bursts of events per file are merged until
+	//the file has been quiet for the debounce interval and then reported in one batch
 	class DirectoryWatcher : public NonCopyable {
 	public:
-		using CallbackType = Function<void(const Path& file, ChangeEvents events)>;
+		using CallbackType = Function<void(const Buffer<FileChange>& changes)>;
 
 		DirectoryWatcher();
 		~DirectoryWatcher();
 
 		void subscribe(CallbackType callback);
-		void start(const Path& directory, ChangeEvents events);
+		void start(const Path& directory, ChangeEvents events,
+			std::chrono::milliseconds debounce = std::chrono::milliseconds(100));
 		void stop();
 
 	private:
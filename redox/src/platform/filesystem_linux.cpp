@@ -0,0 +1,273 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "core\core.h"
+
+#if defined RDX_PLATFORM_LINUX || (defined RDX_PLATFORM_UNIX && defined __linux__)
+#include "filesystem.h"
+#include "change_coalescer.h"
+#include "core\logging\log.h"
+
+#include <sys/inotify.h> //inotify_init1, inotify_add_watch
+#include <sys/epoll.h> //epoll_create1, epoll_wait
+#include <sys/eventfd.h> //eventfd
+#include <unistd.h> //read, write, close
+#include <cerrno> //errno
+
+#include <thread> //std::thread
+#include <algorithm> //std::max
+
+namespace {
+	constexpr redox::u32 WATCH_MASK = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+		IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+}
+
+struct redox::io::DirectoryWatcher::internal {
+	bool running{ false };
+	Path directory;
+	ChangeEvents events;
+	CallbackType callback;
+
+	int inotifyFd{ -1 };
+	int epollFd{ -1 };
+	int stopFd{ -1 };
+	std::thread thread;
+
+	//Watch descriptor -> directory relative to the root
+	Hashmap<int, Path> watches;
+	std::optional<detail::change_coalescer> coalescer;
+
+	void add_watch(const Path& relativeDir, bool reportFiles);
+	void remove_watches(const Path& relativeDir);
+	void handle_event(const inotify_event& event);
+	void run();
+	void close_handles();
+};
+
+redox::io::DirectoryWatcher::DirectoryWatcher() :
+	_internal(std::make_unique<internal>()) {
+}
+
+redox::io::DirectoryWatcher::~DirectoryWatcher() {
+	stop();
+}
+
+void redox::io::DirectoryWatcher::subscribe(CallbackType callback) {
+	_internal->callback = std::move(callback);
+}
+
+void redox::io::DirectoryWatcher::start(const Path& directory, ChangeEvents events,
+	std::chrono::milliseconds debounce) {
+	stop();
+
+	_internal->directory = directory;
+	_internal->events = events;
+	_internal->coalescer.emplace(debounce);
+	_internal->watches.clear();
+
+	_internal->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	_internal->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	_internal->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (_internal->inotifyFd == -1 || _internal->epollFd == -1 || _internal->stopFd == -1) {
+		_internal->close_handles();
+		throw Exception("failed to initialize inotify.");
+	}
+
+	for (auto fd : { _internal->inotifyFd, _internal->stopFd }) {
+		epoll_event ev{};
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		if (epoll_ctl(_internal->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			_internal->close_handles();
+			throw Exception("epoll_ctl() failed.");
+		}
+	}
+
+	_internal->add_watch({}, false);
+	if (_internal->watches.empty()) {
+		_internal->close_handles();
+		throw Exception("inotify_add_watch() failed.");
+	}
+
+	_internal->running = true;
+	_internal->thread = std::thread([internal = _internal.get()]() {
+		internal->run();
+	});
+}
+
+void redox::io::DirectoryWatcher::stop() {
+	if (_internal->running) {
+		u64 value{ 1 };
+		[[maybe_unused]] auto written = write(_internal->stopFd, &value, sizeof(value));
+
+		_internal->thread.join();
+		_internal->close_handles();
+		_internal->running = false;
+	}
+}
+
+void redox::io::DirectoryWatcher::internal::add_watch(const Path& relativeDir, bool reportFiles) {
+	auto absolute = directory / relativeDir;
+	int wd = inotify_add_watch(inotifyFd, absolute.c_str(), WATCH_MASK);
+	if (wd == -1) {
+		RDX_LOG("Failed to watch {0}", ConsoleColor::RED, absolute);
+		return;
+	}
+
+	watches[wd] = relativeDir;
+
+	//Files may have been created before the watch was in place
+	std::error_code ec;
+	for (const auto& entry : io::directory_iterator(absolute, ec)) {
+		auto child = relativeDir / entry.path().filename();
+		if (entry.is_directory(ec)) {
+			add_watch(child, reportFiles);
+		}
+		else if (reportFiles && entry.is_regular_file(ec)) {
+			coalescer->add(child, ChangeEvents::FILE_ADDED | ChangeEvents::FILE_MODIFIED,
+				detail::change_coalescer::clock::now());
+		}
+	}
+}
+
+void redox::io::DirectoryWatcher::internal::remove_watches(const Path& relativeDir) {
+	for (auto it = watches.begin(); it != watches.end();) {
+		auto relative = it->second.lexically_relative(relativeDir);
+		if (!relative.empty() && *relative.begin() != "..") {
+			inotify_rm_watch(inotifyFd, it->first);
+			it = watches.erase(it);
+		} else ++it;
+	}
+}
+
+void redox::io::DirectoryWatcher::internal::handle_event(const inotify_event& event) {
+	if (event.mask & IN_Q_OVERFLOW) {
+		RDX_LOG("Directory watcher queue overflowed, changes were lost", ConsoleColor::RED);
+		return;
+	}
+
+	auto wit = watches.find(event.wd);
+	if (wit == watches.end()) {
+		return;
+	}
+
+	if (event.mask & IN_IGNORED) {
+		watches.erase(wit);
+		return;
+	}
+
+	if (event.len == 0) {
+		return;
+	}
+
+	auto relative = wit->second / event.name;
+
+	if (event.mask & IN_ISDIR) {
+		if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+			add_watch(relative, true);
+		}
+		else if (event.mask & IN_MOVED_FROM) {
+			remove_watches(relative);
+		}
+		return;
+	}
+
+	ChangeEvents change{ ChangeEvents::NONE };
+	if (event.mask & IN_CREATE)
+		change |= ChangeEvents::FILE_ADDED;
+
+	if (event.mask & (IN_MODIFY | IN_CLOSE_WRITE))
+		change |= ChangeEvents::FILE_MODIFIED;
+
+	if (event.mask & IN_DELETE)
+		change |= ChangeEvents::FILE_REMOVED;
+
+	if (event.mask & IN_MOVED_FROM)
+		change |= ChangeEvents::FILE_REMOVED | ChangeEvents::FILE_RENAME;
+
+	//Editors commonly save by renaming a temporary over the original
+	if (event.mask & IN_MOVED_TO)
+		change |= ChangeEvents::FILE_ADDED | ChangeEvents::FILE_MODIFIED | ChangeEvents::FILE_RENAME;
+
+	if (change != ChangeEvents::NONE) {
+		coalescer->add(relative, change, detail::change_coalescer::clock::now());
+	}
+}
+
+void redox::io::DirectoryWatcher::internal::run() {
+	using clock = detail::change_coalescer::clock;
+
+	Array<epoll_event, 2> ready;
+	alignas(inotify_event) Array<char, 64 * 1024> buffer;
+
+	for (;;) {
+		int timeout{ -1 };
+		if (auto deadline = coalescer->next_deadline(); deadline) {
+			auto ms = std::chrono::ceil<std::chrono::milliseconds>(*deadline - clock::now()).count();
+			timeout = static_cast<int>(std::max<decltype(ms)>(ms, 0));
+		}
+
+		int count = epoll_wait(epollFd, ready.data(), static_cast<int>(ready.size()), timeout);
+		if (count == -1 && errno != EINTR) {
+			RDX_LOG("epoll_wait() failed, directory watcher stopped", ConsoleColor::RED);
+			return;
+		}
+
+		for (int i = 0; i < count; ++i) {
+			if (ready[i].data.fd == stopFd) {
+				return;
+			}
+
+			for (;;) {
+				auto length = read(inotifyFd, buffer.data(), buffer.size());
+				if (length <= 0) {
+					break;
+				}
+
+				for (auto ptr = buffer.data(); ptr < buffer.data() + length;) {
+					const auto& event = *reinterpret_cast<const inotify_event*>(ptr);
+					handle_event(event);
+					ptr += sizeof(inotify_event) + event.len;
+				}
+			}
+		}
+
+		auto changes = coalescer->flush(directory, events, clock::now());
+		if (!changes.empty() && callback) {
+			callback(changes);
+		}
+	}
+}
+
+void redox::io::DirectoryWatcher::internal::close_handles() {
+	for (auto fd : { inotifyFd, epollFd, stopFd }) {
+		if (fd != -1)
+			close(fd);
+	}
+	inotifyFd = epollFd = stopFd = -1;
+	watches.clear();
+}
+#endif
@@ -0,0 +1,182 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "core\core.h"
+
+#if defined RDX_PLATFORM_UNIX || defined RDX_PLATFORM_LINUX || defined RDX_PLATFORM_OSX
+#include "filesystem.h"
+
+#include <fcntl.h> //open
+#include <unistd.h> //pread, write, close
+#include <sys/mman.h> //mmap, madvise
+#include <sys/stat.h> //fstat
+#include <cerrno> //errno
+#include <initializer_list> //std::initializer_list
+
+namespace {
+	//Maps the whole file, the returned pointer owns the mapping
+	redox::SharedPtr<const void> map_file(int fd, std::size_t size, std::initializer_list<int> advice) {
+		auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+			throw redox::Exception("mmap() failed.");
+
+		//Hints only, failures are harmless
+		for (auto adv : advice)
+			madvise(data, size, adv);
+
+		return redox::SharedPtr<const void>(data, [size](const void* ptr) {
+			munmap(const_cast<void*>(ptr), size);
+		});
+	}
+}
+
+struct redox::io::File::internal {
+	int fd;
+};
+
+redox::io::File::File(const redox::Path& file, const Mode mode) :
+	_internal(std::make_unique<internal>()) {
+
+	int flags{ 0 };
+	if (util::check_flag(mode, Mode::READ) && util::check_flag(mode, Mode::WRITE))
+		flags = O_RDWR;
+	else if (util::check_flag(mode, Mode::WRITE))
+		flags = O_WRONLY;
+	else flags = O_RDONLY;
+
+	if (util::check_flag(mode, Mode::ALWAYS_CREATE))
+		flags |= O_CREAT | O_TRUNC;
+
+	_internal->fd = open(file.c_str(), flags | O_CLOEXEC, 0644);
+
+	if (util::check_flag(mode, Mode::THROW_IF_INVALID) && !is_valid())
+		throw Exception("failed to open file");
+}
+
+redox::io::File::~File() {
+	if (is_valid())
+		close(_internal->fd);
+}
+
+bool redox::io::File::is_valid() const {
+	return (_internal->fd != -1);
+}
+
+std::size_t redox::io::File::size() const {
+	struct stat st;
+	if (fstat(_internal->fd, &st) != 0)
+		return 0;
+
+	return static_cast<std::size_t>(st.st_size);
+}
+
+redox::Buffer<redox::i8> redox::io::File::read() {
+	Buffer<i8> out(size());
+
+	//pread does not touch the file offset and may return short reads
+	std::size_t total{ 0 };
+	while (total < out.size()) {
+		auto bytesRead = pread(_internal->fd, out.data() + total, out.size() - total, static_cast<off_t>(total));
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+
+		if (bytesRead <= 0)
+			throw Exception("failed to read file");
+
+		total += static_cast<std::size_t>(bytesRead);
+	}
+
+	return out;
+}
+
+redox::io::FileView redox::io::File::read_view() {
+	auto fileSize = size();
+	if (fileSize == 0)
+		return {};
+
+	auto mapping = map_file(_internal->fd, fileSize, { MADV_SEQUENTIAL, MADV_WILLNEED });
+	auto data = static_cast<const byte*>(mapping.get());
+	return FileView(std::move(mapping), data, fileSize);
+}
+
+void redox::io::File::write(const void* data, std::size_t size) {
+	auto src = static_cast<const byte*>(data);
+	while (size > 0) {
+		auto bytesWritten = ::write(_internal->fd, src, size);
+		if (bytesWritten < 0 && errno == EINTR)
+			continue;
+
+		if (bytesWritten <= 0)
+			throw Exception("failed to write file");
+
+		src += bytesWritten;
+		size -= static_cast<std::size_t>(bytesWritten);
+	}
+}
+
+// MappedFile
+
+struct redox::io::MappedFile::internal {
+	SharedPtr<const void> mapping;
+	std::size_t size{ 0 };
+};
+
+redox::io::MappedFile::MappedFile(const Path& file) :
+	_internal(std::make_unique<internal>()) {
+
+	int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		throw Exception("failed to open file");
+
+	//The mapping outlives the descriptor
+	RDX_SCOPE_GUARD([fd]() {
+		close(fd);
+	});
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		throw Exception("failed to query file size");
+
+	_internal->size = static_cast<std::size_t>(st.st_size);
+
+	//Zero sized files cannot be mapped
+	if (_internal->size > 0)
+		_internal->mapping = map_file(fd, _internal->size, { MADV_RANDOM });
+}
+
+redox::io::MappedFile::~MappedFile() = default;
+
+bool redox::io::MappedFile::is_valid() const {
+	return _internal->size == 0 || _internal->mapping != nullptr;
+}
+
+const redox::byte* redox::io::MappedFile::data() const {
+	return static_cast<const byte*>(_internal->mapping.get());
+}
+
+std::size_t redox::io::MappedFile::size() const {
+	return _internal->size;
+}
+#endif
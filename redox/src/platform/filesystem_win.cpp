@@ -27,8 +27,12 @@ SOFTWARE.
 
 #ifdef RDX_PLATFORM_WINDOWS
 #include "filesystem.h"
+#include "change_coalescer.h"
+#include "core\logging\log.h"
 #include "platform\windows.h"
 
+#include <mutex> //std::mutex, std::lock_guard
+
 struct redox::io::File::internal {
 	HANDLE handle;
 };
@@ -78,6 +82,99 @@ redox::Buffer<redox::i8> redox::io::File::read() {
 	return out;
 }
 
+redox::io::FileView redox::io::File::read_view() {
+	auto fileSize = size();
+	if (fileSize == 0)
+		return {};
+
+	HANDLE mapping = CreateFileMappingW(_internal->handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+		throw Exception("CreateFileMappingW() failed.");
+
+	//The view keeps the mapping object alive on its own
+	auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+
+	if (data == nullptr)
+		throw Exception("MapViewOfFile() failed.");
+
+	SharedPtr<const void> owner(data, [](const void* ptr) {
+		UnmapViewOfFile(ptr);
+	});
+
+	return FileView(std::move(owner), static_cast<const byte*>(data), fileSize);
+}
+
+void redox::io::File::write(const void* data, std::size_t size) {
+	DWORD dwBytesWritten;
+	if (!WriteFile(_internal->handle,
+		data, static_cast<DWORD>(size), &dwBytesWritten, NULL) || dwBytesWritten != size)
+		throw Exception("failed to write file");
+}
+
+// MappedFile
+
+struct redox::io::MappedFile::internal {
+	HANDLE file{ INVALID_HANDLE_VALUE };
+	HANDLE mapping{ NULL };
+	const byte* data{ nullptr };
+	std::size_t size{ 0 };
+
+	//Also runs when the constructor throws halfway through
+	~internal() {
+		if (data != nullptr)
+			UnmapViewOfFile(data);
+
+		if (mapping != NULL)
+			CloseHandle(mapping);
+
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+};
+
+redox::io::MappedFile::MappedFile(const Path& file) :
+	_internal(std::make_unique<internal>()) {
+
+	_internal->file = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+
+	if (_internal->file == INVALID_HANDLE_VALUE)
+		throw Exception("failed to open file");
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_internal->file, &size))
+		throw Exception("failed to query file size");
+
+	_internal->size = static_cast<std::size_t>(size.QuadPart);
+
+	//Zero sized files cannot be mapped
+	if (_internal->size == 0)
+		return;
+
+	_internal->mapping = CreateFileMappingW(_internal->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (_internal->mapping == NULL)
+		throw Exception("CreateFileMappingW() failed.");
+
+	_internal->data = static_cast<const byte*>(MapViewOfFile(_internal->mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_internal->data == nullptr)
+		throw Exception("MapViewOfFile() failed.");
+}
+
+redox::io::MappedFile::~MappedFile() = default;
+
+bool redox::io::MappedFile::is_valid() const {
+	return _internal->file != INVALID_HANDLE_VALUE;
+}
+
+const redox::byte* redox::io::MappedFile::data() const {
+	return _internal->data;
+}
+
+std::size_t redox::io::MappedFile::size() const {
+	return _internal->size;
+}
+
 // DirectoryWatcher
 
 struct redox::io::DirectoryWatcher::internal {
@@ -90,7 +187,12 @@ struct redox::io::DirectoryWatcher::internal {
 	OVERLAPPED overlapped;
 	Buffer<i8> buffer;
 
+	//Wait callbacks may overlap when a notification races the debounce timeout
+	std::mutex mutex;
+	std::optional<detail::change_coalescer> coalescer;
+
 	void read_changes();
+	void collect_changes();
 	static VOID CALLBACK WaitCallback(
 		_In_ PVOID   lpParameter,
 		_In_ BOOLEAN TimerOrWaitFired);
@@ -108,15 +210,17 @@ void redox::io::DirectoryWatcher::subscribe(CallbackType callback) {
 	_internal->callback = std::move(callback);
 }
 
-void redox::io::DirectoryWatcher::start(const Path& directory, ChangeEvents events) {
+void redox::io::DirectoryWatcher::start(const Path& directory, ChangeEvents events,
+	std::chrono::milliseconds debounce) {
 	stop();
 
 	_internal->directory = directory;
 	_internal->events = events;
+	_internal->coalescer.emplace(debounce);
 	_internal->directoryHandle = CreateFileW(
 		directory.c_str(),
 		FILE_LIST_DIRECTORY,
-		FILE_SHARE_WRITE | FILE_SHARE_READ,
+		FILE_SHARE_WRITE | FILE_SHARE_READ | FILE_SHARE_DELETE,
 		NULL,
 		OPEN_EXISTING,
 		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
@@ -126,15 +230,17 @@ void redox::io::DirectoryWatcher::start(const Path& directory, ChangeEvents even
 		throw Exception("CreateFileW() failed.");
 	}
 
-	constexpr auto bfSize = 10 * (sizeof(FILE_NOTIFY_INFORMATION));
+	//FILE_NOTIFY_INFORMATION entries are DWORD aligned and carry the file name inline
+	_internal->overlapped = {};
 	_internal->overlapped.hEvent = CreateEvent(0, 0, 0, 0);
-	_internal->buffer.reserve(static_cast<size_t>(bfSize));
+	_internal->buffer.resize(64 * 1024);
 
+	//The timeout doubles as the debounce tick that flushes quiet files
 	if (!RegisterWaitForSingleObject(
 		&_internal->waitHandle,
 		_internal->overlapped.hEvent,
 		internal::WaitCallback,
-		this, INFINITE, WT_EXECUTEDEFAULT)) {
+		this, static_cast<ULONG>(debounce.count()), WT_EXECUTEDEFAULT)) {
 
 		throw Exception("RegisterWaitForSingleObject() failed.");
 	}
@@ -145,7 +251,9 @@ void redox::io::DirectoryWatcher::start(const Path& directory, ChangeEvents even
 
 void redox::io::DirectoryWatcher::stop() {
 	if (_internal->running) {
-		UnregisterWaitEx(_internal->waitHandle, NULL);
+		//Blocks until running callbacks have returned
+		UnregisterWaitEx(_internal->waitHandle, INVALID_HANDLE_VALUE);
+		CancelIo(_internal->directoryHandle);
 		CloseHandle(_internal->overlapped.hEvent);
 		CloseHandle(_internal->directoryHandle);
 		_internal->running = false;
@@ -153,64 +261,86 @@ void redox::io::DirectoryWatcher::stop() {
 }
 
 void redox::io::DirectoryWatcher::internal::read_changes() {
-	buffer.clear();
-
-	auto filter = FILE_NOTIFY_CHANGE_FILE_NAME;
+	//Attribute, access time and security changes never alter file contents
+	DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME;
 	if (util::check_flag(events, ChangeEvents::FILE_MODIFIED)) {
-		filter |= FILE_NOTIFY_CHANGE_ATTRIBUTES | FILE_NOTIFY_CHANGE_SIZE |
-			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_LAST_ACCESS |
-			FILE_NOTIFY_CHANGE_CREATION | FILE_NOTIFY_CHANGE_SECURITY;
+		filter |= FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE;
 	}
 
-	[[maybe_unused]] DWORD bytes;
 	if (!ReadDirectoryChangesW(
-		directoryHandle, buffer.data(), static_cast<DWORD>(buffer.capacity()),
-		TRUE, filter, &bytes, &overlapped, NULL)) {
+		directoryHandle, buffer.data(), static_cast<DWORD>(buffer.size()),
+		TRUE, filter, NULL, &overlapped, NULL)) {
 
 		throw Exception("ReadDirectoryChangesW() failed.");
 	}
 }
 
-VOID CALLBACK redox::io::DirectoryWatcher::internal::WaitCallback(
-	_In_ PVOID lpParameter, _In_ BOOLEAN TimerOrWaitFired) {
-
-	auto instance = static_cast<DirectoryWatcher*>(lpParameter);
-	auto& internal = *instance->_internal;
-	auto fni = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(internal.buffer.data());
+void redox::io::DirectoryWatcher::internal::collect_changes() {
+	DWORD bytes{ 0 };
+	if (!GetOverlappedResult(directoryHandle, &overlapped, &bytes, FALSE)) {
+		return;
+	}
 
-	if (internal.callback) {
+	if (bytes == 0) {
+		RDX_LOG("Directory watcher buffer overflowed, changes were lost", ConsoleColor::RED);
+		return;
+	}
 
-		ChangeEvents event{ ChangeEvents::UNKNOWN };
-		if (util::check_flag(fni->Action, FILE_ACTION_ADDED)
-			&& util::check_flag(internal.events, ChangeEvents::FILE_ADDED)) {
-			event |= ChangeEvents::FILE_ADDED;
+	auto now = detail::change_coalescer::clock::now();
+	for (auto ptr = buffer.data();;) {
+		auto fni = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(ptr);
+
+		ChangeEvents change{ ChangeEvents::NONE };
+		switch (fni->Action) {
+		case FILE_ACTION_ADDED:
+			change = ChangeEvents::FILE_ADDED;
+			break;
+		case FILE_ACTION_MODIFIED:
+			change = ChangeEvents::FILE_MODIFIED;
+			break;
+		case FILE_ACTION_REMOVED:
+			change = ChangeEvents::FILE_REMOVED;
+			break;
+		case FILE_ACTION_RENAMED_OLD_NAME:
+			change = ChangeEvents::FILE_REMOVED | ChangeEvents::FILE_RENAME;
+			break;
+		case FILE_ACTION_RENAMED_NEW_NAME:
+			//Editors commonly save by renaming a temporary over the original
+			change = ChangeEvents::FILE_ADDED | ChangeEvents::FILE_MODIFIED | ChangeEvents::FILE_RENAME;
+			break;
 		}
 
-		if (util::check_flag(fni->Action, FILE_ACTION_MODIFIED)
-			&& util::check_flag(internal.events, ChangeEvents::FILE_MODIFIED)) {
-			event |= ChangeEvents::FILE_MODIFIED;
+		if (change != ChangeEvents::NONE) {
+			WString wstr{ fni->FileName, fni->FileNameLength / sizeof(WCHAR) };
+			coalescer->add(Path(wstr), change, now);
 		}
 
-		if (util::check_flag(fni->Action, FILE_ACTION_REMOVED)
-			&& util::check_flag(internal.events, ChangeEvents::FILE_REMOVED)) {
-			event |= ChangeEvents::FILE_REMOVED;
+		if (fni->NextEntryOffset == 0) {
+			break;
 		}
+		ptr += fni->NextEntryOffset;
+	}
+}
 
-		if (util::check_flag(fni->Action, FILE_ACTION_RENAMED_OLD_NAME)
-			&& util::check_flag(internal.events, ChangeEvents::FILE_RENAME)) {
-			event |= ChangeEvents::FILE_REMOVED;
-		}
+VOID CALLBACK redox::io::DirectoryWatcher::internal::WaitCallback(
+	_In_ PVOID lpParameter, _In_ BOOLEAN TimerOrWaitFired) {
 
-		if (event != ChangeEvents::UNKNOWN) {
-			WString wstr{ fni->FileName, fni->FileNameLength / sizeof(WCHAR) };
-			Path path(wstr);
-			if (io::is_regular_file(internal.directory / path)) {
-				internal.callback(path, event);
-			}
-		}
+	auto instance = static_cast<DirectoryWatcher*>(lpParameter);
+	auto& internal = *instance->_internal;
+
+	//Also keeps batches from being delivered concurrently
+	std::lock_guard guard(internal.mutex);
+	if (!TimerOrWaitFired) {
+		internal.collect_changes();
+		internal.read_changes();
 	}
 
-	internal.read_changes();
+	auto changes = internal.coalescer->flush(internal.directory, internal.events,
+		detail::change_coalescer::clock::now());
+
+	if (!changes.empty() && internal.callback) {
+		internal.callback(changes);
+	}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,356 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "archive.h"
+#include <core/compression/lz4.h>
+#include <core/logging/log.h>
+
+#include <algorithm> //std::lower_bound, std::sort, std::min
+#include <atomic> //std::atomic
+#include <cctype> //std::tolower
+#include <cstring> //std::memcpy
+
+namespace {
+	template<class T>
+	T align_up(T value, T alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	struct block_job {
+		const redox::byte* src;
+		redox::byte* dst;
+		redox::Buffer<std::size_t> srcOffsets;
+		redox::Buffer<redox::u32> srcSizes;
+		std::size_t blockSize;
+		std::size_t size;
+
+		std::atomic<std::size_t> next{ 0 };
+		std::atomic<std::size_t> done{ 0 };
+		std::atomic<bool> failed{ false };
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		std::size_t block_count() const {
+			return srcSizes.size();
+		}
+
+		//Claims blocks until none are left, helpers that start late simply return
+		void run() {
+			for (;;) {
+				auto index = next++;
+				if (index >= block_count()) {
+					return;
+				}
+
+				auto dstOffset = index * blockSize;
+				auto expected = std::min(blockSize, size - dstOffset);
+
+				try {
+					auto written = redox::lz4::decompress(src + srcOffsets[index],
+						srcSizes[index], dst + dstOffset, expected);
+
+					if (written != expected) {
+						failed = true;
+					}
+				}
+				catch (const redox::Exception&) {
+					failed = true;
+				}
+
+				if (++done == block_count()) {
+					std::lock_guard guard(mutex);
+					condition.notify_all();
+				}
+			}
+		}
+	};
+}
+
+redox::String redox::rpak::normalize_path(const Path& path) {
+	auto normalized = path.lexically_normal().generic_string();
+	for (auto& c : normalized) {
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	}
+	return normalized;
+}
+
+redox::u64 redox::rpak::hash_path(StringView normalizedPath) {
+	//FNV-1a
+	u64 hash = 14695981039346656037ull;
+	for (auto c : normalizedPath) {
+		hash ^= static_cast<u8>(c);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+redox::Archive::Archive(const Path& file, ThreadPool* threadPool) :
+	_path(file),
+	_threadPool(threadPool),
+	_file(make_shared<io::MappedFile>(file)) {
+
+	if (_file->size() < sizeof(rpak::header)) {
+		throw Exception("invalid archive");
+	}
+
+	rpak::header header;
+	std::memcpy(&header, _file->data(), sizeof(header));
+
+	if (header.magic != rpak::MAGIC || header.version != rpak::VERSION) {
+		throw Exception("invalid archive header");
+	}
+
+	//Offsets come from the file, ranges are compared against the space that remains so they can't wrap
+	if (header.tocOffset % alignof(rpak::toc_entry) != 0 || header.namesOffset > _file->size()
+		|| header.tocOffset > header.namesOffset
+		|| header.entryCount > (header.namesOffset - header.tocOffset) / sizeof(rpak::toc_entry)) {
+		throw Exception("invalid archive table of contents");
+	}
+
+	_entryCount = header.entryCount;
+	_toc = reinterpret_cast<const rpak::toc_entry*>(_file->data() + header.tocOffset);
+	_names = reinterpret_cast<const char*>(_file->data() + header.namesOffset);
+
+	auto namesSize = _file->size() - header.namesOffset;
+	for (u32 i = 0; i < _entryCount; ++i) {
+		const auto& entry = _toc[i];
+		if (entry.offset > header.tocOffset || entry.storedSize > header.tocOffset - entry.offset
+			|| static_cast<u64>(entry.nameOffset) + entry.nameLength > namesSize) {
+			throw Exception("invalid archive entry");
+		}
+
+		//Uncompressed entries are read back as they are stored
+		if (!util::check_flag(entry.flags, rpak::EntryFlags::COMPRESSED) && entry.size != entry.storedSize) {
+			throw Exception("invalid archive entry");
+		}
+	}
+}
+
+const redox::Path& redox::Archive::path() const {
+	return _path;
+}
+
+std::size_t redox::Archive::entry_count() const {
+	return _entryCount;
+}
+
+bool redox::Archive::contains(const Path& relativePath) const {
+	return _find(relativePath) != nullptr;
+}
+
+std::optional<redox::io::FileView> redox::Archive::read(const Path& relativePath) const {
+	auto entry = _find(relativePath);
+	if (entry == nullptr) {
+		return std::nullopt;
+	}
+
+	if (util::check_flag(entry->flags, rpak::EntryFlags::COMPRESSED)) {
+		return _decompress(*entry);
+	}
+
+	return io::FileView(_file, _file->data() + entry->offset, static_cast<std::size_t>(entry->size));
+}
+
+const redox::rpak::toc_entry* redox::Archive::_find(const Path& relativePath) const {
+	auto name = rpak::normalize_path(relativePath);
+	auto hash = rpak::hash_path(name);
+
+	auto end = _toc + _entryCount;
+	auto it = std::lower_bound(_toc, end, hash, [](const rpak::toc_entry& entry, u64 hash) {
+		return entry.hash < hash;
+	});
+
+	//Resolve hash collisions by comparing the stored paths
+	for (; it != end && it->hash == hash; ++it) {
+		if (StringView(_names + it->nameOffset, it->nameLength) == name) {
+			return it;
+		}
+	}
+
+	return nullptr;
+}
+
+redox::io::FileView redox::Archive::_decompress(const rpak::toc_entry& entry) const {
+	const byte* payload = _file->data() + entry.offset;
+
+	u32 blockCount;
+	if (entry.storedSize < sizeof(blockCount) || entry.blockSize == 0) {
+		throw Exception("invalid compressed archive entry");
+	}
+
+	std::memcpy(&blockCount, payload, sizeof(blockCount));
+
+	auto headerSize = sizeof(u32) * (static_cast<u64>(blockCount) + 1);
+	if (blockCount != (entry.size + entry.blockSize - 1) / entry.blockSize || headerSize > entry.storedSize) {
+		throw Exception("invalid compressed archive entry");
+	}
+
+	auto job = make_shared<block_job>();
+	job->blockSize = entry.blockSize;
+	job->size = static_cast<std::size_t>(entry.size);
+	job->srcSizes.resize(blockCount);
+	job->srcOffsets.resize(blockCount);
+
+	if (blockCount > 0) {
+		std::memcpy(job->srcSizes.data(), payload + sizeof(u32), sizeof(u32) * blockCount);
+	}
+
+	std::size_t offset = static_cast<std::size_t>(headerSize);
+	for (u32 i = 0; i < blockCount; ++i) {
+		job->srcOffsets[i] = offset;
+		offset += job->srcSizes[i];
+	}
+
+	if (offset > entry.storedSize) {
+		throw Exception("invalid compressed archive entry");
+	}
+
+	Buffer<byte> output(job->size);
+	job->src = payload;
+	job->dst = output.data();
+
+	if (_threadPool != nullptr && blockCount > 1) {
+		auto helpers = std::min<std::size_t>(blockCount - 1, _threadPool->size());
+		for (std::size_t i = 0; i < helpers; ++i) {
+			_threadPool->submit([job]() { job->run(); }, TaskPriority::HIGH);
+		}
+	}
+
+	//The calling thread always takes part, so this cannot stall on a busy pool
+	job->run();
+	{
+		std::unique_lock lock(job->mutex);
+		job->condition.wait(lock, [&job]() { return job->done == job->block_count(); });
+	}
+
+	if (job->failed) {
+		throw Exception("failed to decompress archive entry");
+	}
+
+	return io::FileView(std::move(output));
+}
+
+redox::ArchiveWriter::ArchiveWriter(u32 alignment, u32 blockSize) :
+	_alignment(alignment), _blockSize(blockSize) {
+
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+		throw Exception("archive alignment must be a power of two");
+	}
+
+	if (blockSize == 0) {
+		throw Exception("invalid archive block size");
+	}
+}
+
+void redox::ArchiveWriter::add(const Path& relativePath, Buffer<byte> data, bool compress) {
+	_entries.push_back({ rpak::normalize_path(relativePath), std::move(data), compress });
+}
+
+void redox::ArchiveWriter::add_file(const Path& relativePath, const Path& file, bool compress) {
+	io::File input(file, io::File::Mode::READ | io::File::Mode::THROW_IF_INVALID);
+	auto data = input.read();
+	add(relativePath, Buffer<byte>(data.begin(), data.end()), compress);
+}
+
+void redox::ArchiveWriter::write(const Path& output) const {
+	Buffer<byte> blob(sizeof(rpak::header));
+	Buffer<rpak::toc_entry> toc;
+	String names;
+
+	toc.reserve(_entries.size());
+
+	for (const auto& pending : _entries) {
+		rpak::toc_entry entry{};
+		entry.hash = rpak::hash_path(pending.name);
+		entry.size = pending.data.size();
+		entry.nameOffset = static_cast<u32>(names.size());
+		entry.nameLength = static_cast<u32>(pending.name.size());
+		names += pending.name;
+
+		blob.resize(align_up<std::size_t>(blob.size(), _alignment));
+		entry.offset = blob.size();
+
+		Buffer<byte> compressed;
+		if (pending.compress && !pending.data.empty()) {
+			auto blockCount = static_cast<u32>((pending.data.size() + _blockSize - 1) / _blockSize);
+			Buffer<u32> blockSizes(blockCount);
+			Buffer<byte> blocks;
+
+			for (u32 i = 0; i < blockCount; ++i) {
+				auto srcOffset = static_cast<std::size_t>(i) * _blockSize;
+				auto srcSize = std::min<std::size_t>(_blockSize, pending.data.size() - srcOffset);
+
+				auto dstOffset = blocks.size();
+				blocks.resize(dstOffset + lz4::compress_bound(srcSize));
+				auto written = lz4::compress(pending.data.data() + srcOffset, srcSize,
+					blocks.data() + dstOffset, blocks.size() - dstOffset);
+
+				blocks.resize(dstOffset + written);
+				blockSizes[i] = static_cast<u32>(written);
+			}
+
+			compressed.resize(sizeof(u32) * (blockCount + 1));
+			std::memcpy(compressed.data(), &blockCount, sizeof(u32));
+			std::memcpy(compressed.data() + sizeof(u32), blockSizes.data(), sizeof(u32) * blockCount);
+			compressed.insert(compressed.end(), blocks.begin(), blocks.end());
+		}
+
+		//Incompressible data is stored as is
+		if (!compressed.empty() && compressed.size() < pending.data.size()) {
+			entry.flags = rpak::EntryFlags::COMPRESSED;
+			entry.blockSize = _blockSize;
+			entry.storedSize = compressed.size();
+			blob.insert(blob.end(), compressed.begin(), compressed.end());
+		}
+		else {
+			entry.storedSize = pending.data.size();
+			blob.insert(blob.end(), pending.data.begin(), pending.data.end());
+		}
+
+		toc.push_back(entry);
+	}
+
+	std::sort(toc.begin(), toc.end(), [](const rpak::toc_entry& a, const rpak::toc_entry& b) {
+		return a.hash < b.hash;
+	});
+
+	rpak::header header{};
+	header.magic = rpak::MAGIC;
+	header.version = rpak::VERSION;
+	header.entryCount = static_cast<u32>(toc.size());
+	header.alignment = _alignment;
+	header.tocOffset = align_up<u64>(blob.size(), alignof(rpak::toc_entry));
+	header.namesOffset = header.tocOffset + toc.size() * sizeof(rpak::toc_entry);
+
+	blob.resize(static_cast<std::size_t>(header.tocOffset));
+	std::memcpy(blob.data(), &header, sizeof(header));
+
+	io::File file(output, io::File::Mode::WRITE | io::File::Mode::ALWAYS_CREATE | io::File::Mode::THROW_IF_INVALID);
+	file.write(blob.data(), blob.size());
+	file.write(toc.data(), toc.size() * sizeof(rpak::toc_entry));
+	file.write(names.data(), names.size());
+
+	RDX_LOG("Wrote archive {0} ({1} entries)", output, toc.size());
+}
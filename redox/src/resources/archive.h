@@ -0,0 +1,129 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+#include <core/non_copyable.h>
+#include <core/threading/thread_pool.h>
+#include <platform/filesystem.h>
+
+#include <optional> //std::optional
+
+namespace redox {
+	namespace rpak {
+		/*
+		* Layout:
+		*   header
+		*   entry data, every entry starts at a multiple of header::alignment
+		*   toc_entry[entryCount], sorted by hash
+		*   path string table (not null terminated)
+		*
+		* Compressed entries are split into independent LZ4 blocks of toc_entry::blockSize
+		* bytes (the last one may be smaller) so they can be decompressed in parallel:
+		*   u32 blockCount, u32 compressedSize[blockCount], block data...
+		*/
+		constexpr u32 MAGIC = 0x4b415052; //"RPAK"
+		constexpr u32 VERSION = 1;
+
+		enum class EntryFlags : u32 {
+			NONE = 0,
+			COMPRESSED = 0x1 << 0
+		};
+
+		struct header {
+			u32 magic;
+			u32 version;
+			u32 entryCount;
+			u32 alignment;
+			u64 tocOffset;
+			u64 namesOffset;
+		};
+
+		struct toc_entry {
+			u64 hash;
+			u64 offset;
+			u64 storedSize;
+			u64 size;
+			EntryFlags flags;
+			u32 blockSize;
+			u32 nameOffset;
+			u32 nameLength;
+		};
+
+		static_assert(sizeof(header) == 32 && sizeof(toc_entry) == 48, "rpak structures must be tightly packed");
+
+		//Archive paths are relative, case insensitive and use '/' separators
+		String normalize_path(const Path& path);
+		u64 hash_path(StringView normalizedPath);
+	}
+
+	class Archive : public NonCopyable {
+	public:
+		//Compressed entries are decompressed on threadPool if one is given
+		Archive(const Path& file, ThreadPool* threadPool = nullptr);
+		~Archive() = default;
+
+		const Path& path() const;
+		std::size_t entry_count() const;
+
+		bool contains(const Path& relativePath) const;
+
+		//Uncompressed entries are zero-copy views into the mapping
+		std::optional<io::FileView> read(const Path& relativePath) const;
+
+	private:
+		const rpak::toc_entry* _find(const Path& relativePath) const;
+		io::FileView _decompress(const rpak::toc_entry& entry) const;
+
+		Path _path;
+		ThreadPool* _threadPool;
+		SharedPtr<io::MappedFile> _file;
+		const rpak::toc_entry* _toc;
+		const char* _names;
+		u32 _entryCount;
+	};
+
+	class ArchiveWriter : public NonCopyable {
+	public:
+		ArchiveWriter(u32 alignment = 16, u32 blockSize = 64 * 1024);
+
+		void add(const Path& relativePath, Buffer<byte> data, bool compress = false);
+		void add_file(const Path& relativePath, const Path& file, bool compress = false);
+		void write(const Path& output) const;
+
+	private:
+		struct pending_entry {
+			String name;
+			Buffer<byte> data;
+			bool compress;
+		};
+
+		u32 _alignment;
+		u32 _blockSize;
+		Buffer<pending_entry> _entries;
+	};
+}
+
+RDX_ENABLE_ENUM_FLAGS(::redox::rpak::EntryFlags);
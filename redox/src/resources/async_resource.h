@@ -0,0 +1,113 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+#include <resources/resource.h>
+
+#include <mutex> //std::mutex, std::lock_guard
+
+namespace redox {
+
+	enum class LoadState {
+		PENDING,
+		READY,
+		FAILED
+	};
+
+	namespace detail {
+		struct async_resource_state {
+			using callback_type = Function<void(const ResourceHandle<IResource>&)>;
+
+			std::mutex mutex;
+			LoadState state{ LoadState::PENDING };
+			ResourceHandle<IResource> resource;
+			Buffer<callback_type> callbacks;
+		};
+	}
+
+	template<class T>
+	class AsyncResourceHandle {
+	public:
+		AsyncResourceHandle() = default;
+		AsyncResourceHandle(SharedPtr<detail::async_resource_state> state) :
+			_state(std::move(state)) {
+		}
+
+		//Returns the loaded resource or the placeholder while loading is in progress
+		ResourceHandle<T> get() const {
+			if (!_state) {
+				return nullptr;
+			}
+
+			std::lock_guard guard(_state->mutex);
+			return std::static_pointer_cast<T>(_state->resource);
+		}
+
+		LoadState state() const {
+			if (!_state) {
+				return LoadState::FAILED;
+			}
+
+			std::lock_guard guard(_state->mutex);
+			return _state->state;
+		}
+
+		bool is_ready() const {
+			return state() == LoadState::READY;
+		}
+
+		//Callbacks are invoked on the main thread (see ResourceManager::update).
+		//The argument is null if the resource failed to load or the handle is empty.
+		template<class Fn>
+		void then(Fn&& fn) {
+			if (!_state) {
+				fn(ResourceHandle<T>());
+				return;
+			}
+
+			std::unique_lock lock(_state->mutex);
+			if (_state->state == LoadState::PENDING) {
+				_state->callbacks.emplace_back([fn = std::forward<Fn>(fn)](const ResourceHandle<IResource>& resource) {
+					fn(std::static_pointer_cast<T>(resource));
+				});
+				return;
+			}
+
+			auto resource = _state->state == LoadState::READY ?
+				std::static_pointer_cast<T>(_state->resource) : nullptr;
+
+			lock.unlock();
+			fn(resource);
+		}
+
+		explicit operator bool() const {
+			return get() != nullptr;
+		}
+
+	private:
+		SharedPtr<detail::async_resource_state> _state;
+	};
+}
@@ -0,0 +1,232 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "derived_data_cache.h"
+#include <core/hash/xxhash.h>
+#include <core/logging/log.h>
+
+#include <algorithm> //std::sort
+#include <cstdio> //std::snprintf
+#include <cstring> //std::memcpy
+#include <functional> //std::hash
+#include <thread> //std::this_thread
+
+namespace {
+	constexpr const char* ENTRY_EXT = ".ddc";
+	constexpr const char* TMP_EXT = ".tmp";
+}
+
+redox::DerivedDataCache::DerivedDataCache(const Path& directory, std::size_t capacity) :
+	_directory(io::absolute(directory)),
+	_capacity(capacity) {
+
+	std::error_code ec;
+	io::create_directories(_directory, ec);
+	if (ec) {
+		throw Exception("failed to create derived data cache directory");
+	}
+
+	//Leftovers from writes that never got renamed into place
+	for (const auto& file : io::recursive_directory_iterator(_directory, ec)) {
+		if (!file.is_regular_file(ec)) {
+			continue;
+		}
+
+		if (file.path().extension() == TMP_EXT) {
+			io::remove(file.path(), ec);
+		}
+		else if (file.path().extension() == ENTRY_EXT) {
+			_size += static_cast<std::size_t>(file.file_size(ec));
+		}
+	}
+
+	RDX_LOG("Derived data cache: {0} MB in {1}", _size / (1024 * 1024), _directory.string());
+	trim();
+}
+
+std::optional<redox::io::FileView> redox::DerivedDataCache::load(StringView type, u64 contentHash, u32 importerVersion) {
+	auto entry = _entry_path(type, contentHash, importerVersion);
+
+	io::FileView view;
+	{
+		io::File file(entry);
+		if (!file.is_valid()) {
+			return std::nullopt;
+		}
+		view = file.read_view();
+	}
+
+	ddc::header header{};
+	if (view.size() >= sizeof(header)) {
+		std::memcpy(&header, view.data(), sizeof(header));
+	}
+
+	auto payload = view.subview(sizeof(header), view.size());
+
+	if (header.magic != ddc::MAGIC ||
+		header.version != ddc::VERSION ||
+		header.contentHash != contentHash ||
+		header.importerVersion != importerVersion ||
+		header.payloadSize != payload.size() ||
+		header.payloadHash != hash::xxh64(payload.data(), payload.size())) {
+
+		RDX_LOG("Discarding corrupt derived data {0}", ConsoleColor::RED, entry.filename().string());
+		view = {};
+		payload = {};
+		_remove(entry);
+		return std::nullopt;
+	}
+
+	//Keeps recently used entries away from the front of the eviction order
+	std::error_code ec;
+	io::last_write_time(entry, io::file_time_type::clock::now(), ec);
+	return payload;
+}
+
+void redox::DerivedDataCache::store(StringView type, u64 contentHash, u32 importerVersion,
+	const void* data, std::size_t size) {
+
+	auto entry = _entry_path(type, contentHash, importerVersion);
+
+	std::error_code ec;
+	io::create_directories(entry.parent_path(), ec);
+
+	auto tmp = entry;
+	tmp += format(".{0}.{1}{2}", std::hash<std::thread::id>{}(std::this_thread::get_id()), _tmpCounter++, TMP_EXT);
+
+	ddc::header header{};
+	header.magic = ddc::MAGIC;
+	header.version = ddc::VERSION;
+	header.contentHash = contentHash;
+	header.importerVersion = importerVersion;
+	header.payloadSize = size;
+	header.payloadHash = hash::xxh64(data, size);
+
+	try {
+		io::File file(tmp, io::File::Mode::WRITE | io::File::Mode::ALWAYS_CREATE | io::File::Mode::THROW_IF_INVALID);
+		file.write(&header, sizeof(header));
+		file.write(data, size);
+	}
+	catch (const Exception& ex) {
+		RDX_LOG("Failed to write derived data: {0}", ConsoleColor::RED, ex.what());
+		io::remove(tmp, ec);
+		return;
+	}
+
+	auto replacedSize = io::exists(entry, ec) ? io::file_size(entry, ec) : 0;
+	if (ec) replacedSize = 0;
+
+	//Another thread may have produced the same entry, either copy is fine
+	io::rename(tmp, entry, ec);
+	if (ec) {
+		io::remove(tmp, ec);
+		return;
+	}
+
+	{
+		std::lock_guard guard(_mutex);
+		_size += sizeof(header) + size;
+		_size -= std::min<std::size_t>(_size, static_cast<std::size_t>(replacedSize));
+	}
+
+	trim();
+}
+
+void redox::DerivedDataCache::trim() {
+	std::lock_guard guard(_mutex);
+	if (_capacity == 0 || _size <= _capacity) {
+		return;
+	}
+
+	struct cached_file {
+		Path path;
+		io::file_time_type lastUsed;
+		std::size_t size;
+	};
+
+	Buffer<cached_file> files;
+	std::size_t total = 0;
+
+	std::error_code ec;
+	for (const auto& file : io::recursive_directory_iterator(_directory, ec)) {
+		if (file.is_regular_file(ec) && file.path().extension() == ENTRY_EXT) {
+			files.push_back({ file.path(), file.last_write_time(ec),
+				static_cast<std::size_t>(file.file_size(ec)) });
+			total += files.back().size;
+		}
+	}
+
+	std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+		return a.lastUsed < b.lastUsed;
+	});
+
+	//Evict down to 3/4 of the capacity so a full cache doesn't rescan on every store
+	const auto target = _capacity / 4 * 3;
+	std::size_t evicted = 0;
+
+	for (const auto& file : files) {
+		if (total <= target) {
+			break;
+		}
+
+		//Fails for entries that are still mapped on some platforms, those are kept
+		if (io::remove(file.path, ec)) {
+			total -= file.size;
+			evicted += file.size;
+		}
+	}
+
+	_size = total;
+	RDX_LOG("Derived data cache trimmed by {0} KB", evicted / 1024);
+}
+
+const redox::Path& redox::DerivedDataCache::directory() const {
+	return _directory;
+}
+
+std::size_t redox::DerivedDataCache::capacity() const {
+	return _capacity;
+}
+
+std::size_t redox::DerivedDataCache::size() const {
+	std::lock_guard guard(_mutex);
+	return _size;
+}
+
+redox::Path redox::DerivedDataCache::_entry_path(StringView type, u64 contentHash, u32 importerVersion) const {
+	char name[64];
+	std::snprintf(name, sizeof(name), "%016llx-v%u%s",
+		static_cast<unsigned long long>(contentHash), importerVersion, ENTRY_EXT);
+	return _directory / Path(type) / name;
+}
+
+void redox::DerivedDataCache::_remove(const Path& entry) {
+	std::error_code ec;
+	auto size = io::file_size(entry, ec);
+	if (!ec && io::remove(entry, ec)) {
+		std::lock_guard guard(_mutex);
+		_size -= std::min<std::size_t>(_size, static_cast<std::size_t>(size));
+	}
+}
@@ -0,0 +1,91 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+#include <core/non_copyable.h>
+#include <platform/filesystem.h>
+
+#include <atomic> //std::atomic
+#include <mutex> //std::mutex
+#include <optional> //std::optional
+
+namespace redox {
+	namespace ddc {
+		/*
+		* One file per entry: <directory>/<type>/<content hash>-v<version>.ddc
+		*   header
+		*   payload, starts at sizeof(header)
+		*
+		* Entries are written to a temporary file and renamed into place, a hit
+		* refreshes the modification time which is what trim() evicts by.
+		*/
+		constexpr u32 MAGIC = 0x43444452; //"RDDC"
+		constexpr u32 VERSION = 1;
+
+		struct header {
+			u32 magic;
+			u32 version;
+			u64 contentHash;
+			u32 importerVersion;
+			u32 reserved;
+			u64 payloadSize;
+			u64 payloadHash;
+			u64 padding;
+		};
+
+		static_assert(sizeof(header) == 48, "ddc header must be tightly packed");
+	}
+
+	//Local cache of engine ready data derived from source assets, keyed by the
+	//source content hash and the version of the importer that produced it
+	class DerivedDataCache : public NonCopyable {
+	public:
+		DerivedDataCache(const Path& directory, std::size_t capacity);
+		~DerivedDataCache() = default;
+
+		//The payload is memory mapped, stale or corrupt entries are removed and reported as a miss
+		std::optional<io::FileView> load(StringView type, u64 contentHash, u32 importerVersion);
+		void store(StringView type, u64 contentHash, u32 importerVersion, const void* data, std::size_t size);
+
+		//Removes the least recently used entries until the cache fits its capacity
+		void trim();
+
+		const Path& directory() const;
+		std::size_t capacity() const;
+		std::size_t size() const;
+
+	private:
+		Path _entry_path(StringView type, u64 contentHash, u32 importerVersion) const;
+		void _remove(const Path& entry);
+
+		Path _directory;
+		std::size_t _capacity;
+		std::atomic<u64> _tmpCounter{ 0 };
+
+		mutable std::mutex _mutex;
+		std::size_t _size{ 0 };
+	};
+}
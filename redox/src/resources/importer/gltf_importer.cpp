@@ -25,15 +25,184 @@ SOFTWARE.
 */
 #include "gltf_importer.h"
 #include "core/logging/log.h"
+#include "resources/resource_manager.h"
+#include "math/simd.h"
+
+#include <algorithm> //std::max
+#include <cstring> //std::memcpy
+#include <limits> //std::numeric_limits
+#include <type_traits> //std::is_same_v
+
+namespace {
+	using redox::byte;
+	using redox::f32;
+
+	std::size_t component_count(cgltf_type type) {
+		switch (type) {
+		case cgltf_type_scalar: return 1;
+		case cgltf_type_vec2: return 2;
+		case cgltf_type_vec3: return 3;
+		case cgltf_type_vec4: return 4;
+		case cgltf_type_mat2: return 4;
+		case cgltf_type_mat3: return 9;
+		case cgltf_type_mat4: return 16;
+		default: return 0;
+		}
+	}
+
+	std::size_t component_size(cgltf_component_type type) {
+		switch (type) {
+		case cgltf_component_type_r_8:
+		case cgltf_component_type_r_8u: return 1;
+		case cgltf_component_type_r_16:
+		case cgltf_component_type_r_16u: return 2;
+		case cgltf_component_type_r_32u:
+		case cgltf_component_type_r_32f: return 4;
+		default: return 0;
+		}
+	}
+
+	//Normalized integers follow the glTF rules, signed values are clamped to -1
+	template<class T>
+	f32 to_float(T value, bool normalized) {
+		if constexpr (std::is_same_v<T, int8_t>) {
+			return normalized ? std::max(value / 127.0f, -1.0f) : value;
+		}
+		else if constexpr (std::is_same_v<T, int16_t>) {
+			return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+		}
+		else if constexpr (std::is_integral_v<T>) {
+			return normalized ? value / static_cast<f32>(std::numeric_limits<T>::max()) : value;
+		}
+		else return value;
+	}
+
+	template<class T>
+	void convert_components(const byte* src, std::size_t stride, std::size_t count,
+		std::size_t components, bool normalized, f32* dst) {
+
+		for (std::size_t i = 0; i < count; ++i, src += stride) {
+			for (std::size_t c = 0; c < components; ++c) {
+				T value;
+				std::memcpy(&value, src + c * sizeof(T), sizeof(T));
+				*dst++ = to_float(value, normalized);
+			}
+		}
+	}
+
+	template<class T>
+	void convert_indices(const byte* src, std::size_t stride, std::size_t count, uint32_t* dst) {
+		for (std::size_t i = 0; i < count; ++i, src += stride) {
+			T value;
+			std::memcpy(&value, src, sizeof(T));
+			dst[i] = value;
+		}
+	}
+
+	bool is_data_uri(redox::StringView uri) {
+		return uri.compare(0, 5, "data:") == 0;
+	}
+
+	//Only base64 payloads are valid for glTF buffers, e.g. "data:application/octet-stream;base64,..."
+	redox::Buffer<byte> decode_data_uri(redox::StringView uri) {
+		constexpr redox::StringView marker = ";base64,";
+		auto start = uri.find(marker);
+		if (start == redox::StringView::npos) {
+			throw redox::Exception("unsupported gltf data uri");
+		}
+
+		auto sextet = [](char c) -> int {
+			if (c >= 'A' && c <= 'Z') return c - 'A';
+			if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+			if (c >= '0' && c <= '9') return c - '0' + 52;
+			if (c == '+') return 62;
+			if (c == '/') return 63;
+			return -1;
+		};
+
+		auto encoded = uri.substr(start + marker.size());
+		redox::Buffer<byte> decoded;
+		decoded.reserve(encoded.size() / 4 * 3);
+
+		redox::u32 bits = 0;
+		int bitCount = 0;
+
+		for (auto c : encoded) {
+			if (c == '=') {
+				break;
+			}
+
+			auto value = sextet(c);
+			if (value < 0) {
+				throw redox::Exception("invalid base64 in gltf data uri");
+			}
+
+			bits = (bits << 6) | static_cast<redox::u32>(value);
+			bitCount += 6;
+
+			if (bitCount >= 8) {
+				bitCount -= 8;
+				decoded.push_back(static_cast<byte>(bits >> bitCount));
+			}
+		}
+
+		return decoded;
+	}
+
+	/*
+	* De-strides position/normal/uv streams into MeshVertex, every field occupies a full
+	* 16 byte lane so each vertex is three unaligned loads and three aligned stores.
+	* Streams with a stride of zero broadcast their first element.
+	*/
+	void interleave_vertices(redox::graphics::MeshVertex* dst, std::size_t count,
+		const byte* pos, std::size_t posStride,
+		const byte* nrm, std::size_t nrmStride,
+		const byte* uv, std::size_t uvStride) {
+
+		namespace simd = redox::simd;
+		using redox::math::Vec3f;
+		using redox::math::Vec2f;
+
+		if (count == 0) {
+			return;
+		}
+
+		const auto zero = simd::set_zero();
+
+		//Loading 16 bytes from a vec3 overreads by 4, which is only safe before the last element
+		for (std::size_t i = 0; i + 1 < count; ++i) {
+			auto p = simd::load_unaligned(reinterpret_cast<const f32*>(pos + i * posStride));
+			auto n = simd::load_unaligned(reinterpret_cast<const f32*>(nrm + i * nrmStride));
+			auto t = simd::load_lower2(reinterpret_cast<const f32*>(uv + i * uvStride));
+
+			dst[i].pos = Vec3f(simd::blend<0x8>(p, zero));
+			dst[i].normal = Vec3f(simd::blend<0x8>(n, zero));
+			dst[i].uv = Vec2f(t);
+		}
+
+		auto last = count - 1;
+		f32 p[3], n[3], t[2];
+		std::memcpy(p, pos + last * posStride, sizeof(p));
+		std::memcpy(n, nrm + last * nrmStride, sizeof(n));
+		std::memcpy(t, uv + last * uvStride, sizeof(t));
+
+		dst[last].pos = Vec3f(p[0], p[1], p[2]);
+		dst[last].normal = Vec3f(n[0], n[1], n[2]);
+		dst[last].uv = Vec2f(t[0], t[1]);
+	}
+}
 
 redox::GLTFImporter::GLTFImporter(const Path& filePath) :
-	_searchPath(filePath.parent_path()) {
+	GLTFImporter(filePath, ResourceManager::instance()->vfs()->read(filePath)) {
+}
 
-	io::File file(filePath, io::File::Mode::READ | io::File::Mode::THROW_IF_INVALID);
-	auto buffer = file.read();
+redox::GLTFImporter::GLTFImporter(const Path& filePath, io::FileView source) :
+	_source(std::move(source)),
+	_searchPath(filePath.parent_path()) {
 
+	//The GLB binary chunk is referenced, not copied, _source has to outlive _data
 	cgltf_options options{};
-	cgltf_result result = cgltf_parse(&options, buffer.data(), buffer.size(), &_data);
+	cgltf_result result = cgltf_parse(&options, _source.data(), _source.size(), &_data);
 	if (result != cgltf_result_success) {
 		throw Exception("failed to load gltf file");
 	}
@@ -43,6 +212,12 @@ redox::GLTFImporter::~GLTFImporter() {
 	cgltf_free(&_data);
 }
 
+redox::io::FileView redox::GLTFImporter::_read_file(const Path& path) const {
+	//Buffers are not resources themselves, changing one rebuilds the model
+	ResourceManager::instance()->add_dependency(path);
+	return ResourceManager::instance()->vfs()->read(path);
+}
+
 std::size_t redox::GLTFImporter::mesh_count() const {
 	return _data.meshes_count;
 }
@@ -51,6 +226,17 @@ std::size_t redox::GLTFImporter::material_count() const {
 	return _data.material_count;
 }
 
+redox::Buffer<redox::Path> redox::GLTFImporter::buffer_files() const {
+	Buffer<Path> files;
+	for (std::size_t i = 0; i < _data.buffers_count; ++i) {
+		auto uri = _data.buffers[i].uri;
+		if (uri && !is_data_uri(uri)) {
+			files.push_back(_searchPath / uri);
+		}
+	}
+	return files;
+}
+
 redox::GLTFImporter::material_data redox::GLTFImporter::import_material(std::size_t index) {
 	if (index >= _data.material_count) {
 		throw Exception("material index not found");
@@ -59,19 +245,125 @@ redox::GLTFImporter::material_data redox::GLTFImporter::import_material(std::siz
 	const auto& material = _data.materials[index];
 	material_data output{ material.name ? material.name : "unknown" };
 
-	if (material.pbr.base_color_texture.texture) {
-		output.albedoMap = material.pbr.base_color_texture.texture->image->uri;
+	//Images stored inside a .glb have no uri, those fall back to the default texture
+	auto image_uri = [](const cgltf_texture_view& view) -> String {
+		return (view.texture && view.texture->image && view.texture->image->uri) ?
+			view.texture->image->uri : "";
+	};
+
+	output.albedoMap = image_uri(material.pbr.base_color_texture);
+	output.normalMap = image_uri(material.normal_texture);
+	output.aoMap = image_uri(material.occlusion_texture);
+
+	return output;
+}
+
+const redox::io::FileView& redox::GLTFImporter::_buffer_data(const cgltf_buffer* buffer) {
+	//Map nodes stay put, so the returned view outlives the lock
+	std::lock_guard guard(_buffersMutex);
+	auto it = _buffers.find(buffer);
+	if (it != _buffers.end()) {
+		return it->second;
 	}
 
-	if (material.normal_texture.texture) {
-		output.normalMap = material.normal_texture.texture->image->uri;
+	io::FileView view;
+	if (buffer->uri == nullptr) {
+		//GLB binary chunk, cgltf points it into _source
+		if (_data.bin == nullptr) {
+			throw Exception("gltf buffer without data");
+		}
+		view = _source.subview(static_cast<const byte*>(_data.bin) - _source.data(), _data.bin_size);
+	}
+	else if (is_data_uri(buffer->uri)) {
+		view = decode_data_uri(buffer->uri);
 	}
+	else view = _read_file(_searchPath / buffer->uri);
 
-	if (material.occlusion_texture.texture) {
-		output.aoMap = material.occlusion_texture.texture->image->uri;
+	return _buffers.emplace(buffer, std::move(view)).first->second;
+}
+
+const redox::byte* redox::GLTFImporter::_accessor_data(const cgltf_accessor* accessor) {
+	auto bufferView = accessor->buffer_view;
+	if (bufferView == nullptr) {
+		throw Exception("unsupported gltf buffer");
 	}
 
-	return output;
+	auto& buffer = _buffer_data(bufferView->buffer);
+
+	auto elementSize = component_count(accessor->type) * component_size(accessor->component_type);
+	auto offset = bufferView->offset + accessor->offset;
+
+	if (elementSize == 0 || accessor->stride < elementSize ||
+		(accessor->count > 0 && offset + (accessor->count - 1) * accessor->stride + elementSize > buffer.size())) {
+		throw Exception("gltf accessor out of bounds");
+	}
+
+	return buffer.data() + offset;
+}
+
+redox::GLTFImporter::attribute_stream redox::GLTFImporter::_attribute_stream(
+	const cgltf_accessor* accessor, std::size_t components, Buffer<float_t>& scratch) {
+
+	if (component_count(accessor->type) < components) {
+		throw Exception("unexpected gltf attribute type");
+	}
+
+	auto src = _accessor_data(accessor);
+
+	//Float data is read in place, whatever the stride
+	if (accessor->component_type == cgltf_component_type_r_32f) {
+		return { src, accessor->stride };
+	}
+
+	scratch.resize(accessor->count * components);
+	auto dst = scratch.data();
+	auto normalized = accessor->normalized != 0;
+
+	switch (accessor->component_type) {
+	case cgltf_component_type_r_8:
+		convert_components<int8_t>(src, accessor->stride, accessor->count, components, normalized, dst);
+		break;
+	case cgltf_component_type_r_8u:
+		convert_components<uint8_t>(src, accessor->stride, accessor->count, components, normalized, dst);
+		break;
+	case cgltf_component_type_r_16:
+		convert_components<int16_t>(src, accessor->stride, accessor->count, components, normalized, dst);
+		break;
+	case cgltf_component_type_r_16u:
+		convert_components<uint16_t>(src, accessor->stride, accessor->count, components, normalized, dst);
+		break;
+	case cgltf_component_type_r_32u:
+		convert_components<uint32_t>(src, accessor->stride, accessor->count, components, false, dst);
+		break;
+	default:
+		throw Exception("unsupported gltf component type");
+	}
+
+	return { reinterpret_cast<const byte*>(scratch.data()), components * sizeof(float_t) };
+}
+
+void redox::GLTFImporter::_read_indices(const cgltf_accessor* accessor, Buffer<uint32_t>& indices) {
+	auto src = _accessor_data(accessor);
+	auto offset = indices.size();
+	indices.resize(offset + accessor->count);
+	auto dst = indices.data() + offset;
+
+	switch (accessor->component_type) {
+	case cgltf_component_type_r_8u:
+		convert_indices<uint8_t>(src, accessor->stride, accessor->count, dst);
+		break;
+	case cgltf_component_type_r_16u:
+		convert_indices<uint16_t>(src, accessor->stride, accessor->count, dst);
+		break;
+	case cgltf_component_type_r_32u:
+		if (accessor->stride == sizeof(uint32_t)) {
+			std::memcpy(dst, src, accessor->count * sizeof(uint32_t));
+		}
+		else convert_indices<uint32_t>(src, accessor->stride, accessor->count, dst);
+		break;
+	default:
+		throw Exception("unsupported gltf index type");
+	}
 }
 
 redox::GLTFImporter::mesh_data redox::GLTFImporter::import_mesh(std::size_t index) {
@@ -85,6 +377,10 @@ redox::GLTFImporter::mesh_data redox::GLTFImporter::import_mesh(std::size_t inde
 
 	output.submeshes.reserve(mesh.primitives_count);
 
+	//Missing attributes read as zero
+	alignas(16) static const float_t zeros[4] = {};
+	Buffer<float_t> posScratch, nrmScratch, uvScratch;
+
 	for (std::size_t primIndex = 0; primIndex < mesh.primitives_count; primIndex++) {
 		const auto& primitive = mesh.primitives[primIndex];
 
@@ -94,60 +390,56 @@ redox::GLTFImporter::mesh_data redox::GLTFImporter::import_mesh(std::size_t inde
 
 		submesh_data submesh{};
 		submesh.indexOffset = output.indices.size();
-		output.indices.reserve(primitive.indices->count);
-		read_buffer<uint16_t>(primitive.indices->buffer_view,
-			primitive.indices, [&output](const auto& value) {
-			output.indices.push_back(value);
-		});
+		_read_indices(primitive.indices, output.indices);
 		submesh.indexCount = output.indices.size() - submesh.indexOffset;
-		submesh.attributeOffset = output.positions.size() / 3;
+		submesh.attributeOffset = output.vertices.size();
+
+		const cgltf_accessor* positions = nullptr;
+		const cgltf_accessor* normals = nullptr;
+		const cgltf_accessor* texcoords = nullptr;
 
 		for (std::size_t attrIndex = 0; attrIndex < primitive.attributes_count; attrIndex++) {
 			const auto& attribute = primitive.attributes[attrIndex];
-			const auto& bufferView = attribute.data->buffer_view;
-
-			if (bufferView->type != cgltf_buffer_view_type_vertices) {
-				RDX_LOG("Skipped buffer of type: {0}", bufferView->type);
-				continue;
-			}
 
 			switch (attribute.name) {
-			case cgltf_attribute_type_position: {
-
-				output.positions.reserve(output.positions.capacity() + attribute.data->count * 3);
-				read_buffer<float_t>(bufferView, attribute.data, [&output](const auto& value) {
-					output.positions.push_back(value);
-				});
-
-				break;
+			case cgltf_attribute_type_position: positions = attribute.data; break;
+			case cgltf_attribute_type_normal: normals = attribute.data; break;
+			case cgltf_attribute_type_texcoord_0: texcoords = attribute.data; break;
+			default: break;
 			}
-			case cgltf_attribute_type_normal: {
+		}
 
-				output.normals.reserve(output.normals.capacity() + attribute.data->count * 3);
-				read_buffer<float_t>(bufferView, attribute.data, [&output](const auto& value) {
-					output.normals.push_back(value);
-				});
+		if (positions == nullptr) {
+			throw Exception("primitive without positions");
+		}
 
-				break;
+		auto vertexCount = positions->count;
+		for (auto i = submesh.indexOffset; i < output.indices.size(); ++i) {
+			if (output.indices[i] >= vertexCount) {
+				throw Exception("gltf index out of range");
 			}
+		}
 
-			case cgltf_attribute_type_texcoord_0: {
+		attribute_stream pos = _attribute_stream(positions, 3, posScratch);
+		attribute_stream nrm{ reinterpret_cast<const byte*>(zeros), 0 };
+		attribute_stream uv{ reinterpret_cast<const byte*>(zeros), 0 };
 
-				output.texcoords.reserve(output.texcoords.capacity() + attribute.data->count * 2);
-				read_buffer<float_t>(bufferView, attribute.data, [&output](const auto& value) {
-					output.texcoords.push_back(value);
-				});
+		if (normals && normals->count == vertexCount) {
+			nrm = _attribute_stream(normals, 3, nrmScratch);
+		}
 
-				break;
-			}
-			}
+		if (texcoords && texcoords->count == vertexCount) {
+			uv = _attribute_stream(texcoords, 2, uvScratch);
 		}
 
-		submesh.attributeCount = output.positions.size() / 3 - submesh.attributeOffset;
+		output.vertices.resize(submesh.attributeOffset + vertexCount);
+		interleave_vertices(output.vertices.data() + submesh.attributeOffset, vertexCount,
+			pos.data, pos.stride, nrm.data, nrm.stride, uv.data, uv.stride);
+
+		submesh.attributeCount = vertexCount;
 		submesh.materialIndex = primitive.material - _data.materials;
 		output.submeshes.push_back(std::move(submesh));
 	}
 
-	output.vertexCount = output.positions.size() / 3;
 	return output;
-}
\ No newline at end of file
+}
@@ -32,10 +32,14 @@ SOFTWARE.
 #include <thirdparty/gltf/cgltf.h>
 #pragma warning(pop)
 
+#include <mutex> //std::mutex
+
 namespace redox {
 	class GLTFImporter : public NonCopyable {
 	public:
 		GLTFImporter(const Path& path);
+		//Parses source in place, .glb buffers are served straight from it
+		GLTFImporter(const Path& path, io::FileView source);
 		~GLTFImporter();
 
 		struct submesh_data {
@@ -48,11 +52,8 @@ namespace redox {
 
 		struct mesh_data {
 			redox::String name;
-			std::size_t vertexCount;
-			Buffer<float_t> positions;
-			Buffer<float_t> texcoords;
-			Buffer<float_t> normals;
-			Buffer<uint16_t> indices;
+			Buffer<graphics::MeshVertex> vertices;
+			Buffer<uint32_t> indices; //Relative to the submesh attributeOffset
 			Buffer<submesh_data> submeshes;
 		};
 
@@ -65,32 +66,33 @@ namespace redox {
 
 		std::size_t mesh_count() const;
 		std::size_t material_count() const;
+		//External buffers referenced by the file, the imported data depends on their contents.
+		//Embedded (data URI) and GLB binary chunk buffers are part of the source itself
+		Buffer<Path> buffer_files() const;
 
 		material_data import_material(std::size_t index);
 		mesh_data import_mesh(std::size_t index);
 
 	private:
-		template<class ParseType, class Fn>
-		void read_buffer(cgltf_buffer_view* bufferView, cgltf_accessor* accessor, Fn&& fn) {
-			auto it = _buffers.find(bufferView->buffer->uri);
-			if (it == _buffers.end()) {
-				io::File blobFile(_searchPath / bufferView->buffer->uri,
-					io::File::Mode::READ | io::File::Mode::THROW_IF_INVALID);
-
-				std::tie(it, std::ignore) = _buffers.insert({ bufferView->buffer->uri, blobFile.read() });
-			}
+		//Float view of an accessor, quantized and integer data is converted into scratch
+		struct attribute_stream {
+			const byte* data;
+			std::size_t stride;
+		};
 
-			auto readOffset = bufferView->offset + accessor->offset;
-			auto readSize = accessor->count * accessor->stride;
+		const io::FileView& _buffer_data(const cgltf_buffer* buffer);
+		const byte* _accessor_data(const cgltf_accessor* accessor);
+		attribute_stream _attribute_stream(const cgltf_accessor* accessor,
+			std::size_t components, Buffer<float_t>& scratch);
+		void _read_indices(const cgltf_accessor* accessor, Buffer<uint32_t>& indices);
 
-			for (size_t bufferIndex = readOffset;
-				bufferIndex < readOffset + readSize; bufferIndex += sizeof(ParseType)) {
-				fn(reinterpret_cast<const ParseType&>(it->second[bufferIndex]));
-			}
-		}
+		io::FileView _read_file(const Path& path) const;
 
+		io::FileView _source;
 		cgltf_data _data;
 		Path _searchPath;
-		Hashmap<String, Buffer<i8>> _buffers;
+		//Meshes may be imported from several threads at once
+		std::mutex _buffersMutex;
+		Hashmap<const cgltf_buffer*, io::FileView> _buffers;
 	};
 }
\ No newline at end of file
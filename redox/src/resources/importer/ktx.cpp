@@ -0,0 +1,97 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "ktx.h"
+#include "core/serialization/binary_stream.h"
+
+#include <algorithm> //std::max, std::equal
+
+namespace {
+	constexpr redox::byte KTX2_IDENTIFIER[12] = {
+		0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+	};
+}
+
+bool redox::ktx::is_ktx2(const byte* data, std::size_t size) {
+	return size >= sizeof(KTX2_IDENTIFIER) &&
+		std::equal(std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER), data);
+}
+
+redox::ktx::texture_info redox::ktx::parse(const byte* data, std::size_t size) {
+	if (!is_ktx2(data, size)) {
+		throw Exception("not a ktx2 file");
+	}
+
+	BinaryReader reader(data + sizeof(KTX2_IDENTIFIER), size - sizeof(KTX2_IDENTIFIER));
+
+	texture_info info;
+	info.vkFormat = reader.read<u32>();
+	[[maybe_unused]] auto typeSize = reader.read<u32>();
+	info.width = reader.read<u32>();
+	info.height = reader.read<u32>();
+	auto depth = reader.read<u32>();
+	auto layerCount = reader.read<u32>();
+	auto faceCount = reader.read<u32>();
+	auto levelCount = reader.read<u32>();
+	auto supercompression = reader.read<u32>();
+
+	//Undefined formats are Basis Universal payloads that need transcoding first
+	if (info.vkFormat == 0 || supercompression != 0) {
+		throw Exception("supercompressed ktx2 textures are not supported");
+	}
+
+	if (info.width == 0 || info.height == 0 || depth > 1 || layerCount > 1 || faceCount != 1) {
+		throw Exception("only 2d ktx2 textures are supported");
+	}
+
+	//Data format descriptor, key/value and supercompression data are not needed for plain formats
+	reader.read<u32>();
+	reader.read<u32>();
+	reader.read<u32>();
+	reader.read<u32>();
+	reader.read<u64>();
+	reader.read<u64>();
+
+	//Zero asks the loader to generate the mip chain, the file only holds the base level
+	levelCount = std::max(levelCount, 1u);
+	info.levels.reserve(levelCount);
+
+	for (u32 i = 0; i < levelCount; ++i) {
+		auto offset = reader.read<u64>();
+		auto length = reader.read<u64>();
+		[[maybe_unused]] auto uncompressedLength = reader.read<u64>();
+
+		if (offset > size || length > size - offset) {
+			throw Exception("ktx2 level out of bounds");
+		}
+
+		info.levels.push_back({
+			static_cast<std::size_t>(offset), static_cast<std::size_t>(length),
+			std::max(info.width >> i, 1u), std::max(info.height >> i, 1u)
+		});
+	}
+
+	return info;
+}
@@ -0,0 +1,49 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+
+namespace redox::ktx {
+	struct level {
+		std::size_t offset; //From the start of the file
+		std::size_t size;
+		u32 width;
+		u32 height;
+	};
+
+	struct texture_info {
+		u32 vkFormat; //VkFormat, numeric so the parser stays independent of Vulkan
+		u32 width;
+		u32 height;
+		Buffer<level> levels; //Largest first
+	};
+
+	bool is_ktx2(const byte* data, std::size_t size);
+
+	//Validates the header and the level index of a KTX2 file. Arrays, cube maps, volumes and
+	//supercompressed payloads (Basis Universal, zstd) are rejected with an exception
+	texture_info parse(const byte* data, std::size_t size);
+}
@@ -0,0 +1,769 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "mesh_optimizer.h"
+#include "core/hash/xxhash.h"
+
+#include <algorithm> //std::max, std::min, std::sort, std::stable_sort
+#include <cmath> //std::pow, std::sqrt
+#include <cstring> //std::memcmp
+
+namespace {
+	using redox::f32;
+	using redox::u32;
+	using redox::graphics::MeshVertex;
+
+	constexpr u32 INVALID_INDEX = ~0u;
+
+	/*
+	* Scoring from Tom Forsyth's paper, vertices that are already in the modelled LRU
+	* cache score higher, as do vertices with few triangles left so they get finished off
+	*/
+	constexpr u32 FORSYTH_CACHE_SIZE = 32;
+	constexpr u32 FORSYTH_MAX_VALENCE = 64;
+
+	struct forsyth_scores {
+		f32 cache[FORSYTH_CACHE_SIZE];
+		f32 valence[FORSYTH_MAX_VALENCE];
+
+		forsyth_scores() {
+			constexpr f32 lastTriangleScore = 0.75f;
+			constexpr f32 cacheDecayPower = 1.5f;
+			constexpr f32 valenceBoostScale = 2.0f;
+			constexpr f32 valenceBoostPower = 0.5f;
+
+			for (u32 i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+				cache[i] = i < 3 ? lastTriangleScore :
+					std::pow(1.0f - (i - 3) / static_cast<f32>(FORSYTH_CACHE_SIZE - 3), cacheDecayPower);
+			}
+
+			valence[0] = 0.0f;
+			for (u32 i = 1; i < FORSYTH_MAX_VALENCE; ++i) {
+				valence[i] = valenceBoostScale * std::pow(static_cast<f32>(i), -valenceBoostPower);
+			}
+		}
+
+		f32 score(redox::i32 cachePosition, u32 remaining) const {
+			//Finished vertices don't contribute anymore
+			if (remaining == 0) {
+				return -1.0f;
+			}
+
+			auto result = valence[std::min(remaining, FORSYTH_MAX_VALENCE - 1)];
+			if (cachePosition >= 0) {
+				result += cache[cachePosition];
+			}
+			return result;
+		}
+	};
+
+	struct float3 {
+		f32 x, y, z;
+
+		float3 operator+(const float3& rhs) const { return { x + rhs.x, y + rhs.y, z + rhs.z }; }
+		float3 operator-(const float3& rhs) const { return { x - rhs.x, y - rhs.y, z - rhs.z }; }
+		float3 operator*(f32 s) const { return { x * s, y * s, z * s }; }
+
+		f32 dot(const float3& rhs) const {
+			return x * rhs.x + y * rhs.y + z * rhs.z;
+		}
+
+		float3 cross(const float3& rhs) const {
+			return { y * rhs.z - z * rhs.y, z * rhs.x - x * rhs.z, x * rhs.y - y * rhs.x };
+		}
+	};
+
+	float3 position(const MeshVertex& vertex) {
+		return { vertex.pos.x, vertex.pos.y, vertex.pos.z };
+	}
+
+	//Symmetric 4x4 plane quadric, evaluates to the summed squared distance to its planes
+	struct quadric {
+		redox::f64 a00, a01, a02, a11, a12, a22;
+		redox::f64 b0, b1, b2;
+		redox::f64 c;
+
+		static quadric from_plane(redox::f64 x, redox::f64 y, redox::f64 z, redox::f64 d) {
+			return { x * x, x * y, x * z, y * y, y * z, z * z, x * d, y * d, z * d, d * d };
+		}
+
+		quadric& operator+=(const quadric& rhs) {
+			a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02;
+			a11 += rhs.a11; a12 += rhs.a12; a22 += rhs.a22;
+			b0 += rhs.b0; b1 += rhs.b1; b2 += rhs.b2;
+			c += rhs.c;
+			return *this;
+		}
+
+		redox::f64 error(const float3& p) const {
+			redox::f64 x = p.x, y = p.y, z = p.z;
+			auto result =
+				a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z +
+				a11 * y * y + 2 * a12 * y * z + a22 * z * z +
+				2 * (b0 * x + b1 * y + b2 * z) + c;
+			return result < 0 ? 0 : result;
+		}
+	};
+
+	struct collapse {
+		u32 from, to;
+		redox::f64 cost;
+	};
+
+	redox::u64 edge_key(u32 a, u32 b) {
+		return a < b ? (static_cast<redox::u64>(a) << 32) | b : (static_cast<redox::u64>(b) << 32) | a;
+	}
+
+	f32 length(const float3& v) {
+		return std::sqrt(v.dot(v));
+	}
+
+	redox::graphics::Meshlet meshlet_bounds(const uint32_t* indices, std::size_t begin, std::size_t end,
+		const MeshVertex* vertices) {
+
+		redox::graphics::Meshlet meshlet{};
+		meshlet.indexOffset = static_cast<u32>(begin);
+		meshlet.indexCount = static_cast<u32>(end - begin);
+
+		auto min = position(vertices[indices[begin]]), max = min;
+		for (auto i = begin; i < end; ++i) {
+			auto p = position(vertices[indices[i]]);
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+
+		auto center = (min + max) * 0.5f;
+		f32 radius = 0.0f;
+		for (auto i = begin; i < end; ++i) {
+			radius = std::max(radius, length(position(vertices[indices[i]]) - center));
+		}
+
+		redox::Buffer<float3> normals;
+		normals.reserve((end - begin) / 3);
+		float3 axis{ 0.0f, 0.0f, 0.0f };
+
+		for (auto i = begin; i < end; i += 3) {
+			auto p0 = position(vertices[indices[i]]);
+			auto n = (position(vertices[indices[i + 1]]) - p0).cross(position(vertices[indices[i + 2]]) - p0);
+			auto l = length(n);
+			if (l > 0.0f) {
+				normals.push_back(n * (1.0f / l));
+				axis = axis + normals.back();
+			}
+		}
+
+		//Spread out or degenerate normals leave the cone open
+		f32 cutoff = 1.0f;
+		auto axisLength = length(axis);
+		if (axisLength > 0.0f) {
+			axis = axis * (1.0f / axisLength);
+
+			f32 minDot = 1.0f;
+			for (const auto& n : normals) {
+				minDot = std::min(minDot, n.dot(axis));
+			}
+
+			if (minDot > 0.1f) {
+				cutoff = std::sqrt(1.0f - minDot * minDot);
+			}
+		}
+
+		meshlet.center[0] = center.x;
+		meshlet.center[1] = center.y;
+		meshlet.center[2] = center.z;
+		meshlet.radius = radius;
+		meshlet.coneAxis[0] = axis.x;
+		meshlet.coneAxis[1] = axis.y;
+		meshlet.coneAxis[2] = axis.z;
+		meshlet.coneCutoff = cutoff;
+		return meshlet;
+	}
+}
+
+redox::f32 redox::mesh_optimizer::acmr(const uint32_t* indices, std::size_t indexCount,
+	std::size_t vertexCount, u32 cacheSize) {
+
+	if (indexCount < 3) {
+		return 0.0f;
+	}
+
+	//FIFO: a vertex is cached if it was inserted less than cacheSize misses ago
+	Buffer<u32> insertedAt(vertexCount, INVALID_INDEX);
+	u32 misses = 0;
+
+	for (std::size_t i = 0; i < indexCount; ++i) {
+		auto& stamp = insertedAt[indices[i]];
+		if (stamp == INVALID_INDEX || misses - stamp >= cacheSize) {
+			stamp = misses++;
+		}
+	}
+
+	return misses / static_cast<f32>(indexCount / 3);
+}
+
+std::size_t redox::mesh_optimizer::deduplicate_vertices(graphics::MeshVertex* vertices,
+	std::size_t vertexCount, uint32_t* indices, std::size_t indexCount) {
+
+	std::size_t tableSize = 16;
+	while (tableSize < vertexCount * 2) {
+		tableSize *= 2;
+	}
+
+	//Open addressing, slots hold the compacted index of the first occurrence
+	Buffer<u32> table(tableSize, INVALID_INDEX);
+	Buffer<u32> remap(vertexCount);
+	const auto mask = tableSize - 1;
+	u32 uniqueCount = 0;
+
+	for (std::size_t i = 0; i < vertexCount; ++i) {
+		auto slot = static_cast<std::size_t>(hash::xxh64(&vertices[i], sizeof(MeshVertex))) & mask;
+
+		for (;; slot = (slot + 1) & mask) {
+			auto candidate = table[slot];
+
+			if (candidate == INVALID_INDEX) {
+				table[slot] = uniqueCount;
+				remap[i] = uniqueCount;
+
+				//Compacted positions never overtake the read position
+				if (uniqueCount != i) {
+					vertices[uniqueCount] = vertices[i];
+				}
+
+				uniqueCount++;
+				break;
+			}
+
+			if (std::memcmp(&vertices[candidate], &vertices[i], sizeof(MeshVertex)) == 0) {
+				remap[i] = candidate;
+				break;
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < indexCount; ++i) {
+		indices[i] = remap[indices[i]];
+	}
+
+	return uniqueCount;
+}
+
+void redox::mesh_optimizer::optimize_vertex_cache(uint32_t* indices, std::size_t indexCount, std::size_t vertexCount) {
+	const std::size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	static const forsyth_scores scores;
+
+	//Triangles per vertex, the first remaining[v] entries of each list are still to be emitted
+	Buffer<u32> remaining(vertexCount, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+		remaining[indices[i]]++;
+	}
+
+	Buffer<u32> adjacencyOffset(vertexCount + 1, 0);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+	}
+
+	Buffer<u32> adjacency(triangleCount * 3);
+	{
+		Buffer<u32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (std::size_t i = 0; i < triangleCount * 3; ++i) {
+			adjacency[fill[indices[i]]++] = static_cast<u32>(i / 3);
+		}
+	}
+
+	Buffer<i32> cachePosition(vertexCount, -1);
+	Buffer<f32> vertexScore(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		vertexScore[v] = scores.score(-1, remaining[v]);
+	}
+
+	Buffer<f32> triangleScore(triangleCount);
+	Buffer<u8> emitted(triangleCount, 0);
+	u32 bestTriangle = 0;
+
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+		const auto* tri = indices + t * 3;
+		triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+		if (triangleScore[t] > triangleScore[bestTriangle]) {
+			bestTriangle = static_cast<u32>(t);
+		}
+	}
+
+	Buffer<uint32_t> output(triangleCount * 3);
+	u32 cache[FORSYTH_CACHE_SIZE + 3];
+	u32 cacheCount = 0;
+	std::size_t cursor = 0;
+
+	for (std::size_t out = 0; out < triangleCount; ++out) {
+		//Nothing in the cache is connected to unemitted triangles, continue in input order
+		if (bestTriangle == INVALID_INDEX) {
+			while (emitted[cursor]) {
+				cursor++;
+			}
+			bestTriangle = static_cast<u32>(cursor);
+		}
+
+		const auto* tri = indices + bestTriangle * 3;
+		emitted[bestTriangle] = 1;
+		output[out * 3 + 0] = tri[0];
+		output[out * 3 + 1] = tri[1];
+		output[out * 3 + 2] = tri[2];
+
+		u32 newCache[FORSYTH_CACHE_SIZE + 3];
+		u32 newCount = 0;
+
+		for (u32 k = 0; k < 3; ++k) {
+			auto v = tri[k];
+
+			//Swap the triangle out of the active part of the list
+			auto list = adjacency.data() + adjacencyOffset[v];
+			auto last = list + remaining[v] - 1;
+			auto it = std::find(list, last + 1, bestTriangle);
+			std::swap(*it, *last);
+			remaining[v]--;
+
+			if (std::find(newCache, newCache + newCount, v) == newCache + newCount) {
+				newCache[newCount++] = v;
+			}
+		}
+
+		const auto triangleEnd = newCache + newCount;
+		for (u32 i = 0; i < cacheCount; ++i) {
+			if (std::find(newCache, triangleEnd, cache[i]) == triangleEnd) {
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		//Vertices pushed past the end left the cache, their score drops as well
+		for (u32 i = 0; i < newCount; ++i) {
+			auto v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<i32>(i) : -1;
+			vertexScore[v] = scores.score(cachePosition[v], remaining[v]);
+		}
+
+		bestTriangle = INVALID_INDEX;
+		f32 bestScore = -1.0f;
+
+		for (u32 i = 0; i < newCount; ++i) {
+			auto v = newCache[i];
+			auto list = adjacency.data() + adjacencyOffset[v];
+
+			for (u32 j = 0; j < remaining[v]; ++j) {
+				auto t = list[j];
+				const auto* other = indices + t * 3;
+				triangleScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void redox::mesh_optimizer::optimize_overdraw(uint32_t* indices, std::size_t indexCount,
+	const graphics::MeshVertex* vertices, std::size_t vertexCount, f32 threshold) {
+
+	const std::size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2) {
+		return;
+	}
+
+	//Split wherever the cache simulation has to start from scratch, so reordering
+	//whole clusters leaves the vertex reuse inside each of them intact
+	Buffer<std::size_t> clusterStart;
+	Buffer<u32> insertedAt(vertexCount, INVALID_INDEX);
+	u32 misses = 0;
+
+	for (std::size_t t = 0; t < triangleCount; ++t) {
+		u32 triangleMisses = 0;
+		for (u32 k = 0; k < 3; ++k) {
+			auto& stamp = insertedAt[indices[t * 3 + k]];
+			if (stamp == INVALID_INDEX || misses - stamp >= DEFAULT_CACHE_SIZE) {
+				stamp = misses++;
+				triangleMisses++;
+			}
+		}
+
+		if (t == 0 || triangleMisses == 3) {
+			clusterStart.push_back(t);
+		}
+	}
+
+	if (clusterStart.size() < 2) {
+		return;
+	}
+
+	clusterStart.push_back(triangleCount);
+
+	struct cluster {
+		std::size_t begin, end;
+		f32 sortKey;
+	};
+
+	Buffer<cluster> clusters;
+	Buffer<float3> centroids, normals;
+	float3 meshCentroid{};
+	f32 meshArea = 0.0f;
+
+	for (std::size_t c = 0; c + 1 < clusterStart.size(); ++c) {
+		float3 centroid{}, normal{};
+		f32 area = 0.0f;
+
+		for (auto t = clusterStart[c]; t < clusterStart[c + 1]; ++t) {
+			auto p0 = position(vertices[indices[t * 3 + 0]]);
+			auto p1 = position(vertices[indices[t * 3 + 1]]);
+			auto p2 = position(vertices[indices[t * 3 + 2]]);
+
+			auto n = (p1 - p0).cross(p2 - p0);
+			auto a = std::sqrt(n.dot(n));
+
+			centroid = centroid + (p0 + p1 + p2) * (a / 3.0f);
+			normal = normal + n;
+			area += a;
+		}
+
+		meshCentroid = meshCentroid + centroid;
+		meshArea += area;
+
+		clusters.push_back({ clusterStart[c], clusterStart[c + 1], 0.0f });
+		centroids.push_back(area > 0.0f ? centroid * (1.0f / area) : centroid);
+		normals.push_back(normal);
+	}
+
+	if (meshArea > 0.0f) {
+		meshCentroid = meshCentroid * (1.0f / meshArea);
+	}
+
+	//Clusters facing away from the mesh center occlude the ones behind them
+	for (std::size_t c = 0; c < clusters.size(); ++c) {
+		auto length = std::sqrt(normals[c].dot(normals[c]));
+		clusters[c].sortKey = length > 0.0f ?
+			(centroids[c] - meshCentroid).dot(normals[c]) / length : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const auto& a, const auto& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	Buffer<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	for (const auto& c : clusters) {
+		output.insert(output.end(), indices + c.begin * 3, indices + c.end * 3);
+	}
+
+	if (acmr(output.data(), output.size(), vertexCount) <= acmr(indices, triangleCount * 3, vertexCount) * threshold) {
+		std::copy(output.begin(), output.end(), indices);
+	}
+}
+
+redox::f32 redox::mesh_optimizer::extent(const graphics::MeshVertex* vertices, std::size_t vertexCount) {
+	if (vertexCount == 0) {
+		return 0.0f;
+	}
+
+	auto min = position(vertices[0]), max = min;
+	for (std::size_t v = 1; v < vertexCount; ++v) {
+		auto p = position(vertices[v]);
+		min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+		max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+	}
+
+	return std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+}
+
+std::size_t redox::mesh_optimizer::simplify(uint32_t* destination, const uint32_t* indices, std::size_t indexCount,
+	const graphics::MeshVertex* vertices, std::size_t vertexCount,
+	std::size_t targetIndexCount, f32 targetError, f32* resultError) {
+
+	indexCount -= indexCount % 3;
+	std::copy(indices, indices + indexCount, destination);
+
+	if (resultError) {
+		*resultError = 0.0f;
+	}
+
+	//Work in a unit sized space so errors don't depend on the mesh scale
+	auto scale = extent(vertices, vertexCount);
+	scale = scale > 0.0f ? 1.0f / scale : 1.0f;
+
+	Buffer<float3> positions(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		positions[v] = position(vertices[v]) * scale;
+	}
+
+	//Vertices sharing a position differ in their attributes, those seams must not move
+	Hashmap<u64, u32> firstAtPosition;
+	Buffer<u32> canonical(vertexCount);
+	Buffer<u8> locked(vertexCount, 0);
+
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		auto key = hash::xxh64(&positions[v], sizeof(float3));
+		auto [it, inserted] = firstAtPosition.emplace(key, static_cast<u32>(v));
+		canonical[v] = it->second;
+		if (!inserted) {
+			locked[v] = 1;
+			locked[it->second] = 1;
+		}
+	}
+
+	//Open borders and non-manifold edges keep their vertices as well
+	Hashmap<u64, u32> edgeUse;
+	for (std::size_t i = 0; i < indexCount; i += 3) {
+		for (u32 k = 0; k < 3; ++k) {
+			edgeUse[edge_key(canonical[indices[i + k]], canonical[indices[i + (k + 1) % 3]])]++;
+		}
+	}
+
+	for (std::size_t i = 0; i < indexCount; i += 3) {
+		for (u32 k = 0; k < 3; ++k) {
+			auto a = indices[i + k], b = indices[i + (k + 1) % 3];
+			if (edgeUse[edge_key(canonical[a], canonical[b])] != 2) {
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+
+	Buffer<quadric> quadrics(vertexCount, quadric{});
+	for (std::size_t i = 0; i < indexCount; i += 3) {
+		auto& p0 = positions[destination[i]];
+		auto n = (positions[destination[i + 1]] - p0).cross(positions[destination[i + 2]] - p0);
+		auto length = std::sqrt(n.dot(n));
+		if (length <= 0.0f) {
+			continue;
+		}
+
+		n = n * (1.0f / length);
+		auto plane = quadric::from_plane(n.x, n.y, n.z, -n.dot(p0));
+		for (u32 k = 0; k < 3; ++k) {
+			quadrics[destination[i + k]] += plane;
+		}
+	}
+
+	const f64 maxCost = static_cast<f64>(targetError) * targetError;
+	f64 worstCost = 0.0;
+	targetIndexCount -= targetIndexCount % 3;
+
+	Buffer<u32> adjacencyOffset(vertexCount + 1);
+	Buffer<u32> adjacency;
+	Buffer<collapse> candidates;
+	Buffer<u32> remap(vertexCount);
+	Buffer<u8> touched(vertexCount);
+
+	//Passes of independent collapses, cheapest first, until nothing applies anymore
+	while (indexCount > targetIndexCount) {
+		const auto triangleCount = indexCount / 3;
+
+		std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+		for (std::size_t i = 0; i < indexCount; ++i) {
+			adjacencyOffset[destination[i] + 1]++;
+		}
+		for (std::size_t v = 0; v < vertexCount; ++v) {
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		}
+
+		adjacency.resize(indexCount);
+		{
+			Buffer<u32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+			for (std::size_t i = 0; i < indexCount; ++i) {
+				adjacency[fill[destination[i]]++] = static_cast<u32>(i / 3);
+			}
+		}
+
+		candidates.clear();
+		for (std::size_t i = 0; i < indexCount; i += 3) {
+			for (u32 k = 0; k < 3; ++k) {
+				auto a = destination[i + k], b = destination[i + (k + 1) % 3];
+				if (!locked[a]) {
+					candidates.push_back({ a, b, quadrics[a].error(positions[b]) });
+				}
+				if (!locked[b]) {
+					candidates.push_back({ b, a, quadrics[b].error(positions[a]) });
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+			return a.cost < b.cost;
+		});
+
+		for (std::size_t v = 0; v < vertexCount; ++v) {
+			remap[v] = static_cast<u32>(v);
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+
+		std::size_t removed = 0;
+		std::size_t collapses = 0;
+
+		for (const auto& c : candidates) {
+			if (c.cost > maxCost || (triangleCount - removed) * 3 <= targetIndexCount) {
+				break;
+			}
+
+			if (touched[c.from] || touched[c.to]) {
+				continue;
+			}
+
+			//Reject collapses that would flip any of the remaining triangles around the vertex
+			bool flips = false;
+			std::size_t degenerate = 0;
+
+			for (auto j = adjacencyOffset[c.from]; j < adjacencyOffset[c.from + 1] && !flips; ++j) {
+				const auto* tri = destination + adjacency[j] * 3;
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					degenerate++;
+					continue;
+				}
+
+				auto& a = positions[tri[0]];
+				auto& b = positions[tri[1]];
+				auto& d = positions[tri[2]];
+				auto before = (b - a).cross(d - a);
+
+				auto& na = tri[0] == c.from ? positions[c.to] : a;
+				auto& nb = tri[1] == c.from ? positions[c.to] : b;
+				auto& nd = tri[2] == c.from ? positions[c.to] : d;
+				auto after = (nb - na).cross(nd - na);
+
+				flips = before.dot(after) <= 0.0f;
+			}
+
+			if (flips) {
+				continue;
+			}
+
+			//Neighbours stay put this pass so the flip test above remains valid
+			for (auto j = adjacencyOffset[c.from]; j < adjacencyOffset[c.from + 1]; ++j) {
+				const auto* tri = destination + adjacency[j] * 3;
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			worstCost = std::max(worstCost, c.cost);
+			removed += degenerate;
+			collapses++;
+		}
+
+		if (collapses == 0) {
+			break;
+		}
+
+		std::size_t written = 0;
+		for (std::size_t i = 0; i < indexCount; i += 3) {
+			auto a = remap[destination[i]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+			if (a != b && b != c && a != c) {
+				destination[written++] = a;
+				destination[written++] = b;
+				destination[written++] = c;
+			}
+		}
+
+		indexCount = written;
+	}
+
+	if (resultError) {
+		*resultError = static_cast<f32>(std::sqrt(worstCost));
+	}
+
+	return indexCount;
+}
+
+redox::Buffer<redox::graphics::Meshlet> redox::mesh_optimizer::build_meshlets(const uint32_t* indices, std::size_t indexCount,
+	const graphics::MeshVertex* vertices, std::size_t vertexCount, u32 maxVertices, u32 maxTriangles) {
+
+	Buffer<graphics::Meshlet> meshlets;
+	indexCount -= indexCount % 3;
+
+	//Marks the vertices by the meshlet that currently references them
+	Buffer<u32> usedBy(vertexCount, INVALID_INDEX);
+	std::size_t begin = 0;
+	u32 vertexCountInMeshlet = 0;
+
+	for (std::size_t i = 0; i < indexCount; i += 3) {
+		auto id = static_cast<u32>(meshlets.size());
+		auto a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+		u32 added = (usedBy[a] != id ? 1 : 0) +
+			(usedBy[b] != id && b != a ? 1 : 0) +
+			(usedBy[c] != id && c != a && c != b ? 1 : 0);
+
+		if (vertexCountInMeshlet + added > maxVertices || (i - begin) / 3 >= maxTriangles) {
+			meshlets.push_back(meshlet_bounds(indices, begin, i, vertices));
+			begin = i;
+			vertexCountInMeshlet = 0;
+			id++;
+		}
+
+		for (auto v : { a, b, c }) {
+			if (usedBy[v] != id) {
+				usedBy[v] = id;
+				vertexCountInMeshlet++;
+			}
+		}
+	}
+
+	if (indexCount > begin) {
+		meshlets.push_back(meshlet_bounds(indices, begin, indexCount, vertices));
+	}
+
+	return meshlets;
+}
+
+std::size_t redox::mesh_optimizer::optimize_vertex_fetch(graphics::MeshVertex* vertices,
+	std::size_t vertexCount, uint32_t* indices, std::size_t indexCount) {
+
+	Buffer<u32> remap(vertexCount, INVALID_INDEX);
+	u32 next = 0;
+
+	for (std::size_t i = 0; i < indexCount; ++i) {
+		auto& target = remap[indices[i]];
+		if (target == INVALID_INDEX) {
+			target = next++;
+		}
+		indices[i] = target;
+	}
+
+	Buffer<MeshVertex> source(vertices, vertices + vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v) {
+		if (remap[v] != INVALID_INDEX) {
+			vertices[remap[v]] = source[v];
+		}
+	}
+
+	return next;
+}
@@ -0,0 +1,71 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+#include "graphics/vulkan/resources/mesh.h"
+
+namespace redox::mesh_optimizer {
+	//Size of the FIFO cache used for ACMR reporting, roughly what current GPUs reuse
+	constexpr u32 DEFAULT_CACHE_SIZE = 16;
+
+	//Average cache miss ratio, vertices transformed per triangle (0.5 ideal, 3 worst)
+	f32 acmr(const uint32_t* indices, std::size_t indexCount,
+		std::size_t vertexCount, u32 cacheSize = DEFAULT_CACHE_SIZE);
+
+	//Merges identical vertices in place and remaps the indices, returns the new vertex count
+	std::size_t deduplicate_vertices(graphics::MeshVertex* vertices, std::size_t vertexCount,
+		uint32_t* indices, std::size_t indexCount);
+
+	//Reorders triangles for the post-transform cache (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+	void optimize_vertex_cache(uint32_t* indices, std::size_t indexCount, std::size_t vertexCount);
+
+	//Sorts cache friendly clusters of triangles so outward facing ones are drawn first,
+	//the new order is kept only if its ACMR stays within threshold times the current one
+	void optimize_overdraw(uint32_t* indices, std::size_t indexCount,
+		const graphics::MeshVertex* vertices, std::size_t vertexCount, f32 threshold = 1.05f);
+
+	//Largest dimension of the bounding box, simplification errors are relative to it
+	f32 extent(const graphics::MeshVertex* vertices, std::size_t vertexCount);
+
+	//Quadric error metric edge collapse into destination (indexCount capacity). Vertices are only ever
+	//collapsed onto existing ones so the result keeps using the same vertex buffer, borders and
+	//attribute seams stay locked. Stops at targetIndexCount or before a collapse would exceed
+	//targetError, returns the index count and the relative error in resultError
+	std::size_t simplify(uint32_t* destination, const uint32_t* indices, std::size_t indexCount,
+		const graphics::MeshVertex* vertices, std::size_t vertexCount,
+		std::size_t targetIndexCount, f32 targetError, f32* resultError = nullptr);
+
+	//Splits the triangle list into runs of at most maxVertices unique vertices and maxTriangles
+	//triangles without reordering it, so every meshlet stays a plain index range relative to
+	//indices. Bounding spheres and normal cones are in object space
+	Buffer<graphics::Meshlet> build_meshlets(const uint32_t* indices, std::size_t indexCount,
+		const graphics::MeshVertex* vertices, std::size_t vertexCount,
+		u32 maxVertices = graphics::MESHLET_MAX_VERTICES, u32 maxTriangles = graphics::MESHLET_MAX_TRIANGLES);
+
+	//Reorders vertices by first use and drops unreferenced ones, returns the new vertex count
+	std::size_t optimize_vertex_fetch(graphics::MeshVertex* vertices, std::size_t vertexCount,
+		uint32_t* indices, std::size_t indexCount);
+}
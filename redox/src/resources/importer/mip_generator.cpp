@@ -0,0 +1,139 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "mip_generator.h"
+#include "math/simd.h"
+
+#include <algorithm> //std::max, std::min
+#include <cmath> //std::sqrt, std::lround
+
+namespace {
+	using redox::byte;
+	using redox::f32;
+	using redox::u32;
+
+	const byte* texel(const byte* pixels, u32 width, u32 x, u32 y) {
+		return pixels + (static_cast<std::size_t>(y) * width + x) * 4;
+	}
+
+	void box_texel(const byte* a, const byte* b, const byte* c, const byte* d, byte* output) {
+		for (u32 ch = 0; ch < 4; ++ch) {
+			output[ch] = static_cast<byte>((a[ch] + b[ch] + c[ch] + d[ch] + 2) >> 2);
+		}
+	}
+
+	void normal_texel(const byte* a, const byte* b, const byte* c, const byte* d, byte* output) {
+		f32 n[3]{};
+		for (const byte* source : { a, b, c, d }) {
+			for (u32 ch = 0; ch < 3; ++ch) {
+				n[ch] += source[ch] / 127.5f - 1.0f;
+			}
+		}
+
+		f32 length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for (u32 ch = 0; ch < 3; ++ch) {
+			f32 unit = length > 0.0f ? n[ch] / length : (ch == 2 ? 1.0f : 0.0f);
+			output[ch] = static_cast<byte>(std::lround((unit + 1.0f) * 127.5f));
+		}
+		output[3] = static_cast<byte>((a[3] + b[3] + c[3] + d[3] + 2) >> 2);
+	}
+
+	//Two output texels from a 4x2 source footprint, widened to 16 bit so the rounding matches box_texel
+	void box_texels_sse(const byte* row0, const byte* row1, byte* output) {
+		auto zero = _mm_setzero_si128();
+		auto top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+		auto bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+
+		//Vertical sums, texels 0 and 1 in lo, 2 and 3 in hi
+		auto lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		auto hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+		//Horizontal pairs end up in the lower halves
+		lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+		hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+
+		auto sum = _mm_unpacklo_epi64(lo, hi);
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packus_epi16(sum, sum));
+	}
+}
+
+redox::u32 redox::mip_generator::level_count(u32 width, u32 height) {
+	u32 levels = 1;
+	for (auto size = std::max(width, height); size > 1; size >>= 1) {
+		++levels;
+	}
+	return levels;
+}
+
+redox::mip_generator::MipLevel redox::mip_generator::downsample(const byte* pixels, u32 width, u32 height, bool normalMap) {
+	MipLevel level;
+	level.width = std::max(width / 2, 1u);
+	level.height = std::max(height / 2, 1u);
+	level.pixels.resize(static_cast<std::size_t>(level.width) * level.height * 4);
+
+	for (u32 y = 0; y < level.height; ++y) {
+		auto y0 = std::min(y * 2, height - 1);
+		auto y1 = std::min(y * 2 + 1, height - 1);
+		auto output = level.pixels.data() + static_cast<std::size_t>(y) * level.width * 4;
+		u32 x = 0;
+
+		//Pairs of texels whose footprint lies fully inside the image
+		if (!normalMap) {
+			for (; x + 1 < level.width && x * 2 + 3 < width; x += 2) {
+				box_texels_sse(texel(pixels, width, x * 2, y0), texel(pixels, width, x * 2, y1), output + x * 4);
+			}
+		}
+
+		for (; x < level.width; ++x) {
+			auto x0 = std::min(x * 2, width - 1);
+			auto x1 = std::min(x * 2 + 1, width - 1);
+
+			auto filter = normalMap ? normal_texel : box_texel;
+			filter(texel(pixels, width, x0, y0), texel(pixels, width, x1, y0),
+				texel(pixels, width, x0, y1), texel(pixels, width, x1, y1), output + x * 4);
+		}
+	}
+
+	return level;
+}
+
+redox::Buffer<redox::mip_generator::MipLevel> redox::mip_generator::generate(const byte* pixels,
+	u32 width, u32 height, bool normalMap) {
+
+	Buffer<MipLevel> levels;
+	levels.reserve(level_count(width, height) - 1);
+
+	while (width > 1 || height > 1) {
+		levels.push_back(downsample(pixels, width, height, normalMap));
+
+		const auto& level = levels.back();
+		pixels = level.pixels.data();
+		width = level.width;
+		height = level.height;
+	}
+
+	return levels;
+}
@@ -0,0 +1,45 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+
+namespace redox::mip_generator {
+	struct MipLevel {
+		u32 width;
+		u32 height;
+		Buffer<byte> pixels; //RGBA8, tightly packed
+	};
+
+	//Levels of a full chain down to 1x1, including the base level
+	u32 level_count(u32 width, u32 height);
+
+	//Halves a RGBA8 image with a 2x2 box filter, odd edges repeat their last texel. Normal maps
+	//are averaged as unit vectors and renormalized instead, so distant surfaces don't flatten out
+	MipLevel downsample(const byte* pixels, u32 width, u32 height, bool normalMap = false);
+
+	//Every level below the base one, each filtered from the previous
+	Buffer<MipLevel> generate(const byte* pixels, u32 width, u32 height, bool normalMap = false);
+}
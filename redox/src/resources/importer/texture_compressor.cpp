@@ -0,0 +1,672 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "texture_compressor.h"
+#include "math/simd.h"
+
+#include <algorithm> //std::min, std::max, std::swap
+#include <cmath> //std::lround, std::sqrt, std::abs
+#include <cstring> //std::memcpy, std::memset
+#include <limits> //std::numeric_limits
+
+namespace {
+	using redox::byte;
+	using redox::f32;
+	using redox::u32;
+	using redox::u64;
+	using redox::texture_compressor::BlockFormat;
+	namespace simd = redox::simd;
+
+	constexpr u32 BLOCK_TEXELS = 16;
+	constexpr u32 REFINE_ITERATIONS = 2;
+
+	//Interpolation weight of the second endpoint per index
+	constexpr f32 BC1_INTERPOLATION[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	constexpr u32 BC7_INTERPOLATION[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	constexpr f32 RGB_WEIGHTS[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+	constexpr f32 RGBA_WEIGHTS[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	//Texels as structure of arrays so four of them fit one register per channel
+	struct alignas(16) texel_block {
+		f32 channels[4][BLOCK_TEXELS];
+
+		explicit texel_block(const byte* rgba) {
+			for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+				for (u32 c = 0; c < 4; ++c) {
+					channels[c][i] = rgba[i * 4 + c];
+				}
+			}
+		}
+	};
+
+	struct palette {
+		f32 entries[16][4];
+		u32 size;
+	};
+
+	f32 clamp_unorm8(f32 value) {
+		return std::min(std::max(value, 0.0f), 255.0f);
+	}
+
+	//Closest palette entry per texel over the channels with a non zero weight,
+	//returns the weighted squared error of the whole block
+	f32 fit_indices(const texel_block& block, const palette& pal, const f32 weights[4], byte* indices) {
+		f32 total = 0.0f;
+
+		for (u32 group = 0; group < BLOCK_TEXELS; group += 4) {
+			simd::f32x4 texels[4];
+			for (u32 c = 0; c < 4; ++c) {
+				texels[c] = simd::load_unaligned(&block.channels[c][group]);
+			}
+
+			auto best = simd::set_all(std::numeric_limits<f32>::max());
+			auto bestIndex = simd::set_zero();
+
+			for (u32 e = 0; e < pal.size; ++e) {
+				auto error = simd::set_zero();
+				for (u32 c = 0; c < 4; ++c) {
+					if (weights[c] == 0.0f) {
+						continue;
+					}
+
+					auto delta = simd::sub(texels[c], simd::set_all(pal.entries[e][c]));
+					error = simd::add(error, simd::mul(simd::mul(delta, delta), simd::set_all(weights[c])));
+				}
+
+				auto closer = simd::less(error, best);
+				best = simd::min(error, best);
+				bestIndex = simd::select(bestIndex, simd::set_all(static_cast<f32>(e)), closer);
+			}
+
+			f32 errors[4], chosen[4];
+			simd::store_unaligned(errors, best);
+			simd::store_unaligned(chosen, bestIndex);
+
+			for (u32 i = 0; i < 4; ++i) {
+				indices[group + i] = static_cast<byte>(chosen[i]);
+				total += errors[i];
+			}
+		}
+
+		return total;
+	}
+
+	//Mean and dominant direction of the texels, power iteration on the covariance
+	//starting from the bounding box diagonal. The axis is zero for flat blocks
+	void principal_axis(const texel_block& block, const f32 weights[4], f32 mean[4], f32 axis[4]) {
+		f32 lo[4], hi[4];
+		for (u32 c = 0; c < 4; ++c) {
+			mean[c] = 0.0f;
+			lo[c] = 255.0f;
+			hi[c] = 0.0f;
+
+			if (weights[c] == 0.0f) {
+				continue;
+			}
+
+			for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+				mean[c] += block.channels[c][i];
+				lo[c] = std::min(lo[c], block.channels[c][i]);
+				hi[c] = std::max(hi[c], block.channels[c][i]);
+			}
+			mean[c] /= BLOCK_TEXELS;
+		}
+
+		f32 covariance[4][4]{};
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			for (u32 a = 0; a < 4; ++a) {
+				for (u32 b = 0; b < 4; ++b) {
+					if (weights[a] != 0.0f && weights[b] != 0.0f) {
+						covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+					}
+				}
+			}
+		}
+
+		for (u32 c = 0; c < 4; ++c) {
+			axis[c] = weights[c] != 0.0f ? hi[c] - lo[c] : 0.0f;
+		}
+
+		for (u32 iteration = 0; iteration < 8; ++iteration) {
+			f32 next[4]{};
+			f32 largest = 0.0f;
+
+			for (u32 a = 0; a < 4; ++a) {
+				for (u32 b = 0; b < 4; ++b) {
+					next[a] += covariance[a][b] * axis[b];
+				}
+				largest = std::max(largest, std::abs(next[a]));
+			}
+
+			if (largest == 0.0f) {
+				break;
+			}
+
+			for (u32 c = 0; c < 4; ++c) {
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		f32 length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+		for (u32 c = 0; c < 4; ++c) {
+			axis[c] = length > 0.0f ? axis[c] / length : 0.0f;
+		}
+	}
+
+	//Endpoints at the extremes of the texels projected onto the principal axis, pulled
+	//in by insetShift since the outliers cost the interior texels more than they gain
+	void axis_endpoints(const texel_block& block, const f32 weights[4], u32 insetShift, f32 e0[4], f32 e1[4]) {
+		f32 mean[4], axis[4];
+		principal_axis(block, weights, mean, axis);
+
+		f32 lo = std::numeric_limits<f32>::max();
+		f32 hi = -lo;
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			f32 t = 0.0f;
+			for (u32 c = 0; c < 4; ++c) {
+				t += (block.channels[c][i] - mean[c]) * axis[c];
+			}
+			lo = std::min(lo, t);
+			hi = std::max(hi, t);
+		}
+
+		f32 inset = (hi - lo) / static_cast<f32>(1u << insetShift);
+		for (u32 c = 0; c < 4; ++c) {
+			e0[c] = clamp_unorm8(mean[c] + axis[c] * (hi - inset));
+			e1[c] = clamp_unorm8(mean[c] + axis[c] * (lo + inset));
+		}
+	}
+
+	//Least squares endpoints for fixed per texel weights of the second endpoint
+	bool solve_endpoints(const texel_block& block, const f32 t[BLOCK_TEXELS], f32 e0[4], f32 e1[4]) {
+		f32 aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		f32 ax[4]{}, bx[4]{};
+
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			f32 a = 1.0f - t[i];
+			f32 b = t[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (u32 c = 0; c < 4; ++c) {
+				ax[c] += a * block.channels[c][i];
+				bx[c] += b * block.channels[c][i];
+			}
+		}
+
+		f32 det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f) {
+			return false;
+		}
+
+		for (u32 c = 0; c < 4; ++c) {
+			e0[c] = clamp_unorm8((bb * ax[c] - ab * bx[c]) / det);
+			e1[c] = clamp_unorm8((aa * bx[c] - ab * ax[c]) / det);
+		}
+		return true;
+	}
+
+	//Little endian bit stream as used by the BC7 block layout
+	struct bit_writer {
+		byte* data;
+		u32 position{ 0 };
+
+		void write(u32 value, u32 bits) {
+			for (u32 i = 0; i < bits; ++i, ++position) {
+				if ((value >> i) & 0x1) {
+					data[position >> 3] |= static_cast<byte>(0x1 << (position & 0x7));
+				}
+			}
+		}
+	};
+
+	struct bit_reader {
+		const byte* data;
+		u32 position{ 0 };
+
+		u32 read(u32 bits) {
+			u32 value = 0;
+			for (u32 i = 0; i < bits; ++i, ++position) {
+				value |= ((data[position >> 3] >> (position & 0x7)) & 0x1u) << i;
+			}
+			return value;
+		}
+	};
+
+	u32 to_565(const f32 color[4]) {
+		auto r = static_cast<u32>(std::lround(color[0] * 31.0f / 255.0f));
+		auto g = static_cast<u32>(std::lround(color[1] * 63.0f / 255.0f));
+		auto b = static_cast<u32>(std::lround(color[2] * 31.0f / 255.0f));
+		return (r << 11) | (g << 5) | b;
+	}
+
+	void from_565(u32 packed, u32 color[4]) {
+		u32 r = (packed >> 11) & 0x1F;
+		u32 g = (packed >> 5) & 0x3F;
+		u32 b = packed & 0x1F;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+		color[3] = 255;
+	}
+
+	//Four color mode needs c0 > c1, equal endpoints only ever use index 0 which decodes the same in both modes
+	f32 fit_bc1(const texel_block& block, u32& c0, u32& c1, byte* indices) {
+		if (c0 < c1) {
+			std::swap(c0, c1);
+		}
+
+		u32 first[4], second[4];
+		from_565(c0, first);
+		from_565(c1, second);
+
+		palette pal{ {}, 4 };
+		for (u32 e = 0; e < 4; ++e) {
+			for (u32 c = 0; c < 4; ++c) {
+				pal.entries[e][c] = (1.0f - BC1_INTERPOLATION[e]) * first[c] + BC1_INTERPOLATION[e] * second[c];
+			}
+		}
+
+		return fit_indices(block, pal, RGB_WEIGHTS, indices);
+	}
+
+	void encode_bc1(const texel_block& block, byte* output) {
+		f32 e0[4], e1[4];
+		axis_endpoints(block, RGB_WEIGHTS, 4, e0, e1);
+
+		u32 c0 = to_565(e0), c1 = to_565(e1);
+		byte indices[BLOCK_TEXELS];
+		f32 error = fit_bc1(block, c0, c1, indices);
+
+		for (u32 iteration = 0; iteration < REFINE_ITERATIONS && error > 0.0f; ++iteration) {
+			f32 t[BLOCK_TEXELS];
+			for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+				t[i] = BC1_INTERPOLATION[indices[i]];
+			}
+
+			if (!solve_endpoints(block, t, e0, e1)) {
+				break;
+			}
+
+			u32 r0 = to_565(e0), r1 = to_565(e1);
+			byte refined[BLOCK_TEXELS];
+			f32 refinedError = fit_bc1(block, r0, r1, refined);
+
+			if (refinedError >= error) {
+				break;
+			}
+
+			c0 = r0;
+			c1 = r1;
+			error = refinedError;
+			std::memcpy(indices, refined, sizeof(indices));
+		}
+
+		u32 bits = 0;
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			bits |= static_cast<u32>(indices[i]) << (i * 2);
+		}
+
+		output[0] = static_cast<byte>(c0);
+		output[1] = static_cast<byte>(c0 >> 8);
+		output[2] = static_cast<byte>(c1);
+		output[3] = static_cast<byte>(c1 >> 8);
+		std::memcpy(output + 4, &bits, sizeof(bits));
+	}
+
+	void decode_bc1(const byte* block, byte* rgba, bool forceFourColor) {
+		u32 c0 = block[0] | (block[1] << 8);
+		u32 c1 = block[2] | (block[3] << 8);
+
+		u32 colors[4][4];
+		from_565(c0, colors[0]);
+		from_565(c1, colors[1]);
+
+		for (u32 c = 0; c < 3; ++c) {
+			if (c0 > c1 || forceFourColor) {
+				colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+				colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+			}
+			else {
+				colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+				colors[3][c] = 0;
+			}
+		}
+		colors[2][3] = 255;
+		colors[3][3] = c0 > c1 || forceFourColor ? 255 : 0;
+
+		u32 bits;
+		std::memcpy(&bits, block + 4, sizeof(bits));
+
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			auto index = (bits >> (i * 2)) & 0x3;
+			for (u32 c = 0; c < 4; ++c) {
+				rgba[i * 4 + c] = static_cast<byte>(colors[index][c]);
+			}
+		}
+	}
+
+	//Eight value mode (a0 > a1) with the channel's range as endpoints,
+	//close to optimal for the smooth data single channel formats carry
+	void encode_bc4(const texel_block& block, u32 channel, byte* output) {
+		f32 lo = 255.0f, hi = 0.0f;
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			lo = std::min(lo, block.channels[channel][i]);
+			hi = std::max(hi, block.channels[channel][i]);
+		}
+
+		auto a0 = static_cast<u32>(std::lround(hi));
+		auto a1 = static_cast<u32>(std::lround(lo));
+		output[0] = static_cast<byte>(a0);
+		output[1] = static_cast<byte>(a1);
+
+		//Equal endpoints select the six value mode, where index 0 is still a0
+		if (a0 == a1) {
+			return;
+		}
+
+		palette pal{ {}, 8 };
+		pal.entries[0][channel] = static_cast<f32>(a0);
+		pal.entries[1][channel] = static_cast<f32>(a1);
+		for (u32 e = 2; e < 8; ++e) {
+			pal.entries[e][channel] = static_cast<f32>(((8 - e) * a0 + (e - 1) * a1 + 3) / 7);
+		}
+
+		f32 weights[4]{};
+		weights[channel] = 1.0f;
+
+		byte indices[BLOCK_TEXELS];
+		fit_indices(block, pal, weights, indices);
+
+		u64 bits = 0;
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			bits |= static_cast<u64>(indices[i]) << (i * 3);
+		}
+
+		for (u32 i = 0; i < 6; ++i) {
+			output[2 + i] = static_cast<byte>(bits >> (i * 8));
+		}
+	}
+
+	void decode_bc4(const byte* block, byte* rgba, u32 channel) {
+		u32 a0 = block[0], a1 = block[1];
+		u32 values[8] = { a0, a1 };
+
+		if (a0 > a1) {
+			for (u32 e = 2; e < 8; ++e) {
+				values[e] = ((8 - e) * a0 + (e - 1) * a1 + 3) / 7;
+			}
+		}
+		else {
+			for (u32 e = 2; e < 6; ++e) {
+				values[e] = ((6 - e) * a0 + (e - 1) * a1 + 2) / 5;
+			}
+			values[6] = 0;
+			values[7] = 255;
+		}
+
+		u64 bits = 0;
+		for (u32 i = 0; i < 6; ++i) {
+			bits |= static_cast<u64>(block[2 + i]) << (i * 8);
+		}
+
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			rgba[i * 4 + channel] = static_cast<byte>(values[(bits >> (i * 3)) & 0x7]);
+		}
+	}
+
+	struct bc7_endpoint {
+		u32 color[4]; //7 bits per channel
+		u32 pbit;
+
+		//Picks the shared p-bit with the smaller error over all channels
+		explicit bc7_endpoint(const f32 value[4]) {
+			f32 bestError = std::numeric_limits<f32>::max();
+
+			for (u32 p = 0; p < 2; ++p) {
+				u32 candidate[4];
+				f32 error = 0.0f;
+
+				for (u32 c = 0; c < 4; ++c) {
+					auto q = std::lround((value[c] - p) / 2.0f);
+					candidate[c] = static_cast<u32>(std::min(std::max(q, 0l), 127l));
+
+					f32 delta = static_cast<f32>((candidate[c] << 1) | p) - value[c];
+					error += delta * delta;
+				}
+
+				if (error < bestError) {
+					bestError = error;
+					pbit = p;
+					std::memcpy(color, candidate, sizeof(color));
+				}
+			}
+		}
+
+		u32 expand(u32 channel) const {
+			return (color[channel] << 1) | pbit;
+		}
+	};
+
+	f32 fit_bc7(const texel_block& block, const bc7_endpoint& e0, const bc7_endpoint& e1, byte* indices) {
+		palette pal{ {}, 16 };
+		for (u32 e = 0; e < 16; ++e) {
+			for (u32 c = 0; c < 4; ++c) {
+				auto w = BC7_INTERPOLATION[e];
+				pal.entries[e][c] = static_cast<f32>(((64 - w) * e0.expand(c) + w * e1.expand(c) + 32) >> 6);
+			}
+		}
+
+		return fit_indices(block, pal, RGBA_WEIGHTS, indices);
+	}
+
+	//Mode 6: one subset, 7.7.7.7 endpoints with a p-bit each and 4 bit indices
+	void encode_bc7(const texel_block& block, byte* output) {
+		f32 v0[4], v1[4];
+		axis_endpoints(block, RGBA_WEIGHTS, 5, v0, v1);
+
+		bc7_endpoint e0(v0), e1(v1);
+		byte indices[BLOCK_TEXELS];
+		f32 error = fit_bc7(block, e0, e1, indices);
+
+		for (u32 iteration = 0; iteration < REFINE_ITERATIONS && error > 0.0f; ++iteration) {
+			f32 t[BLOCK_TEXELS];
+			for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+				t[i] = BC7_INTERPOLATION[indices[i]] / 64.0f;
+			}
+
+			if (!solve_endpoints(block, t, v0, v1)) {
+				break;
+			}
+
+			bc7_endpoint r0(v0), r1(v1);
+			byte refined[BLOCK_TEXELS];
+			f32 refinedError = fit_bc7(block, r0, r1, refined);
+
+			if (refinedError >= error) {
+				break;
+			}
+
+			e0 = r0;
+			e1 = r1;
+			error = refinedError;
+			std::memcpy(indices, refined, sizeof(indices));
+		}
+
+		//The anchor texel stores its index without the top bit, mirror the palette if it is set
+		if (indices[0] & 0x8) {
+			std::swap(e0, e1);
+			for (auto& index : indices) {
+				index = static_cast<byte>(15 - index);
+			}
+		}
+
+		bit_writer writer{ output };
+		writer.write(0x1 << 6, 7);
+
+		for (u32 c = 0; c < 4; ++c) {
+			writer.write(e0.color[c], 7);
+			writer.write(e1.color[c], 7);
+		}
+
+		writer.write(e0.pbit, 1);
+		writer.write(e1.pbit, 1);
+
+		writer.write(indices[0], 3);
+		for (u32 i = 1; i < BLOCK_TEXELS; ++i) {
+			writer.write(indices[i], 4);
+		}
+	}
+
+	void decode_bc7(const byte* block, byte* rgba) {
+		bit_reader reader{ block };
+
+		if (reader.read(7) != (0x1 << 6)) {
+			for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+				rgba[i * 4 + 0] = 255;
+				rgba[i * 4 + 1] = 0;
+				rgba[i * 4 + 2] = 255;
+				rgba[i * 4 + 3] = 255;
+			}
+			return;
+		}
+
+		u32 endpoints[2][4];
+		for (u32 c = 0; c < 4; ++c) {
+			endpoints[0][c] = reader.read(7);
+			endpoints[1][c] = reader.read(7);
+		}
+
+		u32 p0 = reader.read(1);
+		u32 p1 = reader.read(1);
+		for (u32 c = 0; c < 4; ++c) {
+			endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+			endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+		}
+
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			auto w = BC7_INTERPOLATION[reader.read(i == 0 ? 3 : 4)];
+			for (u32 c = 0; c < 4; ++c) {
+				rgba[i * 4 + c] = static_cast<byte>(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+			}
+		}
+	}
+}
+
+std::size_t redox::texture_compressor::block_size(BlockFormat format) {
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+std::size_t redox::texture_compressor::compressed_size(BlockFormat format, u32 width, u32 height) {
+	std::size_t blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	std::size_t blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	return blocksX * blocksY * block_size(format);
+}
+
+void redox::texture_compressor::encode_block(BlockFormat format, const byte* rgba, byte* output) {
+	std::memset(output, 0, block_size(format));
+	texel_block block(rgba);
+
+	switch (format) {
+	case BlockFormat::BC1:
+		encode_bc1(block, output);
+		break;
+	case BlockFormat::BC3:
+		encode_bc4(block, 3, output);
+		encode_bc1(block, output + 8);
+		break;
+	case BlockFormat::BC4:
+		encode_bc4(block, 0, output);
+		break;
+	case BlockFormat::BC5:
+		encode_bc4(block, 0, output);
+		encode_bc4(block, 1, output + 8);
+		break;
+	case BlockFormat::BC7:
+		encode_bc7(block, output);
+		break;
+	}
+}
+
+void redox::texture_compressor::decode_block(BlockFormat format, const byte* block, byte* rgba) {
+	switch (format) {
+	case BlockFormat::BC1:
+		decode_bc1(block, rgba, false);
+		break;
+	case BlockFormat::BC3:
+		decode_bc1(block + 8, rgba, true);
+		decode_bc4(block, rgba, 3);
+		break;
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+		for (u32 i = 0; i < BLOCK_TEXELS; ++i) {
+			rgba[i * 4 + 1] = 0;
+			rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+
+		decode_bc4(block, rgba, 0);
+		if (format == BlockFormat::BC5) {
+			decode_bc4(block + 8, rgba, 1);
+		}
+		break;
+	case BlockFormat::BC7:
+		decode_bc7(block, rgba);
+		break;
+	}
+}
+
+void redox::texture_compressor::compress_rows(const byte* pixels, u32 width, u32 height, BlockFormat format,
+	u32 firstRow, u32 rowCount, byte* output) {
+
+	u32 blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	u32 blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+	u32 lastRow = std::min(blocksY, firstRow + rowCount);
+	auto blockBytes = block_size(format);
+
+	byte rgba[BLOCK_TEXELS * 4];
+
+	for (u32 by = firstRow; by < lastRow; ++by) {
+		for (u32 bx = 0; bx < blocksX; ++bx) {
+			for (u32 y = 0; y < BLOCK_DIMENSION; ++y) {
+				for (u32 x = 0; x < BLOCK_DIMENSION; ++x) {
+					auto sx = std::min(bx * BLOCK_DIMENSION + x, width - 1);
+					auto sy = std::min(by * BLOCK_DIMENSION + y, height - 1);
+					std::memcpy(rgba + (y * BLOCK_DIMENSION + x) * 4, pixels + (static_cast<std::size_t>(sy) * width + sx) * 4, 4);
+				}
+			}
+
+			encode_block(format, rgba, output + (static_cast<std::size_t>(by) * blocksX + bx) * blockBytes);
+		}
+	}
+}
+
+redox::Buffer<redox::byte> redox::texture_compressor::compress(const byte* pixels, u32 width, u32 height, BlockFormat format) {
+	Buffer<byte> output(compressed_size(format, width, height));
+	compress_rows(pixels, width, height, format, 0, (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION, output.data());
+	return output;
+}
@@ -0,0 +1,57 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include "core/core.h"
+
+namespace redox::texture_compressor {
+	//Pixels per block edge, every format here encodes 4x4 texel blocks
+	constexpr u32 BLOCK_DIMENSION = 4;
+
+	enum class BlockFormat {
+		BC1, //RGB, 4 bpp, no alpha
+		BC3, //RGBA, 8 bpp, BC1 color plus a BC4 alpha block
+		BC4, //R, 4 bpp
+		BC5, //RG, 8 bpp, two BC4 blocks for tangent space normals
+		BC7  //RGBA, 8 bpp, written in mode 6 only
+	};
+
+	std::size_t block_size(BlockFormat format);
+	std::size_t compressed_size(BlockFormat format, u32 width, u32 height);
+
+	//Encodes one block of 16 RGBA8 texels in row order
+	void encode_block(BlockFormat format, const byte* rgba, byte* output);
+
+	//Inverse of encode_block, BC7 blocks are expected in mode 6 and decode to magenta otherwise
+	void decode_block(BlockFormat format, const byte* block, byte* rgba);
+
+	//Encodes the block rows [firstRow, firstRow + rowCount) of a tightly packed RGBA8 image
+	//into output, which is sized for the whole image. Partial blocks at the edges repeat
+	//the last row and column, so bands can be encoded on separate threads
+	void compress_rows(const byte* pixels, u32 width, u32 height, BlockFormat format,
+		u32 firstRow, u32 rowCount, byte* output);
+
+	Buffer<byte> compress(const byte* pixels, u32 width, u32 height, BlockFormat format);
+}
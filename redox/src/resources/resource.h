@@ -39,17 +39,27 @@ namespace redox {
 		ENGINE
 	};
 	
+	template<class T>
+	using ResourceHandle = SharedPtr<T>;
+
+	template<class T>
+	using WeakResourceHandle = WeakPtr<T>;
+
 	struct IResource {
 		virtual ~IResource() = default;
 		virtual void upload() = 0;
 		virtual ResourceGroup res_group() const = 0;
-	};
 
-	template<class T>
-	using ResourceHandle = SharedPtr<T>;
+		//Approximate number of bytes owned by this resource (host + device)
+		virtual std::size_t memory_usage() const = 0;
 
-	template<class T>
-	using WeakResourceHandle = WeakPtr<T>;
+		//Called on the main thread after the resource at dependency, loaded as part of this one, was reloaded.
+		//Returning false makes the resource manager reload this resource as well.
+		virtual bool patch_dependency(const Path& dependency, const ResourceHandle<IResource>& oldDependency,
+			const ResourceHandle<IResource>& newDependency) {
+			return false;
+		}
+	};
 
 	struct IResourceFactory {
 		virtual ~IResourceFactory() = default;
@@ -26,36 +26,172 @@ SOFTWARE.
 #include "resource_manager.h"
 #include "core/application.h"
 
+#include <algorithm> //std::find
+#include <deque> //std::deque
+#include <unordered_set> //std::unordered_set
+
+namespace {
+	//Resources currently being built by a factory on this thread, innermost last
+	thread_local redox::Buffer<redox::Path> t_loadStack;
+
+	//Replaces the load stack of this thread until destroyed
+	class load_stack_scope {
+	public:
+		load_stack_scope(redox::Buffer<redox::Path> stack) {
+			_saved.swap(t_loadStack);
+			t_loadStack = std::move(stack);
+		}
+
+		~load_stack_scope() {
+			t_loadStack.swap(_saved);
+		}
+
+	private:
+		redox::Buffer<redox::Path> _saved;
+	};
+
+	void add_unique(redox::Buffer<redox::Path>& paths, const redox::Path& path) {
+		if (std::find(paths.begin(), paths.end(), path) == paths.end()) {
+			paths.push_back(path);
+		}
+	}
+}
+
 redox::ResourceManager* redox::ResourceManager::instance() {
 	return Application::instance->resource_manager();
 }
 
-redox::ResourceManager::ResourceManager(const Path& builtinResources, const Path& appResources) :
+redox::ResourceManager::ResourceManager(const Path& builtinResources, const Path& appResources, const Path& derivedData) :
 	_builtinResources(io::absolute(builtinResources)),
-	_appResources(io::absolute(appResources)) {
+	_appResources(io::absolute(appResources)),
+	_vfs(Application::instance->thread_pool()) {
 
 	RDX_LOG("Initializing Resource Manager...", ConsoleColor::GREEN);
 	auto config = Application::instance->config();
 
+	//Archives are searched before the loose files next to them
+	_vfs.mount_directory(_builtinResources);
+	_vfs.mount_directory(_appResources);
+
+	//Budgets are given in megabytes, indexed by ResourceGroup
+	const char* budgetKeys[] = {
+		"GraphicsBudget", "AudioBudget", "PhysicsBudget", "ScriptBudget", "EngineBudget"
+	};
+
+	for (std::size_t i = 0; i < _cacheGroups.size(); ++i) {
+		u32 budget = config->get("Resources", budgetKeys[i]);
+		_cacheGroups[i].stats.budget = static_cast<std::size_t>(budget) * 1024 * 1024;
+	}
+
+	u32 derivedDataSize = config->get("Resources", "DerivedDataCacheSize");
+	if (derivedDataSize > 0) {
+		_derivedData = make_unique<DerivedDataCache>(derivedData,
+			static_cast<std::size_t>(derivedDataSize) * 1024 * 1024);
+	}
+
 	if (config->get("Resources", "HotReloading")) {
-		_monitor.emplace();
-		_monitor->subscribe([this](auto file, auto event) {
-			_event_resource_modified(file, event);
-		});
-		_monitor->start(_appResources, io::ChangeEvents::FILE_MODIFIED);
-		RDX_LOG("Hot-Reload enabled. Monitoring App resources...");
+		for (const auto& root : { _appResources, _builtinResources }) {
+			auto& monitor = _monitors.emplace_back(make_unique<io::DirectoryWatcher>());
+			monitor->subscribe([this, root](const auto& changes) {
+				for (const auto& change : changes) {
+					_event_resource_modified(root / change.file);
+				}
+			});
+			monitor->start(root, io::ChangeEvents::FILE_MODIFIED);
+		}
+		RDX_LOG("Hot-Reload enabled. Monitoring App and builtin resources...");
 	}
 }
 
 void redox::ResourceManager::clear_cache(ResourceGroup groups) {
 	RDX_LOG("Clearing resource cache...");
+	std::lock_guard guard(_resourcesMutex);
 	for (auto it = _cache.begin(); it != _cache.end();) {
-		if (util::check_flag(groups, it->second->res_group())) {
-			it = _cache.erase(it);
+		if (util::check_flag(groups, it->second.group)) {
+			it = _cache_erase(it);
 		} else ++it;
 	}
 }
 
+redox::ResourceCacheStats redox::ResourceManager::cache_stats(ResourceGroup group) const {
+	std::lock_guard guard(_resourcesMutex);
+	return _cacheGroups[static_cast<std::size_t>(group)].stats;
+}
+
+redox::ResourceManager::cache_group& redox::ResourceManager::_cache_group(ResourceGroup group) {
+	return _cacheGroups[static_cast<std::size_t>(group)];
+}
+
+void redox::ResourceManager::_cache_touch(cache_entry& entry) {
+	auto& lru = _cache_group(entry.group).lru;
+	lru.splice(lru.begin(), lru, entry.lruIt);
+}
+
+void redox::ResourceManager::_cache_insert(const Path& resolvedPath,
+	ResourceHandle<IResource> resource, Buffer<ResourceHandle<IResource>>& evicted) {
+
+	if (auto it = _cache.find(resolvedPath); it != _cache.end()) {
+		evicted.push_back(it->second.resource);
+		_cache_erase(it);
+	}
+
+	auto resGroup = resource->res_group();
+	auto& group = _cache_group(resGroup);
+
+	auto& cached = _cachedResources[resource.get()];
+	if (cached.entries++ == 0) {
+		cached.size = resource->memory_usage();
+		group.stats.usage += cached.size;
+		group.stats.resourceCount++;
+	}
+
+	group.lru.push_front(resolvedPath);
+	_cache.emplace(resolvedPath, cache_entry{ std::move(resource), resGroup, group.lru.begin() });
+
+	_cache_trim(group, evicted);
+}
+
+redox::Hashmap<redox::Path, redox::ResourceManager::cache_entry>::iterator
+redox::ResourceManager::_cache_erase(Hashmap<Path, cache_entry>::iterator it) {
+	auto& group = _cache_group(it->second.group);
+	group.lru.erase(it->second.lruIt);
+
+	auto cit = _cachedResources.find(it->second.resource.get());
+	if (--cit->second.entries == 0) {
+		group.stats.usage -= cit->second.size;
+		group.stats.resourceCount--;
+		_cachedResources.erase(cit);
+	}
+	return _cache.erase(it);
+}
+
+void redox::ResourceManager::_cache_trim(cache_group& group, Buffer<ResourceHandle<IResource>>& evicted) {
+	if (group.stats.budget == 0 || group.stats.usage <= group.stats.budget) {
+		return;
+	}
+
+	//Walk from least recently used, skipping anything still referenced outside the cache. Memory of
+	//a resource cached under several paths is only freed with its last entry
+	for (auto lit = group.lru.end(); lit != group.lru.begin() && group.stats.usage > group.stats.budget;) {
+		--lit;
+		auto cit = _cache.find(*lit);
+		const auto& cached = _cachedResources.at(cit->second.resource.get());
+		if (cit->second.resource.use_count() > static_cast<long>(cached.entries)) {
+			continue;
+		}
+
+		RDX_LOG("Evicting {0} from resource cache...", ConsoleColor::WHITE, *lit);
+		group.stats.evictions++;
+		if (cached.entries == 1) {
+			group.stats.evictedBytes += cached.size;
+		}
+		evicted.push_back(cit->second.resource);
+
+		lit = std::next(lit);
+		_cache_erase(cit);
+	}
+}
+
 redox::Path redox::ResourceManager::resolve_path(const Path& path) const {
 	if (auto id = path.string(); id.find("builtin:") == 0) {
 		return _builtinResources / id.substr(8);
@@ -63,6 +199,14 @@ redox::Path redox::ResourceManager::resolve_path(const Path& path) const {
 	return _appResources / path;
 }
 
+redox::VirtualFileSystem* redox::ResourceManager::vfs() {
+	return &_vfs;
+}
+
+redox::DerivedDataCache* redox::ResourceManager::derived_data() {
+	return _derivedData.get();
+}
+
 void redox::ResourceManager::register_factory(IResourceFactory* factory) {
 	_factories.push_back(factory);
 }
@@ -76,42 +220,299 @@ redox::IResourceFactory* redox::ResourceManager::_find_factory(const Path& ext)
 	return nullptr;
 }
 
-void redox::ResourceManager::_event_resource_modified(const Path& file, io::ChangeEvents event) {
+redox::ResourceHandle<redox::IResource> redox::ResourceManager::_load_from_factory(const Path& resolvedPath) {
+	auto factory = _find_factory(resolvedPath.extension());
+	if (factory == nullptr) {
+		throw Exception(redox::format("no suitable factory found for {0}",
+			resolvedPath.extension()));
+	}
+
+	t_loadStack.push_back(resolvedPath);
+	RDX_SCOPE_GUARD([]() {
+		t_loadStack.pop_back();
+	});
+
+	return factory->load(resolvedPath);
+}
+
+void redox::ResourceManager::add_dependency(const Path& resolvedPath) {
+	if (t_loadStack.empty() || t_loadStack.back() == resolvedPath) {
+		return;
+	}
+
+	const auto& dependent = t_loadStack.back();
+
 	std::lock_guard guard(_resourcesMutex);
-	if (auto cit = _cache.find(file); cit != _cache.end()) {
-		RDX_LOG("Resource {0} modified. Attempting to reload...", file);
-		auto nr = load(file);
-		onReloadResource(cit->second, nr);
+	add_unique(_dependents[resolvedPath], dependent);
+	add_unique(_dependencies[dependent], resolvedPath);
+}
+
+redox::Function<void()> redox::ResourceManager::bind_load_context(Function<void()> fn) const {
+	return [stack = t_loadStack, fn = std::move(fn)]() {
+		load_stack_scope scope(stack);
+		fn();
+	};
+}
+
+void redox::ResourceManager::_event_resource_modified(const Path& resolvedPath) {
+	//Called on a watcher thread, the actual reload happens in update()
+	std::lock_guard guard(_reloadMutex);
+	add_unique(_pendingReloads, resolvedPath);
+}
+
+void redox::ResourceManager::_process_reloads(const Buffer<Path>& changed) {
+	std::deque<Path> queue(changed.begin(), changed.end());
+	std::unordered_set<Path> visited;
+
+	while (!queue.empty()) {
+		auto path = std::move(queue.front());
+		queue.pop_front();
+
+		if (!visited.insert(path).second) {
+			continue;
+		}
+
+		ResourceHandle<IResource> oldResource;
+		Buffer<Path> dependents;
+		{
+			std::lock_guard guard(_resourcesMutex);
+			if (auto cit = _cache.find(path); cit != _cache.end()) {
+				oldResource = cit->second.resource;
+			}
+
+			if (auto dit = _dependents.find(path); dit != _dependents.end()) {
+				dependents = dit->second;
+			}
+		}
+
+		//Raw files (e.g. glTF buffers) are not cached, only their dependents can be rebuilt
+		ResourceHandle<IResource> newResource;
+		if (oldResource) {
+			RDX_LOG("Resource {0} modified. Attempting to reload...", path);
+			try {
+				newResource = _reload(path);
+			}
+			catch (const Exception& ex) {
+				RDX_LOG("Failed to reload {0}: {1}", ConsoleColor::RED, path, ex.what());
+			}
+
+			if (!newResource) {
+				continue;
+			}
+		}
+
+		for (const auto& dependent : dependents) {
+			ResourceHandle<IResource> dependentResource;
+			{
+				std::lock_guard guard(_resourcesMutex);
+				if (auto cit = _cache.find(dependent); cit != _cache.end()) {
+					dependentResource = cit->second.resource;
+				}
+			}
+
+			if (!dependentResource) {
+				continue;
+			}
+
+			if (oldResource && dependentResource->patch_dependency(path, oldResource, newResource)) {
+				RDX_LOG("Patched {0}", dependent);
+				continue;
+			}
+
+			queue.push_back(dependent);
+		}
+
+		if (oldResource) {
+			onReloadResource(oldResource, newResource);
+		}
+	}
+}
+
+redox::ResourceHandle<redox::IResource> redox::ResourceManager::_reload(const Path& resolvedPath) {
+	//The factory records the dependencies again, the old ones are restored if it fails
+	Buffer<Path> oldDependencies;
+	{
+		std::lock_guard guard(_resourcesMutex);
+		if (auto it = _dependencies.find(resolvedPath); it != _dependencies.end()) {
+			oldDependencies = std::move(it->second);
+			_dependencies.erase(it);
+		}
+
+		for (const auto& dependency : oldDependencies) {
+			auto& dependents = _dependents[dependency];
+			dependents.erase(std::remove(dependents.begin(), dependents.end(), resolvedPath), dependents.end());
+		}
+	}
+
+	auto restoreDependencies = [&]() {
+		std::lock_guard guard(_resourcesMutex);
+		for (const auto& dependency : oldDependencies) {
+			add_unique(_dependents[dependency], resolvedPath);
+			add_unique(_dependencies[resolvedPath], dependency);
+		}
+	};
+
+	ResourceHandle<IResource> resource;
+	try {
+		resource = _load_from_factory(resolvedPath);
+	}
+	catch (...) {
+		restoreDependencies();
+		throw;
+	}
+
+	if (!resource) {
+		restoreDependencies();
+		return nullptr;
 	}
+
+	resource->upload();
+
+	Buffer<ResourceHandle<IResource>> evicted;
+	{
+		std::lock_guard guard(_resourcesMutex);
+		_cache_insert(resolvedPath, resource, evicted);
+	}
+
+	return resource;
 }
 
 redox::ResourceHandle<redox::IResource> redox::ResourceManager::load(const Path& path) {
 	auto resolvedPath = resolve_path(path);
-	if (!io::is_regular_file(resolvedPath)) {
+
+	//Also tracked for missing files, so creating them later rebuilds the dependent
+	add_dependency(resolvedPath);
+
+	if (!_vfs.exists(resolvedPath)) {
 		RDX_LOG("Resource does not exist: {0}", ConsoleColor::RED, path);
 		return nullptr;
 	}
 
-	RDX_LOG("Loading {0}...", ConsoleColor::WHITE, path);
-	RDX_UNUSED(std::lock_guard(_resourcesMutex));
+	std::promise<ResourceHandle<IResource>> promise;
+	{
+		std::unique_lock lock(_resourcesMutex);
+		if (auto cit = _cache.find(resolvedPath); cit != _cache.end()) {
+			_cache_touch(cit->second);
+			return cit->second.resource;
+		}
 
-	if (auto cit = _cache.find(resolvedPath); cit != _cache.end()) {
-		return cit->second;
+		//Someone else is already loading this resource, wait for their result
+		if (auto fit = _inflight.find(resolvedPath); fit != _inflight.end()) {
+			auto future = fit->second;
+			lock.unlock();
+			return future.get();
+		}
+
+		_inflight.emplace(resolvedPath, promise.get_future().share());
 	}
 
-	auto factory = _find_factory(resolvedPath.extension());
-	if (factory == nullptr) {
-		throw Exception(redox::format("no suitable factory found for {0}",
-			resolvedPath.extension()));
+	RDX_LOG("Loading {0}...", ConsoleColor::WHITE, path);
+
+	ResourceHandle<IResource> resource;
+	try {
+		resource = _load_from_factory(resolvedPath);
+	}
+	catch (...) {
+		{
+			std::lock_guard guard(_resourcesMutex);
+			_inflight.erase(resolvedPath);
+		}
+		promise.set_exception(std::current_exception());
+		throw;
 	}
 
-	auto resource = factory->load(resolvedPath);
-	if (resource) {
-		_cache[resolvedPath] = resource;
+	//Evicted resources are released after the lock is dropped
+	Buffer<ResourceHandle<IResource>> evicted;
+	{
+		std::lock_guard guard(_resourcesMutex);
+		if (resource) {
+			_cache_insert(resolvedPath, resource, evicted);
+		}
+		_inflight.erase(resolvedPath);
 	}
+
+	promise.set_value(resource);
 	return resource;
 }
 
+void redox::ResourceManager::update() {
+	//Resources may have been released since they were inserted, retry the budgets
+	Buffer<ResourceHandle<IResource>> evicted;
+	{
+		std::lock_guard guard(_resourcesMutex);
+		for (auto& group : _cacheGroups) {
+			_cache_trim(group, evicted);
+		}
+	}
+
+	Buffer<Path> reloads;
+	{
+		std::lock_guard guard(_reloadMutex);
+		reloads.swap(_pendingReloads);
+	}
+
+	if (!reloads.empty()) {
+		_process_reloads(reloads);
+	}
+
+	decltype(_completed) completed;
+	{
+		std::lock_guard guard(_completedMutex);
+		completed.swap(_completed);
+	}
+
+	//Every state is final before the first callback runs, callbacks see each other's results
+	Buffer<std::pair<detail::async_resource_state::callback_type, ResourceHandle<IResource>>> callbacks;
+	for (auto& [state, resource] : completed) {
+		std::lock_guard guard(state->mutex);
+		if (resource) {
+			state->resource = resource;
+			state->state = LoadState::READY;
+		}
+		else state->state = LoadState::FAILED;
+
+		for (auto& fn : state->callbacks) {
+			callbacks.emplace_back(std::move(fn), resource);
+		}
+		state->callbacks.clear();
+	}
+
+	//A failing callback doesn't keep the remaining ones from running
+	for (const auto& [fn, resource] : callbacks) {
+		try {
+			fn(resource);
+		}
+		catch (const Exception& ex) {
+			RDX_LOG("Load callback failed: {0}", ConsoleColor::RED, ex.what());
+		}
+	}
+}
+
+redox::SharedPtr<redox::detail::async_resource_state> redox::ResourceManager::_load_async(
+	const Path& path, ResourceHandle<IResource> placeholder, TaskPriority priority) {
+
+	auto state = make_shared<detail::async_resource_state>();
+	state->resource = std::move(placeholder);
+
+	Application::instance->thread_pool()->submit([this, state, path]() {
+		//Starts out with an empty load stack, async loads don't belong to whoever requested them
+		load_stack_scope scope({});
+
+		ResourceHandle<IResource> resource;
+		try {
+			resource = load(path);
+		}
+		catch (const Exception& ex) {
+			RDX_LOG("Failed to load {0}: {1}", ConsoleColor::RED, path, ex.what());
+		}
+
+		std::lock_guard guard(_completedMutex);
+		_completed.push_back({ state, std::move(resource) });
+	}, priority);
+
+	return state;
+}
+
 redox::ResourceHandle<redox::IResource> redox::ResourceManager::load(const Path& path, const Path& fallback) {
 	
 	auto resource = load(path);
@@ -27,28 +27,54 @@ SOFTWARE.
 #include <core/core.h>
 #include <core/non_copyable.h>
 #include <resources/resource.h>
+#include <resources/async_resource.h>
+#include <resources/virtual_filesystem.h>
+#include <resources/derived_data_cache.h>
 #include <platform/filesystem.h>
 #include <core/logging/log.h>
 #include <core/event.h>
+#include <core/threading/thread_pool.h>
 
 #include <platform/filesystem.h>
 #include <mutex> //std::mutex, std::lock_guard
-#include <optional> //std::optional
+#include <future> //std::shared_future
+#include <list> //std::list
+#include <array> //std::array
 
 namespace redox {
+	struct ResourceCacheStats {
+		std::size_t budget;		//0 = unlimited
+		std::size_t usage;
+		std::size_t resourceCount;
+		std::size_t evictions;
+		std::size_t evictedBytes;
+	};
+
 	class ResourceManager : public NonCopyable {
 	public:
 		static ResourceManager* instance();
 			
-		ResourceManager(const Path& builtinResources, const Path& appResources);
+		ResourceManager(const Path& builtinResources, const Path& appResources, const Path& derivedData);
 		~ResourceManager() = default;
 
 		void clear_cache(ResourceGroup groups);
+		ResourceCacheStats cache_stats(ResourceGroup group) const;
 		void register_factory(IResourceFactory* factory);
 
 		ResourceHandle<IResource> load(const Path& path);
 		ResourceHandle<IResource> load(const Path& path, const Path& fallback);
 		Path resolve_path(const Path& path) const;
+		VirtualFileSystem* vfs();
+		//Null when the derived data cache is disabled
+		DerivedDataCache* derived_data();
+
+		//Records that the resource currently being loaded on this thread was built from path.
+		//Nested load() calls are tracked automatically, factories only need this for raw files.
+		void add_dependency(const Path& resolvedPath);
+
+		//Wraps fn so it runs as part of the resource currently being loaded on this thread,
+		//factories fanning work out to the thread pool keep their nested loads tracked that way
+		Function<void()> bind_load_context(Function<void()> fn) const;
 
 		template<class R, class...Args>
 		ResourceHandle<R> load(Args&&...args) {
@@ -56,18 +82,86 @@ namespace redox {
 			return std::static_pointer_cast<R>(load(std::forward<Args>(args)...));
 		}
 
+		template<class R>
+		AsyncResourceHandle<R> load_async(const Path& path, TaskPriority priority = TaskPriority::NORMAL) {
+			static_assert(std::is_base_of_v<IResource, R>, "<R> must be of type IResource");
+			return _load_async(path, nullptr, priority);
+		}
+
+		template<class R>
+		AsyncResourceHandle<R> load_async(const Path& path, const Path& fallback,
+			TaskPriority priority = TaskPriority::NORMAL) {
+			static_assert(std::is_base_of_v<IResource, R>, "<R> must be of type IResource");
+			return _load_async(path, load(fallback), priority);
+		}
+
+		void update();
+
 		Event<ResourceHandle<IResource>, ResourceHandle<IResource>> onReloadResource;
 
 	private:
 		IResourceFactory* _find_factory(const Path& ext);
-		void _event_resource_modified(const Path& file, io::ChangeEvents event);
+		ResourceHandle<IResource> _load_from_factory(const Path& resolvedPath);
+		void _event_resource_modified(const Path& resolvedPath);
+		void _process_reloads(const Buffer<Path>& changed);
+		ResourceHandle<IResource> _reload(const Path& resolvedPath);
+
+		struct cache_entry {
+			ResourceHandle<IResource> resource;
+			ResourceGroup group;
+			std::list<Path>::iterator lruIt;
+		};
+
+		//A resource cached under several paths, e.g. textures shared by content, is counted once
+		struct cached_resource {
+			std::size_t size;
+			std::size_t entries; //Cache entries referencing it
+		};
+
+		struct cache_group {
+			std::list<Path> lru; //Most recently used first
+			ResourceCacheStats stats{};
+		};
+
+		//These expect _resourcesMutex to be held by the caller
+		cache_group& _cache_group(ResourceGroup group);
+		void _cache_touch(cache_entry& entry);
+		void _cache_insert(const Path& resolvedPath, ResourceHandle<IResource> resource,
+			Buffer<ResourceHandle<IResource>>& evicted);
+		Hashmap<Path, cache_entry>::iterator _cache_erase(Hashmap<Path, cache_entry>::iterator it);
+		void _cache_trim(cache_group& group, Buffer<ResourceHandle<IResource>>& evicted);
+
+		SharedPtr<detail::async_resource_state> _load_async(const Path& path,
+			ResourceHandle<IResource> placeholder, TaskPriority priority);
+
+		struct completed_load {
+			SharedPtr<detail::async_resource_state> state;
+			ResourceHandle<IResource> resource;
+		};
 
 		Path _appResources;
 		Path _builtinResources;
+		VirtualFileSystem _vfs;
+		UniquePtr<DerivedDataCache> _derivedData;
 
-		std::recursive_mutex _resourcesMutex;
-		Hashmap<Path, ResourceHandle<IResource>> _cache;
+		//Only guards the lookup tables, factories run without holding it
+		mutable std::mutex _resourcesMutex;
+		Hashmap<Path, cache_entry> _cache;
+		Hashmap<const IResource*, cached_resource> _cachedResources;
+		std::array<cache_group, 5> _cacheGroups;
+		Hashmap<Path, std::shared_future<ResourceHandle<IResource>>> _inflight;
 		Buffer<IResourceFactory*> _factories;
-		std::optional<io::DirectoryWatcher> _monitor;
+		Buffer<UniquePtr<io::DirectoryWatcher>> _monitors;
+
+		//Dependency -> resources built from it and the reverse, guarded by _resourcesMutex
+		Hashmap<Path, Buffer<Path>> _dependents;
+		Hashmap<Path, Buffer<Path>> _dependencies;
+
+		//Filled by the watcher threads, drained on the main thread in update()
+		std::mutex _reloadMutex;
+		Buffer<Path> _pendingReloads;
+
+		std::mutex _completedMutex;
+		Buffer<completed_load> _completed;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "virtual_filesystem.h"
+#include <core/logging/log.h>
+
+redox::VirtualFileSystem::VirtualFileSystem(ThreadPool* threadPool) :
+	_threadPool(threadPool) {
+}
+
+void redox::VirtualFileSystem::mount(const Path& archive, const Path& mountPoint) {
+	auto mounted = make_unique<Archive>(archive, _threadPool);
+	RDX_LOG("Mounted {0} ({1} entries)", archive.filename(), mounted->entry_count());
+
+	std::lock_guard guard(_mutex);
+	_mounts.push_back({ mountPoint.lexically_normal(), std::move(mounted) });
+}
+
+std::size_t redox::VirtualFileSystem::mount_directory(const Path& directory) {
+	if (!io::is_directory(directory)) {
+		return 0;
+	}
+
+	std::size_t count{ 0 };
+	for (const auto& file : io::directory_iterator(directory)) {
+		if (file.is_regular_file() && file.path().extension() == ".rpak") {
+			mount(file.path(), directory);
+			++count;
+		}
+	}
+	return count;
+}
+
+bool redox::VirtualFileSystem::exists(const Path& path) const {
+	Path relativePath;
+	if (_find_archive(path, relativePath) != nullptr) {
+		return true;
+	}
+	return io::is_regular_file(path);
+}
+
+redox::io::FileView redox::VirtualFileSystem::read(const Path& path) const {
+	Path relativePath;
+	if (auto archive = _find_archive(path, relativePath); archive != nullptr) {
+		return *archive->read(relativePath);
+	}
+
+	io::File file(path, io::File::Mode::READ | io::File::Mode::THROW_IF_INVALID);
+	return file.read_view();
+}
+
+const redox::Archive* redox::VirtualFileSystem::_find_archive(const Path& path, Path& relativePath) const {
+	auto normalized = path.lexically_normal();
+
+	std::lock_guard guard(_mutex);
+	for (const auto& mount : _mounts) {
+		auto relative = normalized.lexically_relative(mount.root);
+		if (relative.empty() || *relative.begin() == "..") {
+			continue;
+		}
+
+		if (mount.archive->contains(relative)) {
+			relativePath = std::move(relative);
+			return mount.archive.get();
+		}
+	}
+	return nullptr;
+}
@@ -0,0 +1,62 @@
+/*
+redox
+-----------
+MIT License
+
+Copyright (c) 2018 Luis von der Eltz
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#include <core/core.h>
+#include <core/non_copyable.h>
+#include <core/threading/thread_pool.h>
+#include <platform/filesystem.h>
+#include <resources/archive.h>
+
+#include <mutex> //std::mutex
+
+namespace redox {
+	//Resolves absolute resource paths against mounted archives first, loose files second
+	class VirtualFileSystem : public NonCopyable {
+	public:
+		VirtualFileSystem(ThreadPool* threadPool);
+		~VirtualFileSystem() = default;
+
+		//Archive contents appear relative to mountPoint, earlier mounts take precedence
+		void mount(const Path& archive, const Path& mountPoint);
+		std::size_t mount_directory(const Path& directory);
+
+		bool exists(const Path& path) const;
+		io::FileView read(const Path& path) const;
+
+	private:
+		struct mount_point {
+			Path root;
+			UniquePtr<Archive> archive;
+		};
+
+		//Archives are never unmounted, the returned pointer stays valid
+		const Archive* _find_archive(const Path& path, Path& relativePath) const;
+
+		ThreadPool* _threadPool;
+		mutable std::mutex _mutex;
+		Buffer<mount_point> _mounts;
+	};
+}
@@ -114,6 +114,7 @@ typedef struct cgltf_buffer_view
 typedef struct cgltf_accessor
 {
 	cgltf_component_type component_type;
+	cgltf_bool normalized;
 	cgltf_type type;
 	cgltf_size offset;
 	cgltf_size count;
@@ -804,6 +805,13 @@ static int cgltf_parse_json_accessor(jsmntok_t const* tokens, int i,
 			out_data->accessors[accessor_index].component_type = type;
 			++i;
 		}
+		else if (cgltf_json_strcmp(tokens+i, json_chunk, "normalized") == 0)
+		{
+			++i;
+			out_data->accessors[accessor_index].normalized =
+					cgltf_json_to_bool(tokens+i, json_chunk);
+			++i;
+		}
 		else if (cgltf_json_strcmp(tokens+i, json_chunk, "count") == 0)
 		{
 			++i;
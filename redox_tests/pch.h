@@ -10,4 +10,16 @@
 
 #include "math/math.h"
 
-#include "core/meta/reflection.h"
\ No newline at end of file
+#include "core/meta/reflection.h"
+#include "core/compression/lz4.h"
+#include "platform/change_coalescer.h"
+#include "core/hash/xxhash.h"
+#include "resources/importer/mesh_optimizer.h"
+#include "core/threading/thread_pool.h"
+#include "resources/importer/texture_compressor.h"
+#include "core/serialization/binary_stream.h"
+#include "resources/importer/ktx.h"
+#include "resources/importer/mip_generator.h"
+#include "graphics/vulkan/spirv_reflection.h"
+#include "graphics/vulkan/range_allocator.h"
+#include "resources/archive.h"
\ No newline at end of file
@@ -76,4 +76,595 @@ TEST(Mat, Ops) {
 	
 	//auto ivma = ima.inverse();
 
-}
\ No newline at end of file
+}
+
+TEST(LZ4, RoundTrip) {
+	redox::Buffer<redox::byte> input(10000);
+	for (std::size_t i = 0; i < input.size(); ++i)
+		input[i] = static_cast<redox::byte>((i / 7) % 13);
+
+	redox::Buffer<redox::byte> compressed(redox::lz4::compress_bound(input.size()));
+	auto compressedSize = redox::lz4::compress(input.data(), input.size(), compressed.data(), compressed.size());
+	ASSERT_GT(compressedSize, 0u);
+	ASSERT_LT(compressedSize, input.size());
+
+	redox::Buffer<redox::byte> output(input.size());
+	auto outputSize = redox::lz4::decompress(compressed.data(), compressedSize, output.data(), output.size());
+	ASSERT_EQ(outputSize, input.size());
+	ASSERT_EQ(output, input);
+
+	ASSERT_THROW(redox::lz4::decompress(compressed.data(), compressedSize / 2, output.data(), output.size()), redox::Exception);
+}
+
+TEST(ChangeCoalescer, Debounce) {
+	using namespace std::chrono_literals;
+	using redox::io::ChangeEvents;
+	using redox::operator|;
+
+	redox::io::detail::change_coalescer coalescer(100ms);
+	auto start = redox::io::detail::change_coalescer::clock::now();
+	auto subscribed = ChangeEvents::FILE_ADDED | ChangeEvents::FILE_REMOVED | ChangeEvents::FILE_MODIFIED;
+
+	//Neither file exists on disk
+	coalescer.add("removed.txt", ChangeEvents::FILE_MODIFIED, start);
+	coalescer.add("removed.txt", ChangeEvents::FILE_REMOVED, start + 50ms);
+	coalescer.add("transient.txt", ChangeEvents::FILE_ADDED, start);
+	coalescer.add("transient.txt", ChangeEvents::FILE_REMOVED, start);
+
+	ASSERT_TRUE(coalescer.flush("", subscribed, start + 120ms).empty());
+	ASSERT_FALSE(coalescer.empty());
+	ASSERT_TRUE(coalescer.next_deadline() == start + 150ms);
+
+	auto changes = coalescer.flush("", subscribed, start + 150ms);
+	ASSERT_EQ(changes.size(), 1u);
+	ASSERT_EQ(changes[0].file, redox::Path("removed.txt"));
+	ASSERT_EQ(changes[0].events, ChangeEvents::FILE_REMOVED);
+	ASSERT_TRUE(coalescer.empty());
+}
+
+TEST(XXH64, ReferenceValues) {
+	const char* text = "Nobody inspects the spammish repetition";
+
+	ASSERT_EQ(redox::hash::xxh64("", 0), 0xEF46DB3751D8E999ull);
+	ASSERT_EQ(redox::hash::xxh64("abc", 3), 0x44BC2CF5AD770999ull);
+	ASSERT_EQ(redox::hash::xxh64(text, std::strlen(text)), 0xFBCEA83C8A378BF1ull);
+}
+
+TEST(MeshOptimizer, VertexCache) {
+	using redox::graphics::MeshVertex;
+	namespace opt = redox::mesh_optimizer;
+
+	//Grid of quads with unshared vertices and triangles in pseudo random order
+	constexpr uint32_t size = 32;
+	redox::Buffer<MeshVertex> vertices;
+	redox::Buffer<uint32_t> indices;
+
+	for (uint32_t i = 0; i < size * size * 2; ++i) {
+		auto cell = (i * 7919) % (size * size * 2);
+		auto x = static_cast<float>(cell / 2 % size);
+		auto y = static_cast<float>(cell / 2 / size);
+		auto upper = (cell % 2) == 1;
+
+		redox::math::Vec3f corners[3] = {
+			upper ? redox::math::Vec3f(x + 1, y, 0) : redox::math::Vec3f(x, y, 0),
+			redox::math::Vec3f(x + 1, y + (upper ? 1.0f : 0.0f), 0),
+			redox::math::Vec3f(x, y + 1, 0)
+		};
+
+		for (const auto& corner : corners) {
+			MeshVertex vertex;
+			vertex.pos = corner;
+			indices.push_back(static_cast<uint32_t>(vertices.size()));
+			vertices.push_back(vertex);
+		}
+	}
+
+	vertices.resize(opt::deduplicate_vertices(vertices.data(), vertices.size(), indices.data(), indices.size()));
+	ASSERT_EQ(vertices.size(), (size + 1) * (size + 1));
+
+	auto before = opt::acmr(indices.data(), indices.size(), vertices.size());
+	opt::optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+	auto after = opt::acmr(indices.data(), indices.size(), vertices.size());
+	ASSERT_LT(after, before);
+	ASSERT_LT(after, 0.8f);
+
+	vertices.resize(opt::optimize_vertex_fetch(vertices.data(), vertices.size(), indices.data(), indices.size()));
+	ASSERT_EQ(vertices.size(), (size + 1) * (size + 1));
+	ASSERT_EQ(indices[0], 0u);
+}
+
+TEST(MeshOptimizer, Simplify) {
+	using redox::graphics::MeshVertex;
+	namespace opt = redox::mesh_optimizer;
+
+	//Flat grid, interior collapses cost nothing while the border stays locked
+	constexpr uint32_t size = 16;
+	redox::Buffer<MeshVertex> vertices;
+	redox::Buffer<uint32_t> indices;
+
+	for (uint32_t y = 0; y <= size; ++y) {
+		for (uint32_t x = 0; x <= size; ++x) {
+			MeshVertex vertex;
+			vertex.pos = redox::math::Vec3f(static_cast<float>(x), static_cast<float>(y), 0);
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			auto a = y * (size + 1) + x, c = a + size + 1;
+			indices.insert(indices.end(), { a, a + 1, c, a + 1, c + 1, c });
+		}
+	}
+
+	redox::Buffer<uint32_t> lod(indices.size());
+	float error = 1.0f;
+	auto count = opt::simplify(lod.data(), indices.data(), indices.size(),
+		vertices.data(), vertices.size(), indices.size() / 4, 0.01f, &error);
+
+	ASSERT_LE(count, indices.size() / 4);
+	ASSERT_EQ(count % 3, 0u);
+	ASSERT_FLOAT_EQ(error, 0.0f);
+
+	//Still covers the whole grid without flipped triangles
+	float area = 0.0f;
+	for (std::size_t i = 0; i < count; i += 3) {
+		auto& a = vertices[lod[i]].pos;
+		auto& b = vertices[lod[i + 1]].pos;
+		auto& c = vertices[lod[i + 2]].pos;
+		auto doubled = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+		ASSERT_GT(doubled, 0.0f);
+		area += doubled * 0.5f;
+	}
+	ASSERT_FLOAT_EQ(area, static_cast<float>(size * size));
+}
+
+TEST(MeshOptimizer, Meshlets) {
+	using redox::graphics::MeshVertex;
+	namespace opt = redox::mesh_optimizer;
+
+	constexpr uint32_t size = 32;
+	redox::Buffer<MeshVertex> vertices;
+	redox::Buffer<uint32_t> indices;
+
+	for (uint32_t y = 0; y <= size; ++y) {
+		for (uint32_t x = 0; x <= size; ++x) {
+			MeshVertex vertex;
+			vertex.pos = redox::math::Vec3f(static_cast<float>(x), static_cast<float>(y), 0);
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (uint32_t y = 0; y < size; ++y) {
+		for (uint32_t x = 0; x < size; ++x) {
+			auto a = y * (size + 1) + x, c = a + size + 1;
+			indices.insert(indices.end(), { a, a + 1, c, a + 1, c + 1, c });
+		}
+	}
+
+	auto meshlets = opt::build_meshlets(indices.data(), indices.size(), vertices.data(), vertices.size());
+	ASSERT_GT(meshlets.size(), 1u);
+
+	//Consecutive ranges covering every triangle, flat so the normal cone is closed
+	uint32_t next = 0;
+	for (const auto& meshlet : meshlets) {
+		ASSERT_EQ(meshlet.indexOffset, next);
+		ASSERT_LE(meshlet.indexCount, redox::graphics::MESHLET_MAX_TRIANGLES * 3);
+		ASSERT_FLOAT_EQ(meshlet.coneCutoff, 0.0f);
+		ASSERT_FLOAT_EQ(meshlet.coneAxis[2], 1.0f);
+		next += meshlet.indexCount;
+	}
+	ASSERT_EQ(next, indices.size());
+}
+
+TEST(ThreadPool, NestedWait) {
+	//A single worker has to run the inner task itself while waiting for it
+	redox::ThreadPool pool(1);
+
+	auto outer = pool.submit([&pool]() {
+		auto group = pool.create_group();
+		auto inner = pool.submit([]() { return 21; }, redox::TaskPriority::HIGH, group);
+		pool.wait(inner, group);
+		return inner.get() * 2;
+	});
+
+	outer.wait();
+	ASSERT_EQ(outer.get(), 42);
+}
+
+TEST(ThreadPool, GroupWait) {
+	//Waiting on a group must not pick up unrelated tasks queued ahead of it
+	redox::ThreadPool pool(1);
+	std::atomic_bool unrelatedRan = false;
+
+	auto outer = pool.submit([&pool, &unrelatedRan]() {
+		pool.submit([&unrelatedRan]() { unrelatedRan = true; }, redox::TaskPriority::CRITICAL);
+
+		auto group = pool.create_group();
+		auto inner = pool.submit([&unrelatedRan]() { return !unrelatedRan; }, redox::TaskPriority::LOW, group);
+		pool.wait(inner, group);
+		return inner.get();
+	});
+
+	outer.wait();
+	ASSERT_TRUE(outer.get());
+}
+
+TEST(ThreadPool, ShutdownWhileWaiting) {
+	std::promise<void> waiting;
+	std::future<void> outer;
+	{
+		//The only worker waits on a task nobody is going to run
+		redox::ThreadPool pool(1);
+		outer = pool.submit([&pool, &waiting]() {
+			auto inner = pool.submit([]() {});
+			waiting.set_value();
+			pool.wait(inner, pool.create_group());
+			inner.get();
+		});
+		waiting.get_future().wait();
+	}
+
+	ASSERT_THROW(outer.get(), std::future_error);
+}
+
+TEST(TextureCompressor, RoundTrip) {
+	namespace tc = redox::texture_compressor;
+
+	//Diagonal gradient with a partial block row at the bottom edge, steep enough
+	//that BC1 has to interpolate across several texel steps per palette entry
+	constexpr uint32_t width = 8, height = 6;
+	redox::Buffer<redox::byte> pixels(width * height * 4);
+	for (uint32_t y = 0; y < height; ++y) {
+		for (uint32_t x = 0; x < width; ++x) {
+			auto texel = &pixels[(y * width + x) * 4];
+			auto step = x + y;
+			texel[0] = static_cast<redox::byte>(step * 20);
+			texel[1] = static_cast<redox::byte>(step * 14 + 20);
+			texel[2] = static_cast<redox::byte>(200 - step * 12);
+			texel[3] = static_cast<redox::byte>(255 - step * 18);
+		}
+	}
+
+	struct expectation {
+		tc::BlockFormat format;
+		uint32_t channels;
+		int maxError;
+	};
+
+	for (auto [format, channels, maxError] : { expectation{ tc::BlockFormat::BC1, 3, 24 },
+		expectation{ tc::BlockFormat::BC3, 4, 24 }, expectation{ tc::BlockFormat::BC5, 2, 10 },
+		expectation{ tc::BlockFormat::BC7, 4, 6 } }) {
+
+		auto blocks = tc::compress(pixels.data(), width, height, format);
+		ASSERT_EQ(blocks.size(), tc::compressed_size(format, width, height));
+		ASSERT_EQ(blocks.size(), 4 * tc::block_size(format));
+
+		for (uint32_t block = 0; block < 4; ++block) {
+			redox::byte decoded[64];
+			tc::decode_block(format, blocks.data() + block * tc::block_size(format), decoded);
+
+			auto bx = (block % 2) * 4, by = (block / 2) * 4;
+			for (uint32_t i = 0; i < 16; ++i) {
+				auto x = bx + i % 4, y = std::min(by + i / 4, height - 1);
+				for (uint32_t c = 0; c < channels; ++c) {
+					ASSERT_NEAR(decoded[i * 4 + c], pixels[(y * width + x) * 4 + c], maxError);
+				}
+			}
+		}
+	}
+
+	//Mode 6 represents every 8 bit value exactly through the p-bits
+	redox::byte solid[64], block[16], decoded[64];
+	for (uint32_t i = 0; i < 64; ++i) {
+		solid[i] = static_cast<redox::byte>(i % 4 * 50 + 23);
+	}
+	tc::encode_block(tc::BlockFormat::BC7, solid, block);
+	tc::decode_block(tc::BlockFormat::BC7, block, decoded);
+	ASSERT_EQ(std::memcmp(solid, decoded, sizeof(solid)), 0);
+}
+
+TEST(KTX, Parse) {
+	const redox::byte identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	//Header, index and a two level chain of one BC7 block each
+	auto write_file = [&](uint32_t supercompression) {
+		redox::BinaryWriter writer;
+		writer.write_bytes(identifier, sizeof(identifier));
+		for (uint32_t value : { 145u, 1u, 4u, 2u, 0u, 0u, 1u, 2u, supercompression, 0u, 0u, 0u, 0u }) {
+			writer.write(value);
+		}
+		writer.write(uint64_t{ 0 });
+		writer.write(uint64_t{ 0 });
+		for (uint64_t offset : { 128u, 144u }) {
+			writer.write(offset);
+			writer.write(uint64_t{ 16 });
+			writer.write(uint64_t{ 16 });
+		}
+		redox::Buffer<redox::byte> payload(32);
+		writer.write_bytes(payload.data(), payload.size());
+		return writer.buffer();
+	};
+
+	auto file = write_file(0);
+	ASSERT_TRUE(redox::ktx::is_ktx2(file.data(), file.size()));
+
+	auto info = redox::ktx::parse(file.data(), file.size());
+	ASSERT_EQ(info.vkFormat, 145u);
+	ASSERT_EQ(info.levels.size(), 2u);
+	ASSERT_EQ(info.levels[1].offset, 144u);
+	ASSERT_EQ(info.levels[1].width, 2u);
+	ASSERT_EQ(info.levels[1].height, 1u);
+
+	auto zstd = write_file(2);
+	ASSERT_THROW(redox::ktx::parse(zstd.data(), zstd.size()), redox::Exception);
+	ASSERT_THROW(redox::ktx::parse(file.data(), 64), redox::Exception);
+}
+
+TEST(MipGenerator, Chain) {
+	namespace mips = redox::mip_generator;
+
+	//Odd width so both the SIMD pairs and the clamped edge column are hit
+	constexpr uint32_t width = 11, height = 6;
+	redox::Buffer<redox::byte> pixels(width * height * 4);
+	for (std::size_t i = 0; i < pixels.size(); ++i) {
+		pixels[i] = static_cast<redox::byte>((i * 37 + i / 7) & 0xFF);
+	}
+
+	auto at = [&](uint32_t x, uint32_t y, uint32_t c) {
+		return pixels[(std::min(y, height - 1) * width + std::min(x, width - 1)) * 4 + c];
+	};
+
+	auto level = mips::downsample(pixels.data(), width, height);
+	ASSERT_EQ(level.width, 5u);
+	ASSERT_EQ(level.height, 3u);
+
+	for (uint32_t y = 0; y < level.height; ++y) {
+		for (uint32_t x = 0; x < level.width; ++x) {
+			for (uint32_t c = 0; c < 4; ++c) {
+				auto sum = at(x * 2, y * 2, c) + at(x * 2 + 1, y * 2, c) + at(x * 2, y * 2 + 1, c) + at(x * 2 + 1, y * 2 + 1, c);
+				ASSERT_EQ(level.pixels[(y * level.width + x) * 4 + c], (sum + 2) >> 2);
+			}
+		}
+	}
+
+	auto chain = mips::generate(pixels.data(), width, height, true);
+	ASSERT_EQ(chain.size() + 1, mips::level_count(width, height));
+	ASSERT_EQ(chain.back().width, 1u);
+	ASSERT_EQ(chain.back().height, 1u);
+
+	//Renormalized normals stay unit length
+	for (const auto& normals : chain) {
+		for (std::size_t i = 0; i < normals.pixels.size(); i += 4) {
+			float n[3];
+			for (uint32_t c = 0; c < 3; ++c) {
+				n[c] = normals.pixels[i + c] / 127.5f - 1.0f;
+			}
+			ASSERT_NEAR(std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]), 1.0f, 0.02f);
+		}
+	}
+}
+
+TEST(SpirvReflection, Interface) {
+	redox::Buffer<redox::u32> words = { 0x07230203, 0x00010000, 0, 200, 0 };
+	auto op = [&](redox::u32 opcode, std::initializer_list<redox::u32> operands) {
+		words.push_back(static_cast<redox::u32>(operands.size() + 1) << 16 | opcode);
+		words.insert(words.end(), operands);
+	};
+
+	op(15, { 0, 100, 0x6E69616D, 0 }); //OpEntryPoint Vertex %100 "main"
+	op(71, { 4, 30, 0 }); //Location 0
+	op(71, { 6, 2 }); //Block
+	op(72, { 6, 0, 35, 0 }); //Offset 0
+	op(72, { 6, 1, 35, 4 }); //Offset 4
+	op(71, { 14, 34, 1 }); //DescriptorSet 1
+	op(71, { 14, 33, 2 }); //Binding 2
+	op(71, { 17, 2 });
+	op(72, { 17, 0, 35, 0 });
+	op(72, { 17, 0, 7, 16 }); //MatrixStride 16
+	op(71, { 19, 33, 0 });
+	op(71, { 20, 11, 42 }); //BuiltIn VertexIndex
+
+	op(22, { 1, 32 }); //float
+	op(23, { 2, 1, 3 }); //vec3
+	op(32, { 3, 1, 2 }); //Input vec3*
+	op(59, { 3, 4, 1 });
+	op(21, { 5, 32, 0 }); //uint
+	op(30, { 6, 5, 5 }); //struct { uint, uint }
+	op(32, { 7, 9, 6 }); //PushConstant
+	op(59, { 7, 8, 9 });
+	op(25, { 9, 1, 1, 0, 0, 0, 1, 0 }); //image2D, sampled
+	op(27, { 10, 9 }); //sampler2D
+	op(43, { 5, 11, 3 }); //uint 3
+	op(28, { 12, 10, 11 }); //sampler2D[3]
+	op(32, { 13, 0, 12 }); //UniformConstant
+	op(59, { 13, 14, 0 });
+	op(23, { 15, 1, 4 }); //vec4
+	op(24, { 16, 15, 4 }); //mat4
+	op(30, { 17, 16 });
+	op(32, { 18, 2, 17 }); //Uniform
+	op(59, { 18, 19, 2 });
+	op(21, { 21, 32, 1 }); //int
+	op(32, { 22, 1, 21 });
+	op(59, { 22, 20, 1 });
+
+	auto info = redox::spirv::reflect(words.data(), words.size());
+	ASSERT_EQ(info.stage, 0x1u);
+	ASSERT_EQ(info.pushConstantSize, 8u);
+
+	ASSERT_EQ(info.inputs.size(), 1u);
+	ASSERT_EQ(info.inputs[0].location, 0u);
+	ASSERT_EQ(info.inputs[0].format, 106u); //R32G32B32_SFLOAT
+
+	ASSERT_EQ(info.bindings.size(), 2u);
+	ASSERT_EQ(info.bindings[0].set, 0u);
+	ASSERT_EQ(info.bindings[0].binding, 0u);
+	ASSERT_EQ(info.bindings[0].descriptorType, 6u); //UNIFORM_BUFFER
+	ASSERT_EQ(info.bindings[1].set, 1u);
+	ASSERT_EQ(info.bindings[1].binding, 2u);
+	ASSERT_EQ(info.bindings[1].descriptorType, 1u); //COMBINED_IMAGE_SAMPLER
+	ASSERT_EQ(info.bindings[1].count, 3u);
+
+	words.resize(words.size() - 1);
+	ASSERT_THROW(redox::spirv::reflect(words.data(), words.size()), redox::Exception);
+}
+
+TEST(RangeAllocator, Tlsf) {
+	redox::graphics::TlsfAllocator tlsf(1024);
+
+	auto a = tlsf.allocate(100, 64);
+	auto b = tlsf.allocate(200, 256);
+	ASSERT_TRUE(a && b);
+	ASSERT_EQ(a->offset % 64, 0u);
+	ASSERT_EQ(b->offset % 256, 0u);
+	ASSERT_TRUE(a->offset + 100 <= b->offset || b->offset + 200 <= a->offset);
+	ASSERT_EQ(tlsf.used(), 300u);
+	ASSERT_FALSE(tlsf.allocate(1024));
+
+	//Freed neighbours merge back into a single range
+	tlsf.free(a->handle);
+	tlsf.free(b->handle);
+	ASSERT_EQ(tlsf.allocation_count(), 0u);
+	ASSERT_EQ(tlsf.free_range_count(), 1u);
+	ASSERT_EQ(tlsf.largest_free_range(), 1024u);
+	ASSERT_TRUE(tlsf.allocate(1024));
+}
+
+TEST(RangeAllocator, Linear) {
+	redox::graphics::LinearAllocator linear(256);
+
+	ASSERT_EQ(linear.allocate(10), 0u);
+	ASSERT_EQ(linear.allocate(10, 16), 16u);
+	ASSERT_FALSE(linear.allocate(250));
+
+	//Only reused once everything is freed
+	linear.free(10);
+	ASSERT_EQ(linear.head(), 26u);
+	linear.free(10);
+	ASSERT_EQ(linear.head(), 0u);
+	ASSERT_EQ(linear.allocate(256), 0u);
+}
+
+TEST(Archive, RoundTrip) {
+	//One entry stored as is, one split into several LZ4 blocks
+	redox::Buffer<redox::byte> stored(1000);
+	for (std::size_t i = 0; i < stored.size(); ++i) {
+		stored[i] = static_cast<redox::byte>(i * 7);
+	}
+
+	redox::Buffer<redox::byte> compressed(200 * 1024);
+	for (std::size_t i = 0; i < compressed.size(); ++i) {
+		compressed[i] = static_cast<redox::byte>((i / 64) % 251);
+	}
+
+	constexpr redox::u32 alignment = 64;
+	auto file = std::filesystem::temp_directory_path() / "redox_tests_archive.rpak";
+
+	redox::ArchiveWriter writer(alignment, 64 * 1024);
+	writer.add("Data/Stored.bin", stored);
+	writer.add("data/compressed.bin", compressed, true);
+	writer.write(file);
+
+	{
+		redox::ThreadPool pool(2);
+		redox::Archive archive(file, &pool);
+		ASSERT_EQ(archive.entry_count(), 2);
+
+		//Lookups are case insensitive and on the normalized path
+		ASSERT_TRUE(archive.contains("data/./stored.bin"));
+		ASSERT_FALSE(archive.contains("data/missing.bin"));
+		ASSERT_FALSE(archive.read("data/missing.bin"));
+
+		auto storedView = archive.read("data/stored.bin");
+		ASSERT_TRUE(storedView);
+		ASSERT_EQ(storedView->size(), stored.size());
+		ASSERT_TRUE(std::equal(stored.begin(), stored.end(), storedView->data()));
+
+		auto compressedView = archive.read("Data/Compressed.bin");
+		ASSERT_TRUE(compressedView);
+		ASSERT_EQ(compressedView->size(), compressed.size());
+		ASSERT_TRUE(std::equal(compressed.begin(), compressed.end(), compressedView->data()));
+	}
+
+	{
+		redox::io::MappedFile mapping(file);
+		ASSERT_TRUE(mapping.is_valid());
+
+		redox::rpak::header header;
+		std::memcpy(&header, mapping.data(), sizeof(header));
+		ASSERT_EQ(header.magic, redox::rpak::MAGIC);
+		ASSERT_EQ(header.alignment, alignment);
+
+		std::size_t compressedEntries = 0;
+		for (redox::u32 i = 0; i < header.entryCount; ++i) {
+			redox::rpak::toc_entry entry;
+			std::memcpy(&entry, mapping.data() + header.tocOffset + i * sizeof(entry), sizeof(entry));
+			ASSERT_EQ(entry.offset % alignment, 0);
+
+			if (redox::util::check_flag(entry.flags, redox::rpak::EntryFlags::COMPRESSED)) {
+				ASSERT_LT(entry.storedSize, entry.size);
+				++compressedEntries;
+			}
+			else ASSERT_EQ(entry.storedSize, entry.size);
+		}
+		ASSERT_EQ(compressedEntries, 1);
+	}
+
+	std::filesystem::remove(file);
+}
+
+TEST(Archive, CorruptTableOfContents) {
+	redox::Buffer<redox::byte> stored(1000, 42);
+	auto file = std::filesystem::temp_directory_path() / "redox_tests_corrupt.rpak";
+
+	redox::ArchiveWriter writer(64, 64 * 1024);
+	writer.add("data/stored.bin", stored);
+	writer.write(file);
+
+	redox::Buffer<redox::byte> original;
+	{
+		redox::io::MappedFile mapping(file);
+		ASSERT_TRUE(mapping.is_valid());
+		original.assign(mapping.data(), mapping.data() + mapping.size());
+	}
+
+	//Each patch is written over the valid archive, the file keeps its size
+	auto expect_invalid = [&](auto patch) {
+		auto bytes = original;
+		redox::rpak::header header;
+		redox::rpak::toc_entry entry;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		std::memcpy(&entry, bytes.data() + header.tocOffset, sizeof(entry));
+
+		patch(header, entry);
+
+		std::memcpy(bytes.data(), &header, sizeof(header));
+		std::memcpy(bytes.data() + header.tocOffset, &entry, sizeof(entry));
+
+		{
+			redox::io::File out(file, redox::io::File::Mode::WRITE);
+			ASSERT_TRUE(out.is_valid());
+			out.write(bytes.data(), bytes.size());
+		}
+
+		ASSERT_THROW(redox::Archive(file, nullptr), redox::Exception);
+	};
+
+	//More entries than fit in front of the names, the end of the table would wrap
+	expect_invalid([](redox::rpak::header& header, redox::rpak::toc_entry&) {
+		header.entryCount = 0xFFFFFFFF;
+	});
+
+	//Offset plus stored size wraps around to a small value
+	expect_invalid([](redox::rpak::header&, redox::rpak::toc_entry& entry) {
+		entry.offset = ~0ull - 7;
+		entry.storedSize = 16;
+	});
+
+	//A stored entry that claims to be larger than what is stored
+	expect_invalid([](redox::rpak::header&, redox::rpak::toc_entry& entry) {
+		entry.size = entry.storedSize + 1;
+	});
+
+	std::filesystem::remove(file);
+}